@@ -0,0 +1,351 @@
+//==============================================================================
+// EDROS kernel benchmarks (Linux host port)
+//------------------------------------------------------------------------------
+// Measures the kernel hot paths and writes the results as JSON (one record per
+// benchmark and parameter set), to be compared between releases with
+// tools/edros_bench.py:
+// - pipe.insert, pipe.dispatch: NMessagePipe::Insert/Send and Dispatch, per
+//   component count (1-64), queue depth and message mix (broadcast, unicast,
+//   priority levels).
+// - system.dispatch: System::Dispatch routing, per priority class (critical,
+//   callback, queued).
+// - system.heartbeat: System::Heartbeat against the number of armed timers.
+// - pipe.find, pipe.exclude: FindComponent and ExcludeComponent against the
+//   number of registered components.
+//
+// Build (see Host/NHost.cpp), larger kernel tables give the full parameter range:
+//   g++ -std=gnu++17 -O2 -DEDROS_HOST -D__SYS_MAX_TIMERS=128 -IHost -IInc
+//       -I<framework Inc> Src/*.cpp Host/NHost.cpp Bench/Benchmark.cpp -lpthread
+// Environment:
+//   EDROS_BENCH_OUTPUT  JSON file (default: standard output)
+//   EDROS_BENCH_SCALE   run length multiplier (default: 1)
+//==============================================================================
+#ifndef EDROS_HOST
+    #error "Bench/Benchmark.cpp: host builds only (-DEDROS_HOST)"
+#endif
+
+#include "System.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+#define __BENCH_VERSION 			((uint32_t) 1)
+#define __BENCH_SAMPLES 			((uint32_t) 5)
+#define __BENCH_MESSAGES 			((uint32_t) 16384)
+#define __BENCH_MESSAGE 			((uint32_t) 0x00000400)
+#define __BENCH_DEPTH 				((uint32_t) 256)
+#define __BENCH_COMPONENTS 			((uint32_t) 64)
+#define __BENCH_BATCH 				((uint32_t) 16)
+#define __BENCH_QUEUED_ROUNDS 		((uint32_t) 128)
+
+#define __BENCH_MIN(a, b) 			(((a) < (b))? (a) : (b))
+
+//------------------------------------------------------------------------------
+class BenchComponent : public NComponent{
+    public:
+        uint32_t notified;
+
+        BenchComponent(){ notified = 0L; Priority = nLow;}
+
+        void Notify(NMESSAGE* Msg){
+            if(Msg->message == __BENCH_MESSAGE){ notified++;}
+            Msg->message = NM_NULL;
+        }
+
+        void InterruptCallBack(NMESSAGE* Msg){ notified++; Msg->message = NM_NULL;}
+};
+
+//------------------------------------------------------------------------------
+static NStaticMessagePipe<__BENCH_DEPTH, __BENCH_DEPTH> benchPipe;
+static BenchComponent benchComponents[__BENCH_COMPONENTS];
+static uint32_t benchRegistered = 0L;
+static uint32_t benchScale = 1L;
+static uint64_t benchOverhead = 0L;
+static FILE* benchOutput;
+static bool benchFirst = true;
+
+//------------------------------------------------------------------------------
+static uint64_t Now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+// cost of a pair of clock readings, subtracted from each timed section
+static void Calibrate(){
+    benchOverhead = ~0ULL;
+    for(uint32_t i=0L; i<1000; i++){
+        uint64_t t0 = Now();
+        uint64_t t1 = Now();
+        if((t1 - t0) < benchOverhead){ benchOverhead = t1 - t0;}
+    }
+}
+
+static uint64_t Elapsed(uint64_t t0, uint64_t t1){
+    uint64_t ns = t1 - t0;
+    return((ns > benchOverhead)? (ns - benchOverhead) : 0L);
+}
+
+static double Median(double* samples, uint32_t n){
+    for(uint32_t i=1L; i<n; i++){
+        double v = samples[i];
+        uint32_t j = i;
+        while((j > 0L)&&(samples[j - 1] > v)){ samples[j] = samples[j - 1]; j--;}
+        samples[j] = v;
+    }
+    return(samples[n / 2]);
+}
+
+//------------------------------------------------------------------------------
+// one JSON record: {"benchmark": ..., <parameters>, "ns_per_op": ..., "ops_per_s": ...}
+static void Report(const char* benchmark, const char* parameters, double ns){
+    fprintf(benchOutput, "%s\n    {\"benchmark\": \"%s\", %s, \"ns_per_op\": %.2f, \"ops_per_s\": %.0f}",
+            benchFirst? "" : ",", benchmark, parameters, ns, (ns > 0.0)? (1e9 / ns) : 0.0);
+    benchFirst = false;
+    fprintf(stderr, "%-18s %-48s %10.1f ns\n", benchmark, parameters, ns);
+}
+
+//------------------------------------------------------------------------------
+// registers the first "n" benchmark components in the benchmark pipe
+static void Register(uint32_t n){
+    while(benchRegistered > n){ benchPipe.ExcludeComponent(&benchComponents[--benchRegistered]);}
+    while(benchRegistered < n){ benchPipe.IncludeComponent(&benchComponents[benchRegistered++]);}
+}
+
+//------------------------------------------------------------------------------
+// pipe.insert / pipe.dispatch: "depth" messages queued, then dispatched at once
+enum{ kBroadcast, kUnicast, kPriority};
+static const char* const benchMixes[] = { "broadcast", "unicast", "priority"};
+
+static void BenchPipe(uint32_t components, uint32_t depth, uint32_t mix){
+    double insert[__BENCH_SAMPLES], dispatch[__BENCH_SAMPLES];
+    uint32_t rounds = (__BENCH_MESSAGES * benchScale) / depth;
+    if(rounds == 0L){ rounds = 1L;}
+    Register(components);
+
+    for(uint32_t s=0L; s<__BENCH_SAMPLES; s++){
+        uint64_t ti = 0L, td = 0L, n = 0L;
+        for(uint32_t r=0L; r<rounds; r++){
+            NMESSAGE Msg = { __BENCH_MESSAGE, r, 0L, 0L};
+            uint64_t t0 = Now();
+            for(uint32_t i=0L; i<depth; i++){
+                switch(mix){
+                    case kUnicast: benchPipe.Send(&Msg, &benchComponents[i % components], __SYS_QUEUE_STANDARD); break;
+                    case kPriority: benchPipe.Insert(&Msg, i % __SYS_PRIORITY_LEVELS); break;
+                    default: benchPipe.Insert(&Msg, __SYS_QUEUE_STANDARD); break;
+                }
+            }
+            uint64_t t1 = Now();
+            n += benchPipe.Dispatch();
+            uint64_t t2 = Now();
+            ti += Elapsed(t0, t1);
+            td += Elapsed(t1, t2);
+        }
+        insert[s] = (double)ti / ((double)rounds * depth);
+        dispatch[s] = (n > 0L)? ((double)td / n) : 0.0;
+    }
+
+    char parameters[96];
+    snprintf(parameters, sizeof(parameters), "\"components\": %u, \"depth\": %u, \"mix\": \"%s\"",
+             (unsigned)components, (unsigned)depth, benchMixes[mix]);
+    Report("pipe.insert", parameters, Median(insert, __BENCH_SAMPLES));
+    Report("pipe.dispatch", parameters, Median(dispatch, __BENCH_SAMPLES));
+}
+
+//------------------------------------------------------------------------------
+// pipe.find / pipe.exclude: against the number of registered components
+static void BenchRegistry(uint32_t components){
+    double find[__BENCH_SAMPLES], exclude[__BENCH_SAMPLES];
+    uint32_t rounds = ((__BENCH_MESSAGES * benchScale) / components) + 1L;
+    volatile uint32_t sink = 0L;
+
+    for(uint32_t s=0L; s<__BENCH_SAMPLES; s++){
+        uint64_t tf = 0L, tx = 0L;
+        for(uint32_t r=0L; r<rounds; r++){
+            Register(components);
+            uint64_t t0 = Now();
+            for(uint32_t i=0L; i<components; i++) sink += benchPipe.FindComponent(&benchComponents[i]);
+            uint64_t t1 = Now();
+            // the most recently registered first, as components are usually destroyed
+            for(uint32_t i=components; i>0L; i--) benchPipe.ExcludeComponent(&benchComponents[i - 1]);
+            uint64_t t2 = Now();
+            benchRegistered = 0L;
+            tf += Elapsed(t0, t1);
+            tx += Elapsed(t1, t2);
+        }
+        find[s] = (double)tf / ((double)rounds * components);
+        exclude[s] = (double)tx / ((double)rounds * components);
+    }
+    (void)sink;
+
+    char parameters[32];
+    snprintf(parameters, sizeof(parameters), "\"components\": %u", (unsigned)components);
+    Report("pipe.find", parameters, Median(find, __BENCH_SAMPLES));
+    Report("pipe.exclude", parameters, Median(exclude, __BENCH_SAMPLES));
+}
+
+//------------------------------------------------------------------------------
+// system.dispatch: routing of an interrupt message, batches in a critical section
+// (as in an interrupt handler: the callbacks and the dispatcher run afterwards)
+static uint32_t benchExpected;
+
+static bool Drained(void* context){
+    return(((BenchComponent*)context)->notified >= benchExpected);
+}
+
+static void BenchRouting(){
+    static const char* const classes[] = { "critical", "callback", "queued"};
+    static const NPRIORITY priorities[] = { nTimeCritical, nNormal, nLow};
+    const uint32_t batches[] = { __BENCH_BATCH, __BENCH_MIN(__BENCH_BATCH, __SYS_STANDARD_CALLBACKS),
+                                 __BENCH_MIN(__BENCH_BATCH, __SYS_STANDARD_MESSAGES)};
+    BenchComponent comp;
+    NV_ID vector = (NV_ID)(__SYS_MAX_VECTORS - 1);
+
+    //-----------------------------------------
+    bool registered = SYS->FindComponent(&comp);
+    if(!registered){ SYS->IncludeComponent(&comp);}
+    HANDLE previous = SYS->InstallCallback(&comp, vector);
+
+    for(uint32_t c=0L; c<3; c++){
+        double samples[__BENCH_SAMPLES];
+        uint32_t batch = batches[c];
+        uint32_t rounds = ((__BENCH_MESSAGES * benchScale) / batch) + 1L;
+        // draining waits up to the next tick: fewer rounds
+        if(priorities[c] == nLow){ rounds = __BENCH_QUEUED_ROUNDS * benchScale;}
+        comp.Priority = priorities[c];
+
+        for(uint32_t s=0L; s<__BENCH_SAMPLES; s++){
+            uint64_t t = 0L;
+            for(uint32_t r=0L; r<rounds; r++){
+                NMESSAGE Msg = { __BENCH_MESSAGE, (uint32_t)vector, r, 0L};
+                comp.notified = 0L;
+
+                NQUEUESTATS before, after;
+                __disable_irq();
+                SYS->GetQueueStats(__SYS_QUEUE_STANDARD, &before);
+                uint64_t t0 = Now();
+                for(uint32_t i=0L; i<batch; i++) SYS->Dispatch(&Msg);
+                uint64_t t1 = Now();
+                SYS->GetQueueStats(__SYS_QUEUE_STANDARD, &after);
+                __enable_irq();
+                t += Elapsed(t0, t1);
+
+                // queued copies (those not dropped by a full queue): dispatched before the next batch
+                if(priorities[c] == nLow){
+                    benchExpected = after.inserts - before.inserts;
+                    SYS->WaitFor(Drained, &comp, 100);
+                }
+            }
+            samples[s] = (double)t / ((double)rounds * batch);
+        }
+
+        char parameters[32];
+        snprintf(parameters, sizeof(parameters), "\"class\": \"%s\"", classes[c]);
+        Report("system.dispatch", parameters, Median(samples, __BENCH_SAMPLES));
+    }
+
+    //-----------------------------------------
+    SYS->InstallCallback(previous, vector);
+    if(!registered){ SYS->ExcludeComponent(&comp);}
+}
+
+//------------------------------------------------------------------------------
+// system.heartbeat: against the number of armed timers (none expiring)
+static void Expired(uint32_t timer, void* context){}
+
+static void BenchHeartbeat(uint32_t armed){
+    static uint32_t timers[__SYS_MAX_TIMERS];
+    double samples[__BENCH_SAMPLES];
+    uint32_t beats = __BENCH_MESSAGES * benchScale;
+
+    //-----------------------------------------
+    // the SysTick handler must not beat meanwhile
+    SYS->Halt();
+    for(uint32_t i=0L; i<armed; i++){
+        // spread over the wheel levels, beyond the run length
+        timers[i] = SYS->StartTimer(Expired, NULL, (beats * __BENCH_SAMPLES) + 1000L + (i * 7919L));
+    }
+
+    for(uint32_t s=0L; s<__BENCH_SAMPLES; s++){
+        uint64_t t0 = Now();
+        for(uint32_t b=0L; b<beats; b++) SYS->Heartbeat();
+        uint64_t t1 = Now();
+        samples[s] = (double)Elapsed(t0, t1) / beats;
+    }
+
+    for(uint32_t i=0L; i<armed; i++) SYS->CancelTimer(timers[i]);
+    SYS->Resume();
+
+    char parameters[32];
+    snprintf(parameters, sizeof(parameters), "\"timers\": %u", (unsigned)armed);
+    Report("system.heartbeat", parameters, Median(samples, __BENCH_SAMPLES));
+}
+
+//------------------------------------------------------------------------------
+void ApplicationCreate(){
+    static const uint32_t components[] = { 1, 4, 16, 64};
+    static const uint32_t depths[] = { 1, 16, 256};
+    static const uint32_t timers[] = { 0, 1, 16, 128};
+    const uint32_t max_components = __BENCH_MIN(__BENCH_COMPONENTS, __SYS_MAX_OBJECTS);
+
+    //-----------------------------------------
+    const char* scale = getenv("EDROS_BENCH_SCALE");
+    if((scale != NULL)&&(atoi(scale) > 0)){ benchScale = (uint32_t)atoi(scale);}
+    const char* path = getenv("EDROS_BENCH_OUTPUT");
+    benchOutput = (path != NULL)? fopen(path, "w") : stdout;
+    if(benchOutput == NULL){ perror(path); exit(1);}
+    Calibrate();
+
+    fprintf(benchOutput, "{\n  \"suite\": \"edros-bench\", \"version\": %u,\n", (unsigned)__BENCH_VERSION);
+    fprintf(benchOutput, "  \"config\": {\"priority_levels\": %u, \"max_objects\": %u, \"max_timers\": %u, "
+            "\"standard_messages\": %u, \"callbacks\": %u, \"profiler\": %s, \"latency\": %s, \"trace\": %s, \"threads\": %s},\n",
+            (unsigned)__SYS_PRIORITY_LEVELS, (unsigned)__SYS_MAX_OBJECTS, (unsigned)__SYS_MAX_TIMERS,
+            (unsigned)__SYS_STANDARD_MESSAGES, (unsigned)__SYS_STANDARD_CALLBACKS,
+#ifdef __SYS_PROFILER
+            "true",
+#else
+            "false",
+#endif
+#ifdef __SYS_LATENCY
+            "true",
+#else
+            "false",
+#endif
+#ifdef __SYS_TRACE
+            "true",
+#else
+            "false",
+#endif
+#ifdef __SYS_THREADS
+            "true");
+#else
+            "false");
+#endif
+    fprintf(benchOutput, "  \"results\": [");
+
+    //-----------------------------------------
+    // parameters beyond the kernel tables are skipped
+    for(uint32_t c=0L; c<4; c++){
+        if(components[c] > max_components){ continue;}
+        for(uint32_t d=0L; d<3; d++){
+            for(uint32_t m=kBroadcast; m<=kPriority; m++) BenchPipe(components[c], depths[d], m);
+        }
+    }
+    Register(0L);
+    for(uint32_t c=0L; c<4; c++){
+        if(components[c] <= max_components){ BenchRegistry(components[c]);}
+    }
+    BenchRouting();
+    for(uint32_t t=0L; t<4; t++){
+        if(timers[t] <= __SYS_MAX_TIMERS){ BenchHeartbeat(timers[t]);}
+    }
+
+    //-----------------------------------------
+    fprintf(benchOutput, "\n  ]\n}\n");
+    if(benchOutput != stdout){ fclose(benchOutput);}
+    exit(0);
+}
+
+//==============================================================================
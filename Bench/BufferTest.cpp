@@ -0,0 +1,184 @@
+//==============================================================================
+// EDROS zero-copy messages: data block ownership test (Linux host port)
+//------------------------------------------------------------------------------
+// Checks that the kernel releases every data block reference it was given, and
+// only those:
+// - plain: a message posted with PostMessage whose "tag" happens to equal a live
+//   block handle leaves the block alone.
+// - critical, callback: DispatchBuffer to nTimeCritical and nNormal owners, from
+//   an emulated interrupt: the reference ends with InterruptCallBack.
+// - forward: an nNormal owner returning the message with the same "tag" passes
+//   the block on to the next routing of the message.
+// - queued: DispatchBuffer to an nLow owner, PostBuffer and SendBuffer: released
+//   once the components have been notified.
+// - discarded: SendBuffer to an unregistered component, and a full callback ring.
+// The exit code is 1 if a case failed.
+//
+// Build:
+//   g++ -std=gnu++17 -O2 -DEDROS_HOST -IHost -IInc -I<framework Inc>
+//       Src/*.cpp Host/NHost.cpp Bench/BufferTest.cpp -lpthread
+//==============================================================================
+#ifndef EDROS_HOST
+    #error "Bench/BufferTest.cpp: host builds only (-DEDROS_HOST)"
+#endif
+
+#include "System.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+#define __TEST_MESSAGE 				((uint32_t) 0x00000400)
+#define __TEST_FORWARD 				((uint32_t) 0x00000401)
+#define __TEST_VECTOR 				((uint32_t) NV_LAST)
+#define __TEST_IRQ 					((uint32_t) (16 + __SYS_MAX_VECTORS - 1))
+
+//------------------------------------------------------------------------------
+class TestComponent : public NComponent{
+    public:
+        volatile uint32_t notified;
+        volatile uint32_t callbacks;
+        volatile bool readable;             // the block was valid in every notification
+        bool forward;
+
+        TestComponent(){ notified = 0L; callbacks = 0L; readable = true; forward = false; Priority = nLow;}
+
+        void Notify(NMESSAGE* Msg){
+            if(Msg->message == __TEST_MESSAGE){
+                notified = notified + 1L;
+                if(SYS->GetBuffer(Msg->tag) == NULL){ readable = false;}
+            }
+            Msg->message = NM_NULL;
+        }
+
+        void InterruptCallBack(NMESSAGE* Msg){
+            callbacks = callbacks + 1L;
+            if(SYS->GetBuffer(Msg->tag) == NULL){ readable = false;}
+            // forwarded once, with the same block
+            if(forward && (Msg->message == __TEST_MESSAGE)){ Msg->message = __TEST_FORWARD;}
+            else Msg->message = NM_NULL;
+        }
+};
+
+//------------------------------------------------------------------------------
+static TestComponent testComponent;
+static NMESSAGE testInterrupt;
+static uint32_t testFailures = 0L;
+
+static void TestIrq(){
+    SYS->DispatchBuffer(&testInterrupt);
+}
+
+static uint32_t Used(){
+    NBUFFERSTATS stats;
+    SYS->GetBufferStats(&stats);
+    return(stats.used);
+}
+
+static void Check(const char* name, bool passed){
+    if(!passed){ testFailures++;}
+    fprintf(stderr, "%-10s %s\n", name, passed? "ok" : "FAILED");
+}
+
+static bool Notified(void* context){
+    return(((TestComponent*)context)->notified > 0L);
+}
+
+// a filled block, with its handle
+static uint32_t NewBlock(){
+    uint32_t* data = (uint32_t*)SYS->AllocateBuffer();
+    if(data == NULL){ return(__SYS_BUFFER_NONE);}
+    data[0] = 0x5A5A5A5A;
+    return(SYS->GetBufferHandle(data));
+}
+
+//------------------------------------------------------------------------------
+// DispatchBuffer from the emulated interrupt, to an owner of the given priority
+static bool Interrupt(NPRIORITY priority, bool forward){
+    testComponent.Priority = priority;
+    testComponent.forward = forward;
+    testComponent.callbacks = 0L;
+    testComponent.notified = 0L;
+    testComponent.readable = true;
+
+    uint32_t handle = NewBlock();
+    testInterrupt.message = __TEST_MESSAGE;
+    testInterrupt.data1 = __TEST_VECTOR;
+    testInterrupt.data2 = 0L;
+    testInterrupt.tag = handle;
+    NPortRaise(__TEST_IRQ);
+    if(priority == nLow){ SYS->WaitFor(Notified, &testComponent, 100);}
+
+    uint32_t expected = forward? 2L : 1L;
+    uint32_t got = (priority == nLow)? testComponent.notified : testComponent.callbacks;
+    return((handle != __SYS_BUFFER_NONE)&&(got == expected)&&testComponent.readable&&(Used() == 0L));
+}
+
+//------------------------------------------------------------------------------
+void ApplicationCreate(){
+    SYS->IncludeComponent(&testComponent);
+    HANDLE previous = SYS->InstallCallback(&testComponent, (NV_ID)__TEST_VECTOR);
+    NPortSetVector(__TEST_IRQ, TestIrq);
+    NHostSetPriority(__TEST_IRQ, 2L);
+
+    //-----------------------------------------
+    // plain message: the tag is only data
+    {
+        uint32_t handle = NewBlock();
+        NMESSAGE Msg = { __TEST_MESSAGE, 0L, 0L, handle};
+        testComponent.notified = 0L;
+        SYS->PostMessage(&Msg, __SYS_QUEUE_STANDARD);
+        SYS->WaitFor(Notified, &testComponent, 100);
+        Check("plain", (testComponent.notified == 1L)&&(Used() == 1L)&&(SYS->GetBuffer(handle) != NULL));
+        SYS->ReleaseBuffer(handle);
+    }
+
+    //-----------------------------------------
+    Check("critical", Interrupt(nTimeCritical, false));
+    Check("callback", Interrupt(nNormal, false));
+    Check("forward", Interrupt(nNormal, true));
+    Check("queued", Interrupt(nLow, false));
+
+    //-----------------------------------------
+    {
+        testComponent.notified = 0L;
+        testComponent.readable = true;
+        NMESSAGE Msg = { __TEST_MESSAGE, 0L, 0L, NewBlock()};
+        SYS->PostBuffer(&Msg, __SYS_QUEUE_STANDARD);
+        SYS->WaitFor(Notified, &testComponent, 100);
+        bool posted = (testComponent.notified == 1L)&&testComponent.readable&&(Used() == 0L);
+
+        testComponent.notified = 0L;
+        Msg.tag = NewBlock();
+        SYS->SendBuffer(&Msg, &testComponent, __SYS_QUEUE_STANDARD);
+        SYS->WaitFor(Notified, &testComponent, 100);
+        Check("posted", posted && (testComponent.notified == 1L)&&testComponent.readable&&(Used() == 0L));
+    }
+
+    //-----------------------------------------
+    // discarded: unregistered destination, callback ring full (PendSV masked)
+    {
+        TestComponent stranger;
+        NMESSAGE Msg = { __TEST_MESSAGE, 0L, 0L, NewBlock()};
+        bool sent = SYS->SendBuffer(&Msg, &stranger, __SYS_QUEUE_STANDARD);
+        bool stray = (!sent)&&(Used() == 0L);
+
+        testComponent.Priority = nNormal;
+        testComponent.forward = false;
+        testComponent.callbacks = 0L;
+        uint32_t blocks = __SYS_STANDARD_CALLBACKS + 2L;
+        __disable_irq();
+        for(uint32_t i=0L; i<blocks; i++){
+            NMESSAGE Irq = { __TEST_MESSAGE, __TEST_VECTOR, i, NewBlock()};
+            if(Irq.tag != __SYS_BUFFER_NONE){ SYS->DispatchBuffer(&Irq);}
+        }
+        __enable_irq();
+        Check("discarded", stray && (testComponent.callbacks > 0L)&&(Used() == 0L));
+    }
+
+    //-----------------------------------------
+    SYS->InstallCallback(previous, (NV_ID)__TEST_VECTOR);
+    SYS->ExcludeComponent(&testComponent);
+    exit((testFailures == 0L)? 0 : 1);
+}
+
+//==============================================================================
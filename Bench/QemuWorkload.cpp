@@ -0,0 +1,269 @@
+//==============================================================================
+// EDROS kernel benchmarks (Cortex-M3 under QEMU, see Qemu/NQemu.h)
+//------------------------------------------------------------------------------
+// Fixed workload through the kernel entry points of the target, measured in
+// instructions with the virtual clock of "-icount" (SysTick free running, without
+// its interrupt, during each measurement):
+// - target.heartbeat: SysTick exception (pended by software) and
+//   EDROS_SysTick_Handler, against the number of armed timers.
+// - target.dispatch: System::Dispatch of an interrupt message from thread mode,
+//   per priority class: critical (InterruptCallBack at once) and callback
+//   (EDROS_PendSV_Handler, taken as soon as it is pended).
+// - target.execute: queued messages, sent and dispatched by System::Execute,
+//   per number of messages sent at once.
+// The results are written to the QEMU console as JSON (same format as
+// Bench/Benchmark.cpp, with "insns_per_op"); "ns_per_op" is the instruction
+// count at the board clock, one instruction per cycle (a lower bound).
+// tools/edros_qemu.py builds, runs and compares them.
+//==============================================================================
+#ifndef EDROS_QEMU
+    #error "Bench/QemuWorkload.cpp: QEMU builds only (-DEDROS_QEMU)"
+#endif
+
+#include "System.h"
+#include "NQemu.h"
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+#define __BENCH_VERSION 			((uint32_t) 1)
+#define __BENCH_OPS 				((uint32_t) 256)
+#define __BENCH_ROUNDS 				((uint32_t) 64)
+#define __BENCH_TIMERS 				((uint32_t) 16)
+#define __BENCH_MESSAGE 			((uint32_t) 0x00000400)
+#define __BENCH_NEXT 				((uint32_t) 0x00000401)
+
+//------------------------------------------------------------------------------
+class BenchDriver : public NComponent{
+    public:
+        BenchDriver(){ Priority = nLow;}
+        void Notify(NMESSAGE* Msg);
+};
+
+class BenchSink : public NComponent{
+    public:
+        uint32_t received, expected, rounds, total;
+
+        BenchSink(){ Priority = nLow; received = expected = rounds = total = 0L;}
+        void Notify(NMESSAGE* Msg);
+        void InterruptCallBack(NMESSAGE* Msg){ received++; Msg->message = NM_NULL;}
+};
+
+//------------------------------------------------------------------------------
+static BenchDriver* benchDriver;
+static BenchSink* benchSink;
+static const NV_ID benchVector = (NV_ID)(__SYS_MAX_VECTORS - 1);
+static uint32_t benchStep = 0L;
+static uint32_t benchDepth = 0L;
+static uint32_t benchStart = 0L;
+static uint32_t benchOverhead = 0L;
+static uint32_t benchLoad = 0L;
+static bool benchFirst = true;
+
+//------------------------------------------------------------------------------
+// virtual clock: SysTick without its interrupt (the kernel tick is stopped)
+static void ClockStart(){
+    SYS->Halt();
+    benchLoad = NPortTickGetLoad();
+    NPortTickSetLoad(__SYS_TICK_RELOAD_MAX);
+    NPortTickClear();
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+static uint32_t ClockRead(){ return(NPortTickCount());}
+
+static void ClockStop(){
+    SYS->Halt();
+    NPortTickSetLoad(benchLoad);
+    NPortTickClear();
+    SYS->Resume();
+}
+
+// SysTick counts down, at SystemCoreClock of virtual time
+static uint64_t Instructions(uint32_t t0, uint32_t t1){
+    uint32_t ticks = (t0 - t1) & __SYS_TICK_RELOAD_MAX;
+    ticks = (ticks > benchOverhead)? (ticks - benchOverhead) : 0L;
+    uint64_t ns = ((uint64_t)ticks * 1000000000ULL) / SystemCoreClock;
+    return(ns >> __SYS_QEMU_ICOUNT_SHIFT);
+}
+
+// cost of a pair of clock readings, subtracted from each measurement
+static void Calibrate(){
+    ClockStart();
+    uint32_t t0 = ClockRead();
+    uint32_t t1 = ClockRead();
+    ClockStop();
+    benchOverhead = (t0 - t1) & __SYS_TICK_RELOAD_MAX;
+}
+
+//------------------------------------------------------------------------------
+// one JSON record: {"benchmark": ..., <parameters>, "insns_per_op": ..., "ns_per_op": ..., "ops_per_s": ...}
+static void Report(const char* benchmark, const char* parameters, uint64_t instructions, uint32_t ops){
+    char line[192];
+    if(ops == 0L){ ops = 1L;}
+    uint64_t insns = (instructions * 100ULL) / ops;                     // x100
+    uint64_t ns = (insns * 1000ULL) / (SystemCoreClock / 1000000UL);    // x100
+    uint64_t rate = (ns > 0ULL)? (100000000000ULL / ns) : 0ULL;
+
+    snprintf(line, sizeof(line), "%s\n    {\"benchmark\": \"%s\", %s, \"insns_per_op\": %lu.%02lu, "
+             "\"ns_per_op\": %lu.%02lu, \"ops_per_s\": %lu}",
+             benchFirst? "" : ",", benchmark, parameters,
+             (unsigned long)(insns / 100), (unsigned long)(insns % 100),
+             (unsigned long)(ns / 100), (unsigned long)(ns % 100), (unsigned long)rate);
+    benchFirst = false;
+    NQemuWrite(line);
+}
+
+static void Fail(const char* reason){
+    NQemuWrite("\nedros: ");
+    NQemuWrite(reason);
+    NQemuWrite("\n");
+    NQemuExit(false);
+}
+
+//------------------------------------------------------------------------------
+// target.heartbeat: SysTick exceptions pended by software (none of the timers expires)
+static void Expired(uint32_t timer, void* context){}
+
+static void BenchHeartbeat(uint32_t armed){
+    uint32_t timers[__BENCH_TIMERS];
+    char parameters[32];
+
+    ClockStart();
+    for(uint32_t i=0L; i<armed; i++){
+        timers[i] = SYS->StartTimer(Expired, NULL, __BENCH_OPS + 1000L + (i * 97L));
+    }
+    uint32_t t0 = ClockRead();
+    for(uint32_t b=0L; b<__BENCH_OPS; b++){
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+        __DSB();
+        __ISB();
+    }
+    uint32_t t1 = ClockRead();
+    for(uint32_t i=0L; i<armed; i++) SYS->CancelTimer(timers[i]);
+    ClockStop();
+
+    snprintf(parameters, sizeof(parameters), "\"timers\": %lu", (unsigned long)armed);
+    Report("target.heartbeat", parameters, Instructions(t0, t1), __BENCH_OPS);
+}
+
+//------------------------------------------------------------------------------
+// target.dispatch: routing of an interrupt message to the sink (InstallCallback)
+static void BenchDispatch(NPRIORITY priority, const char* name){
+    char parameters[32];
+    benchSink->Priority = priority;
+    benchSink->received = 0L;
+
+    ClockStart();
+    uint32_t t0 = ClockRead();
+    for(uint32_t i=0L; i<__BENCH_OPS; i++){
+        NMESSAGE Msg = { __BENCH_MESSAGE, (uint32_t)benchVector, i, 0L};
+        SYS->Dispatch(&Msg);
+    }
+    uint32_t t1 = ClockRead();
+    ClockStop();
+    benchSink->Priority = nLow;
+    if(benchSink->received != __BENCH_OPS){ Fail("target.dispatch: messages lost");}
+
+    snprintf(parameters, sizeof(parameters), "\"class\": \"%s\"", name);
+    Report("target.dispatch", parameters, Instructions(t0, t1), __BENCH_OPS);
+}
+
+//------------------------------------------------------------------------------
+// target.execute: "depth" messages sent to the sink, the next ones once it received them
+static uint32_t Send(){
+    uint32_t accepted = 0L;
+    for(uint32_t i=0L; i<benchDepth; i++){
+        NMESSAGE Msg = { __BENCH_MESSAGE, i, 0L, 0L};
+        if(SYS->SendMessage(&Msg, benchSink)){ accepted++;}
+    }
+    return(accepted);
+}
+
+static void StartExecute(uint32_t depth){
+    benchDepth = depth;
+    benchSink->received = 0L;
+    benchSink->rounds = 0L;
+    benchSink->total = 0L;
+
+    ClockStart();
+    benchStart = ClockRead();
+    benchSink->expected = Send();
+    if(benchSink->expected == 0L){ Fail("target.execute: queue full");}
+}
+
+void BenchSink::Notify(NMESSAGE* Msg){
+    if(Msg->message == __BENCH_MESSAGE){
+        total++;
+        if(++received >= expected){
+            received = 0L;
+            if(++rounds < __BENCH_ROUNDS){
+                expected = Send();
+                if(expected == 0L){ Fail("target.execute: queue full");}
+            } else {
+                uint32_t t1 = ClockRead();
+                ClockStop();
+                char parameters[32];
+                snprintf(parameters, sizeof(parameters), "\"depth\": %lu", (unsigned long)benchDepth);
+                Report("target.execute", parameters, Instructions(benchStart, t1), total);
+
+                NMESSAGE Next = { __BENCH_NEXT, 0L, 0L, 0L};
+                SYS->SendMessage(&Next, benchDriver);
+            }
+        }
+    }
+    Msg->message = NM_NULL;
+}
+
+//------------------------------------------------------------------------------
+// steps, run by System::Execute: the synchronous benchmarks, then target.execute per depth
+void BenchDriver::Notify(NMESSAGE* Msg){
+    static const uint32_t timers[] = { 0, 1, __BENCH_TIMERS};
+    static const uint32_t depths[] = { 1, __SYS_STANDARD_MESSAGES};
+
+    if(Msg->message == __BENCH_NEXT){
+        if(benchStep == 0L){
+            Calibrate();
+            for(uint32_t t=0L; t<3; t++){
+                if(timers[t] <= __SYS_MAX_TIMERS){ BenchHeartbeat(timers[t]);}
+            }
+            BenchDispatch(nTimeCritical, "critical");
+            BenchDispatch(nNormal, "callback");
+        }
+        if(benchStep < 2L){
+            StartExecute(depths[benchStep++]);
+        } else {
+            NQemuWrite("\n  ]\n}\n");
+            NQemuExit(true);
+        }
+    }
+    Msg->message = NM_NULL;
+}
+
+//------------------------------------------------------------------------------
+void ApplicationCreate(){
+    char line[256];
+
+    benchDriver = new BenchDriver();
+    benchSink = new BenchSink();
+    if(!SYS->FindComponent(benchDriver)){ SYS->IncludeComponent(benchDriver);}
+    if(!SYS->FindComponent(benchSink)){ SYS->IncludeComponent(benchSink);}
+    SYS->InstallCallback(benchSink, benchVector);
+
+    //-----------------------------------------
+    snprintf(line, sizeof(line), "{\n  \"suite\": \"edros-bench\", \"version\": %lu,\n"
+             "  \"config\": {\"target\": \"qemu-stm32vldiscovery\", \"icount_shift\": %lu, \"clock\": %lu, "
+             "\"priority_levels\": %lu, \"max_objects\": %lu, \"max_timers\": %lu, "
+             "\"standard_messages\": %lu, \"callbacks\": %lu},\n  \"results\": [",
+             (unsigned long)__BENCH_VERSION, (unsigned long)__SYS_QEMU_ICOUNT_SHIFT,
+             (unsigned long)SystemCoreClock, (unsigned long)__SYS_PRIORITY_LEVELS,
+             (unsigned long)__SYS_MAX_OBJECTS, (unsigned long)__SYS_MAX_TIMERS,
+             (unsigned long)__SYS_STANDARD_MESSAGES, (unsigned long)__SYS_STANDARD_CALLBACKS);
+    NQemuWrite(line);
+
+    //-----------------------------------------
+    // the benchmarks start once System::Execute runs
+    NMESSAGE Msg = { __BENCH_NEXT, 0L, 0L, 0L};
+    SYS->SendMessage(&Msg, benchDriver);
+}
+
+//==============================================================================
@@ -0,0 +1,292 @@
+//==============================================================================
+// EDROS message ring: multi-producer stress test and NFifo comparison (Linux host port)
+//------------------------------------------------------------------------------
+// - ring.stress: producers on host threads (truly concurrent, NAtomic on
+//   std::atomic) and an emulated interrupt preempting the consumer insert into one
+//   NMessageRing while the core extracts. Each producer numbers its messages: the
+//   consumer checks that none is lost, duplicated or reordered. Run once with the
+//   nDropNewest policy (the threads retry when the ring is full) and once with
+//   nSpillReserve (nothing retried: received + drops must match the messages sent).
+// - ring.throughput: Put/Get pairs on a single core, NMessageRing against the NFifo
+//   queue used before it (raw, and inside a PRIMASK critical section, which is what
+//   a queue shared with interrupts needs).
+// Results are written as JSON records, as by Bench/Benchmark.cpp (compared with
+// tools/edros_bench.py); the exit code is 1 if the stress test found an error.
+//
+// Build (the framework sources provide NFifo):
+//   g++ -std=gnu++17 -O2 -DEDROS_HOST -IHost -IInc -I<framework Inc>
+//       Src/*.cpp Host/NHost.cpp Bench/RingStress.cpp <framework NFifo.cpp> -lpthread
+// Environment:
+//   EDROS_BENCH_OUTPUT  JSON file (default: standard output)
+//   EDROS_BENCH_SCALE   run length multiplier (default: 1)
+//==============================================================================
+#ifndef EDROS_HOST
+    #error "Bench/RingStress.cpp: host builds only (-DEDROS_HOST)"
+#endif
+
+#include "System.h"
+#include "NFifo.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+#define __STRESS_VERSION 			((uint32_t) 1)
+#define __STRESS_SAMPLES 			((uint32_t) 5)
+#define __STRESS_THREADS 			((uint32_t) 4)
+#define __STRESS_MESSAGES 			((uint32_t) 20000)
+#define __STRESS_BURST 				((uint32_t) 8)
+#define __STRESS_PAIRS 				((uint32_t) 65536)
+#define __STRESS_DEPTH 				((uint32_t) 64)
+#define __STRESS_RESERVE 			((uint32_t) 8)
+#define __STRESS_MESSAGE 			((uint32_t) 0x00000400)
+// producers: the threads, then the emulated interrupt
+#define __STRESS_PRODUCERS 			(__STRESS_THREADS + 1)
+#define __STRESS_IRQ 				((uint32_t) (16 + __SYS_MAX_VECTORS - 1))
+
+//------------------------------------------------------------------------------
+static NStaticMessageRing<__STRESS_DEPTH> stressRing;
+static NStaticMessageReserve<__STRESS_RESERVE> stressReserve;
+static uint32_t stressScale = 1L;
+static uint32_t stressMessages;
+static volatile bool stressRetry;
+static volatile bool stressGo;
+static volatile uint32_t stressIrqSent;
+static volatile uint32_t stressIrqBursts;
+static NAtomic stressRetries;
+static FILE* stressOutput;
+static bool stressFirst = true;
+static uint32_t stressErrors = 0L;
+
+//------------------------------------------------------------------------------
+static uint64_t Now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static double Median(double* samples, uint32_t n){
+    for(uint32_t i=1L; i<n; i++){
+        double v = samples[i];
+        uint32_t j = i;
+        while((j > 0L)&&(samples[j - 1] > v)){ samples[j] = samples[j - 1]; j--;}
+        samples[j] = v;
+    }
+    return(samples[n / 2]);
+}
+
+//------------------------------------------------------------------------------
+// one JSON record: {"benchmark": ..., <parameters>, "ns_per_op": ..., "ops_per_s": ...}
+static void Report(const char* benchmark, const char* parameters, double ns){
+    fprintf(stressOutput, "%s\n    {\"benchmark\": \"%s\", %s, \"ns_per_op\": %.2f, \"ops_per_s\": %.0f}",
+            stressFirst? "" : ",", benchmark, parameters, ns, (ns > 0.0)? (1e9 / ns) : 0.0);
+    stressFirst = false;
+    fprintf(stderr, "%-18s %-48s %10.1f ns\n", benchmark, parameters, ns);
+}
+
+static void Error(const char* format, uint32_t a, uint32_t b, uint32_t c){
+    if(stressErrors++ < 10L){
+        fprintf(stderr, "ring.stress: ");
+        fprintf(stderr, format, (unsigned)a, (unsigned)b, (unsigned)c);
+        fprintf(stderr, "\n");
+    }
+}
+
+//------------------------------------------------------------------------------
+// message "n" of "producer": data1 = producer, data2 = n
+static void* Producer(void* argument){
+    uint32_t producer = (uint32_t)(uintptr_t)argument;
+    while(!stressGo) sched_yield();
+    for(uint32_t n=0L; n<stressMessages; n++){
+        NMESSAGE Msg = { __STRESS_MESSAGE, producer, n, 0L};
+        // a failed Put counts as a drop in the ring statistics
+        while(!stressRing.Put(&Msg) && stressRetry){ stressRetries.FetchAdd(1L); sched_yield();}
+        // bursts: the consumer also runs on single-core hosts
+        if((n % __STRESS_BURST) == (__STRESS_BURST - 1L)){ sched_yield();}
+    }
+    return(NULL);
+}
+
+// interrupt producer: a burst per raise, never retried (it may preempt the consumer)
+static void StressInterrupt(){
+    for(uint32_t i=0L; i<__STRESS_BURST; i++){
+        NMESSAGE Msg = { __STRESS_MESSAGE, __STRESS_THREADS, stressIrqSent, 0L};
+        stressRing.Put(&Msg);
+        stressIrqSent = stressIrqSent + 1L;
+    }
+    stressIrqBursts = stressIrqBursts + 1L;
+}
+
+static void* Raiser(void* argument){
+    (void)argument;
+    while(!stressGo) sched_yield();
+    uint32_t bursts = stressMessages / (__STRESS_BURST * 16L);
+    for(uint32_t b=0L; b<bursts; b++){
+        uint32_t done = stressIrqBursts;
+        NPortRaise(__STRESS_IRQ);
+        while(stressIrqBursts == done) sched_yield();
+    }
+    return(NULL);
+}
+
+//------------------------------------------------------------------------------
+static void Stress(NOVERFLOW policy){
+    static const char* const policies[] = { "drop_newest", "drop_oldest", "spill_reserve"};
+    uint32_t next[__STRESS_PRODUCERS], received = 0L;
+    pthread_t threads[__STRESS_PRODUCERS];
+    bool joined[__STRESS_PRODUCERS];
+    NQUEUESTATS before, after;
+
+    //-----------------------------------------
+    memset(next, 0, sizeof(next));
+    memset(joined, 0, sizeof(joined));
+    stressRing.SetOverflow(policy, &stressReserve);
+    stressRetry = (policy == nDropNewest);
+    stressIrqSent = 0L; stressIrqBursts = 0L; stressGo = false;
+    stressRetries.Store(0L);
+    stressRing.GetStats(&before);
+    for(uint32_t p=0L; p<__STRESS_THREADS; p++){
+        pthread_create(&threads[p], NULL, Producer, (void*)(uintptr_t)p);
+    }
+    pthread_create(&threads[__STRESS_THREADS], NULL, Raiser, NULL);
+
+    //-----------------------------------------
+    // consumer: the core, in thread mode (preempted by the interrupt producer)
+    uint64_t t0 = Now();
+    stressGo = true;
+    uint32_t finished = 0L;
+    while(finished < 2L){
+        NMESSAGE Msg;
+        if(!stressRing.Get(&Msg)){
+            // the producers are done once the ring stays empty after they joined
+            if(finished == 0L){
+                bool alive = false;
+                for(uint32_t p=0L; p<__STRESS_PRODUCERS; p++){
+                    if(!joined[p]){ joined[p] = (pthread_tryjoin_np(threads[p], NULL) == 0);}
+                    if(!joined[p]){ alive = true;}
+                }
+                if(!alive){ finished = 1L;}
+            } else finished = 2L;
+            continue;
+        }
+        received++;
+        uint32_t p = Msg.data1;
+        if((Msg.message != __STRESS_MESSAGE)||(p >= __STRESS_PRODUCERS)){
+            Error("foreign message 0x%08x from %u (%u)", Msg.message, p, 0L);
+            continue;
+        }
+        // the reserve is drained after the ring: spilled messages arrive late
+        if(Msg.data2 < next[p]){
+            if(policy != nSpillReserve){ Error("producer %u: message %u after %u", p, Msg.data2, next[p]);}
+        } else {
+            if((Msg.data2 > next[p])&&stressRetry&&(p < __STRESS_THREADS)){
+                Error("producer %u: messages %u to %u lost", p, next[p], Msg.data2 - 1L);
+            }
+            next[p] = Msg.data2 + 1L;
+        }
+    }
+    uint64_t t1 = Now();
+
+    //-----------------------------------------
+    stressRing.GetStats(&after);
+    uint32_t sent = (stressMessages * __STRESS_THREADS) + stressIrqSent;
+    uint32_t drops = after.drops - before.drops - stressRetries.Load();
+    if((received + drops) != sent){ Error("%u sent, %u received, %u dropped", sent, received, drops);}
+    if(stressRetry){
+        for(uint32_t p=0L; p<__STRESS_THREADS; p++){
+            if(next[p] != stressMessages){ Error("producer %u: %u of %u received", p, next[p], stressMessages);}
+        }
+    }
+
+    char parameters[64];
+    snprintf(parameters, sizeof(parameters), "\"producers\": %u, \"policy\": \"%s\"",
+             (unsigned)__STRESS_PRODUCERS, policies[policy]);
+    fprintf(stderr, "ring.stress        %u sent, %u received, %u dropped\n", (unsigned)sent, (unsigned)received, (unsigned)drops);
+    Report("ring.stress", parameters, (double)(t1 - t0) / ((received > 0L)? received : 1L));
+}
+
+//------------------------------------------------------------------------------
+// ring.throughput: "depth" messages inserted, then extracted
+enum{ kRing, kFifo, kFifoLocked};
+static const char* const stressQueues[] = { "ring", "fifo", "fifo_locked"};
+
+static void Throughput(uint32_t queue, uint32_t depth){
+    static NFifo fifo(sizeof(NMESSAGE), __STRESS_DEPTH);
+    double samples[__STRESS_SAMPLES];
+    uint32_t rounds = (__STRESS_PAIRS * stressScale) / depth;
+    NMESSAGE Msg = { __STRESS_MESSAGE, 0L, 0L, 0L}, Out;
+    uint32_t sink = 0L;
+
+    stressRing.SetOverflow(nDropNewest, NULL);
+    for(uint32_t s=0L; s<__STRESS_SAMPLES; s++){
+        uint64_t t0 = Now();
+        for(uint32_t r=0L; r<rounds; r++){
+            for(uint32_t i=0L; i<depth; i++){
+                Msg.data2 = i;
+                if(queue == kRing){ stressRing.Put(&Msg);}
+                else if(queue == kFifo){ fifo.Put((uint8_t*)&Msg, sizeof(NMESSAGE));}
+                else {
+                    uint32_t primask = __get_PRIMASK();
+                    __disable_irq();
+                    fifo.Put((uint8_t*)&Msg, sizeof(NMESSAGE));
+                    __set_PRIMASK(primask);
+                }
+            }
+            for(uint32_t i=0L; i<depth; i++){
+                if(queue == kRing){ stressRing.Get(&Out);}
+                else if(queue == kFifo){ fifo.Get((uint8_t*)&Out);}
+                else {
+                    uint32_t primask = __get_PRIMASK();
+                    __disable_irq();
+                    fifo.Get((uint8_t*)&Out);
+                    __set_PRIMASK(primask);
+                }
+                sink += Out.data2;
+            }
+        }
+        uint64_t t1 = Now();
+        samples[s] = (double)(t1 - t0) / ((double)rounds * depth);
+    }
+    (void)sink;
+
+    char parameters[48];
+    snprintf(parameters, sizeof(parameters), "\"queue\": \"%s\", \"depth\": %u", stressQueues[queue], (unsigned)depth);
+    Report("ring.throughput", parameters, Median(samples, __STRESS_SAMPLES));
+}
+
+//------------------------------------------------------------------------------
+void ApplicationCreate(){
+    static const uint32_t depths[] = { 1, 16, __STRESS_DEPTH};
+
+    //-----------------------------------------
+    const char* scale = getenv("EDROS_BENCH_SCALE");
+    if((scale != NULL)&&(atoi(scale) > 0)){ stressScale = (uint32_t)atoi(scale);}
+    const char* path = getenv("EDROS_BENCH_OUTPUT");
+    stressOutput = (path != NULL)? fopen(path, "w") : stdout;
+    if(stressOutput == NULL){ perror(path); exit(1);}
+    stressMessages = __STRESS_MESSAGES * stressScale;
+    NPortSetVector(__STRESS_IRQ, StressInterrupt);
+    NHostSetPriority(__STRESS_IRQ, 2L);
+
+    fprintf(stressOutput, "{\n  \"suite\": \"edros-bench\", \"version\": %u,\n", (unsigned)__STRESS_VERSION);
+    fprintf(stressOutput, "  \"config\": {\"depth\": %u, \"reserve\": %u, \"threads\": %u},\n",
+            (unsigned)__STRESS_DEPTH, (unsigned)__STRESS_RESERVE, (unsigned)__STRESS_THREADS);
+    fprintf(stressOutput, "  \"results\": [");
+
+    //-----------------------------------------
+    Stress(nDropNewest);
+    Stress(nSpillReserve);
+    for(uint32_t d=0L; d<3; d++){
+        for(uint32_t q=kRing; q<=kFifoLocked; q++) Throughput(q, depths[d]);
+    }
+
+    //-----------------------------------------
+    fprintf(stressOutput, "\n  ],\n  \"errors\": %u\n}\n", (unsigned)stressErrors);
+    if(stressOutput != stdout){ fclose(stressOutput);}
+    exit((stressErrors == 0L)? 0 : 1);
+}
+
+//==============================================================================
@@ -0,0 +1,164 @@
+//==============================================================================
+// EDROS timing wheel: expiration test (Linux host port)
+//------------------------------------------------------------------------------
+// Drives a private NTimerWheel one tick at a time and checks when its timers
+// expire, around the 64 ticks of a level 0 revolution (__SYS_WHEEL_SLOTS):
+// - period: periodic timers of 1, 63, 64 and 65 ticks expire once per period
+//   (a 64-tick period used to land back in the slot being processed).
+// - restart: a one-shot of 64 ticks started by a callback expires 64 ticks later.
+// - cancel: a callback cancels a timer expiring on the same tick.
+// - range: one-shots across the cascade of the upper levels.
+// The exit code is 1 if a case failed.
+//
+// Build:
+//   g++ -std=gnu++17 -O2 -DEDROS_HOST -IHost -IInc -I<framework Inc>
+//       Src/*.cpp Host/NHost.cpp Bench/TimerTest.cpp -lpthread
+//==============================================================================
+#ifndef EDROS_HOST
+    #error "Bench/TimerTest.cpp: host builds only (-DEDROS_HOST)"
+#endif
+
+#include "System.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+#define __TEST_REVOLUTIONS 			((uint32_t) 10)
+// expirations in a single tick beyond which a timer is considered looping
+#define __TEST_LOOPING 				((uint32_t) 1000)
+
+//------------------------------------------------------------------------------
+struct TESTTIMER{
+    NTimerWheel* wheel;
+    uint32_t expired;                   // expirations
+    uint32_t first;                     // tick of the first expiration
+    uint32_t last;                      // tick of the last expiration
+    uint32_t delay;                     // Restart: one-shot started on expiration
+    uint32_t restarted;                 // Restart: tick of that start
+    uint32_t cancel;                    // Cancel: timer cancelled on expiration
+};
+
+static uint32_t testTick;               // ticks advanced so far
+static uint32_t testBurst;              // expirations in the current tick
+static uint32_t testFailures = 0L;
+
+static void Check(const char* name, bool passed){
+    if(!passed){ testFailures++;}
+    fprintf(stderr, "%-10s %s\n", name, passed? "ok" : "FAILED");
+}
+
+static void Reset(TESTTIMER* t, NTimerWheel* wheel){
+    t->wheel = wheel;
+    t->expired = t->first = t->last = 0L;
+    t->delay = t->restarted = 0L;
+    t->cancel = __SYS_TIMER_NONE;
+}
+
+//------------------------------------------------------------------------------
+// counts the expiration; a timer looping within one tick cancels itself
+static void Expired(uint32_t timer, void* context){
+    TESTTIMER* t = (TESTTIMER*)context;
+    if(t->expired == 0L){ t->first = testTick;}
+    t->expired++;
+    t->last = testTick;
+    if(++testBurst > __TEST_LOOPING){ t->wheel->Cancel(timer);}
+}
+
+static void Restart(uint32_t timer, void* context){
+    TESTTIMER* t = (TESTTIMER*)context;
+    Expired(timer, context);
+    if(t->delay > 0L){
+        t->restarted = testTick;
+        t->wheel->StartCallback(Expired, t, t->delay, 0L);
+        t->delay = 0L;
+    }
+}
+
+static void Cancel(uint32_t timer, void* context){
+    TESTTIMER* t = (TESTTIMER*)context;
+    Expired(timer, context);
+    if(t->cancel != __SYS_TIMER_NONE){ t->wheel->Cancel(t->cancel);}
+}
+
+// one tick at a time: "testTick" is the number of the tick being processed
+static void Run(NTimerWheel* wheel, uint32_t ticks){
+    while(ticks-- > 0L){
+        testTick++;
+        testBurst = 0L;
+        wheel->Advance(1);
+    }
+}
+
+//------------------------------------------------------------------------------
+void ApplicationCreate(){
+    //-----------------------------------------
+    // period: one expiration per period, the first after one period
+    {
+        static const uint32_t periods[] = { 1, __SYS_WHEEL_SLOTS - 1, __SYS_WHEEL_SLOTS, __SYS_WHEEL_SLOTS + 1};
+        static NTimerWheel wheel;
+        TESTTIMER t[4];
+        testTick = 0L;
+        for(uint32_t i=0L; i<4; i++){
+            Reset(&t[i], &wheel);
+            wheel.StartCallback(Expired, &t[i], periods[i], periods[i]);
+        }
+        uint32_t ticks = __TEST_REVOLUTIONS * __SYS_WHEEL_SLOTS;
+        Run(&wheel, ticks);
+
+        bool passed = true;
+        for(uint32_t i=0L; i<4; i++){
+            if((t[i].expired != (ticks / periods[i]))||(t[i].first != periods[i])){ passed = false;}
+        }
+        Check("period", passed);
+    }
+
+    //-----------------------------------------
+    // restart: started by a callback on tick 5, expires on tick 5 + 64
+    {
+        static NTimerWheel wheel;
+        TESTTIMER t;
+        testTick = 0L;
+        Reset(&t, &wheel);
+        t.delay = __SYS_WHEEL_SLOTS;
+        wheel.StartCallback(Restart, &t, 5, 0L);
+        Run(&wheel, 4 * __SYS_WHEEL_SLOTS);
+        Check("restart", (t.expired == 2L)&&(t.restarted == 5L)&&(t.last == 5L + __SYS_WHEEL_SLOTS));
+    }
+
+    //-----------------------------------------
+    // cancel: both timers expire on tick 64; whichever runs first cancels the other
+    {
+        static NTimerWheel wheel;
+        TESTTIMER a, b;
+        testTick = 0L;
+        Reset(&a, &wheel); Reset(&b, &wheel);
+        a.cancel = wheel.StartCallback(Cancel, &b, __SYS_WHEEL_SLOTS, 0L);
+        b.cancel = wheel.StartCallback(Cancel, &a, __SYS_WHEEL_SLOTS, 0L);
+        Run(&wheel, 2 * __SYS_WHEEL_SLOTS);
+        Check("cancel", ((a.expired + b.expired) == 1L)&&(wheel.NextExpiration(0xFFFFFFFF) == 0xFFFFFFFF));
+    }
+
+    //-----------------------------------------
+    // range: one-shots of the upper levels expire on time
+    {
+        static const uint32_t delays[] = { 4095, 4096, 4097, 70000};
+        static NTimerWheel wheel;
+        TESTTIMER t[4];
+        testTick = 0L;
+        for(uint32_t i=0L; i<4; i++){
+            Reset(&t[i], &wheel);
+            wheel.StartCallback(Expired, &t[i], delays[i], 0L);
+        }
+        Run(&wheel, 71000);
+
+        bool passed = true;
+        for(uint32_t i=0L; i<4; i++){
+            if((t[i].expired != 1L)||(t[i].first != delays[i])){ passed = false;}
+        }
+        Check("range", passed);
+    }
+
+    exit((testFailures == 0L)? 0 : 1);
+}
+
+//==============================================================================
@@ -0,0 +1,112 @@
+//==============================================================================
+/**
+ * @file DRV_CPU.h
+ * @brief EDROS Linux host port: CPU driver\n
+ * Replaces the target DRV_CPU.h in host builds (-DEDROS_HOST, this directory first
+ * in the include path): the CMSIS intrinsics and NVIC functions used by the kernel,
+ * mapped onto the emulated core of Host/NHost.cpp.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef DRV_CPU_H
+    #define DRV_CPU_H
+
+#ifndef EDROS_HOST
+    #error "Host/DRV_CPU.h: host builds only (-DEDROS_HOST)"
+#endif
+
+    #include <stdint.h>
+    #include <atomic>
+
+#ifndef __IO
+    #define __IO volatile
+#endif
+
+//------------------------------------------------------------------------------
+// emulated core clock (Hz): SysTick counts at this rate
+#ifndef __SYS_HOST_CLOCK
+	#define __SYS_HOST_CLOCK 			((uint32_t) 72000000)
+#endif
+
+//------------------------------------------------------------------------------
+// emulated core (Host/NHost.cpp)
+uint32_t NHostGetPrimask();
+void NHostSetPrimask(uint32_t primask);
+uint32_t NHostActive();
+void NHostWaitForInterrupt();
+void NHostSetPriority(uint32_t exception, uint32_t priority);
+uint32_t NHostTickConfig(uint32_t ticks);
+
+extern uint32_t SystemCoreClock;
+
+//------------------------------------------------------------------------------
+// core exceptions (CMSIS numbering: exception number - 16)
+typedef enum{
+    NonMaskableInt_IRQn     = -14,
+    MemoryManagement_IRQn   = -12,
+    BusFault_IRQn           = -11,
+    UsageFault_IRQn         = -10,
+    SVCall_IRQn             = -5,
+    DebugMonitor_IRQn       = -4,
+    PendSV_IRQn             = -2,
+    SysTick_IRQn            = -1
+} IRQn_Type;
+
+#define NVIC_PriorityGroup_4        ((uint32_t) 0x300)
+#define __NVIC_PRIO_BITS            4
+
+//------------------------------------------------------------------------------
+static inline void __disable_irq(){ NHostSetPrimask(1L);}
+static inline void __enable_irq(){ NHostSetPrimask(0L);}
+static inline uint32_t __get_PRIMASK(){ return(NHostGetPrimask());}
+static inline void __set_PRIMASK(uint32_t primask){ NHostSetPrimask(primask);}
+static inline uint32_t __get_IPSR(){ return(NHostActive());}
+
+static inline void __WFI(){ NHostWaitForInterrupt();}
+static inline void __WFE(){ NHostWaitForInterrupt();}
+static inline void __DSB(){ std::atomic_thread_fence(std::memory_order_seq_cst);}
+static inline void __DMB(){ std::atomic_thread_fence(std::memory_order_seq_cst);}
+static inline void __ISB(){ std::atomic_signal_fence(std::memory_order_seq_cst);}
+static inline void __NOP(){}
+
+static inline uint8_t __CLZ(uint32_t value){ return((value != 0L)? (uint8_t)__builtin_clz(value) : 32);}
+static inline uint32_t __RBIT(uint32_t value){
+    value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+    value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+    value = ((value >> 4) & 0x0F0F0F0F) | ((value & 0x0F0F0F0F) << 4);
+    return(__builtin_bswap32(value));
+}
+
+//------------------------------------------------------------------------------
+static inline void NVIC_SetPriorityGrouping(uint32_t group){ (void)group;}
+static inline uint32_t NVIC_EncodePriority(uint32_t group, uint32_t preempt, uint32_t sub){
+    (void)group; (void)sub;
+    return(preempt);
+}
+static inline void NVIC_SetPriority(IRQn_Type irq, uint32_t priority){ NHostSetPriority((uint32_t)((int32_t)irq + 16), priority);}
+static inline uint32_t SysTick_Config(uint32_t ticks){ return(NHostTickConfig(ticks));}
+
+//------------------------------------------------------------------------------
+// clock and watchdog: nothing to do on the host
+enum{ Pll_Hsi, Pll_Hse};
+enum{ Pll16MHz, Pll32MHz, Pll36MHz, Pll72MHz};
+
+static inline void SystemCoreClockUpdate(){}
+static inline void CPU_StartHSI(){}
+static inline void CPU_StartHSE(){}
+static inline void CPU_StartPLL(uint32_t source, uint32_t frequency){ (void)source; (void)frequency;}
+static inline void CPU_KickWatchdog(){}
+
+#endif
+//==============================================================================
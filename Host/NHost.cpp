@@ -0,0 +1,447 @@
+//==============================================================================
+// EDROS Linux host port: emulated Cortex-M3 core (see NPort.h)
+//------------------------------------------------------------------------------
+// - The core is the thread that called NPortInitialize (main): the kernel and the
+//   application run there, in thread mode or in an exception handler.
+// - NVIC: pending exceptions are kept in a bitmap. A pending exception preempts the
+//   core when PRIMASK is clear and its priority is higher than the running one:
+//   other host threads (SysTick, simulated peripherals) signal the core, which takes
+//   it in the signal handler; the core itself takes it as soon as it unmasks.
+// - SysTick: down counter at __SYS_HOST_CLOCK, run by a timer thread from the host
+//   monotonic clock (LOAD, VAL and COUNTFLAG behave as on the target).
+// - Threads: ucontext, switched by the PendSV handler.
+// - Simulated peripherals: NPortSetVector installs the handler, NHostSetPriority its
+//   priority, and any host thread calls NPortRaise to interrupt the kernel.
+//
+// Build (this directory first, so that Host/DRV_CPU.h replaces the target driver):
+//   g++ -std=gnu++17 -DEDROS_HOST -IHost -IInc -I<framework Inc>
+//       Src/*.cpp Host/NHost.cpp <application> -lpthread
+// The binary runs under gdb, perf and the sanitizers (ASan warns about ucontext
+// with -D__SYS_THREADS). System calls of the application interrupted by the
+// emulated interrupts are restarted (SA_RESTART).
+//==============================================================================
+#ifdef EDROS_HOST
+
+#include "System.h"
+#include "DRV_CPU.h"
+#include "Interrupts.h"
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// signal used to preempt the core
+#ifndef __SYS_HOST_SIGNAL
+	#define __SYS_HOST_SIGNAL 			SIGUSR2
+#endif
+
+#define __SYS_HOST_WORDS 			(__SYS_HOST_EXCEPTIONS / 32)
+#define __SYS_HOST_THREAD_MODE 		((uint32_t) 256)
+#define __SYS_HOST_PENDSV 			((uint32_t) 14)
+#define __SYS_HOST_SYSTICK 			((uint32_t) 15)
+// shortest wait of the SysTick thread while its interrupt is still pending (ns)
+#define __SYS_HOST_TICK_SLACK 		((uint64_t) 50000)
+
+extern "C" void EDROS_PendSV_Handler(void);
+extern "C" void EDROS_SysTick_Handler(void);
+
+uint32_t SystemCoreClock = __SYS_HOST_CLOCK;
+
+//------------------------------------------------------------------------------
+static pthread_t hostCore;
+static volatile bool hostStarted = false;
+static volatile sig_atomic_t hostPrimask = 0;
+static volatile uint32_t hostActive = 0L;                  // IPSR
+static volatile uint32_t hostLevel = __SYS_HOST_THREAD_MODE; // execution priority
+static std::atomic<uint32_t> hostPending[__SYS_HOST_WORDS];
+static uint8_t hostPriority[__SYS_HOST_EXCEPTIONS];
+static void (*hostVectors[__SYS_HOST_EXCEPTIONS])(void);
+
+//------------------------------------------------------------------------------
+// SysTick: the counter is "value" at "anchor" (ns), counting down while enabled
+static pthread_t hostTimer;
+static pthread_mutex_t hostTickLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hostTickChanged;
+static std::atomic<uint32_t> hostTickSequence(0);          // odd: being written
+static volatile bool hostTickEnabled = false;
+static volatile bool hostTickFlag = false;                 // COUNTFLAG
+static volatile uint32_t hostTickLoad = 0L;
+static volatile uint32_t hostTickValue = 0L;
+static volatile uint64_t hostTickAnchor = 0L;
+
+//------------------------------------------------------------------------------
+static uint64_t HostNow(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static uint64_t CyclesToNs(uint64_t cycles){ return((cycles * 1000000000ULL) / SystemCoreClock);}
+static uint64_t NsToCycles(uint64_t ns){ return((ns * SystemCoreClock) / 1000000000ULL);}
+
+static bool IsCore(){ return(hostStarted && pthread_equal(pthread_self(), hostCore));}
+
+//------------------------------------------------------------------------------
+static void Block(sigset_t* previous){
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, __SYS_HOST_SIGNAL);
+    pthread_sigmask(SIG_BLOCK, &set, previous);
+}
+
+static void Restore(const sigset_t* previous){
+    pthread_sigmask(SIG_SETMASK, previous, NULL);
+}
+
+//------------------------------------------------------------------------------
+// highest priority pending exception able to preempt the running code
+static int32_t Select(){
+    int32_t selected = -1;
+    uint32_t level = hostLevel;
+    for(uint32_t w=0L; w<__SYS_HOST_WORDS; w++){
+        uint32_t bits = hostPending[w].load();
+        while(bits != 0L){
+            uint32_t e = (w << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+            if(hostPriority[e] < level){ selected = (int32_t)e; level = hostPriority[e];}
+        }
+    }
+    return(selected);
+}
+
+//------------------------------------------------------------------------------
+// exception entry and return, for each exception able to preempt (signal blocked)
+static void Take(){
+    sigset_t unmasked, masked;
+    while(hostPrimask == 0){
+        int32_t e = Select();
+        if(e < 0){ return;}
+        hostPending[e >> 5].fetch_and(~(1UL << (e & 31)));
+
+        uint32_t active = hostActive;
+        uint32_t level = hostLevel;
+        hostActive = (uint32_t)e;
+        hostLevel = hostPriority[e];
+
+        // higher priority exceptions preempt the handler
+        sigemptyset(&unmasked);
+        pthread_sigmask(SIG_SETMASK, &unmasked, &masked);
+        if(hostVectors[e] != NULL){ hostVectors[e]();}
+        pthread_sigmask(SIG_SETMASK, &masked, NULL);
+
+        hostActive = active;
+        hostLevel = level;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void Signal(int signal){
+    (void)signal;
+    int error = errno;
+    Take();
+    errno = error;
+}
+
+//------------------------------------------------------------------------------
+static bool IsPending(){
+    for(uint32_t w=0L; w<__SYS_HOST_WORDS; w++){
+        if(hostPending[w].load() != 0L){ return(true);}
+    }
+    return(false);
+}
+
+//------------------------------------------------------------------------------
+// the core takes the pending exceptions at once, the other threads signal it
+static void Preempt(){
+    if(!hostStarted){ return;}
+    if(IsCore()){
+        if((hostPrimask != 0)||(!IsPending())){ return;}
+        sigset_t previous;
+        Block(&previous);
+        Take();
+        Restore(&previous);
+    } else {
+        pthread_kill(hostCore, __SYS_HOST_SIGNAL);
+    }
+}
+
+//------------------------------------------------------------------------------
+void NPortRaise(uint32_t exception){
+    if(exception >= __SYS_HOST_EXCEPTIONS){ return;}
+    hostPending[exception >> 5].fetch_or(1UL << (exception & 31));
+    Preempt();
+}
+
+//------------------------------------------------------------------------------
+void NPortSetVector(uint32_t exception, void (*handler)(void)){
+    if(exception < __SYS_HOST_EXCEPTIONS){ hostVectors[exception] = handler;}
+}
+
+//------------------------------------------------------------------------------
+void NHostSetPriority(uint32_t exception, uint32_t priority){
+    if(exception < __SYS_HOST_EXCEPTIONS){ hostPriority[exception] = (uint8_t)priority;}
+}
+
+//------------------------------------------------------------------------------
+uint32_t NHostGetPrimask(){ return((uint32_t)hostPrimask);}
+
+void NHostSetPrimask(uint32_t primask){
+    hostPrimask = (primask & 1L);
+    if(hostPrimask == 0){ Preempt();}
+}
+
+uint32_t NHostActive(){ return(hostActive);}
+
+//------------------------------------------------------------------------------
+// woken by any pending exception, even masked (as WFI)
+void NHostWaitForInterrupt(){
+    if(!IsCore()){ return;}
+    sigset_t previous;
+    Block(&previous);
+    if(!IsPending()){
+        sigset_t wait = previous;
+        sigdelset(&wait, __SYS_HOST_SIGNAL);
+        sigsuspend(&wait);
+    }
+    Restore(&previous);
+}
+
+//------------------------------------------------------------------------------
+// SysTick
+//------------------------------------------------------------------------------
+// writers hold the lock (the core with the signal blocked); readers retry
+static void TickLock(sigset_t* previous){
+    Block(previous);
+    pthread_mutex_lock(&hostTickLock);
+    hostTickSequence.fetch_add(1);
+}
+
+static void TickUnlock(const sigset_t* previous){
+    hostTickSequence.fetch_add(1);
+    pthread_cond_signal(&hostTickChanged);
+    pthread_mutex_unlock(&hostTickLock);
+    Restore(previous);
+}
+
+//------------------------------------------------------------------------------
+// counter value at "now" (lock held or consistent snapshot)
+static uint32_t TickValue(uint64_t now){
+    if(!hostTickEnabled){ return(hostTickValue);}
+    uint64_t elapsed = NsToCycles(now - hostTickAnchor);
+    if(elapsed <= hostTickValue){ return(hostTickValue - (uint32_t)elapsed);}
+    // late timer thread: the counter went on reloading
+    uint64_t period = (uint64_t)hostTickLoad + 1;
+    return(hostTickLoad - (uint32_t)((elapsed - hostTickValue - 1) % period));
+}
+
+//------------------------------------------------------------------------------
+// COUNTFLAG at "now", also if the timer thread is late (lock held)
+static bool TickWrapped(uint64_t now){
+    if(hostTickFlag){ return(true);}
+    return(hostTickEnabled && (now >= hostTickAnchor + CyclesToNs((uint64_t)hostTickValue + 1)));
+}
+
+//------------------------------------------------------------------------------
+static void* TickThread(void* argument){
+    (void)argument;
+    sigset_t previous;
+    Block(&previous);
+
+    pthread_mutex_lock(&hostTickLock);
+    for(;;){
+        if(!hostTickEnabled){
+            pthread_cond_wait(&hostTickChanged, &hostTickLock);
+            continue;
+        }
+
+        //-----------------------------------
+        // counter reaches 0, then reloads on the next cycle
+        uint64_t deadline = hostTickAnchor + CyclesToNs((uint64_t)hostTickValue + 1);
+        uint64_t now = HostNow();
+        uint64_t wake = deadline;
+        // the interrupt is still pending: the next wraps raise nothing new, and short
+        // reloads would starve the core of the lock (COUNTFLAG: TickWrapped)
+        if(NPortTickPending() && (wake < now + __SYS_HOST_TICK_SLACK)){ wake = now + __SYS_HOST_TICK_SLACK;}
+        if(now < wake){
+            struct timespec ts;
+            ts.tv_sec = (time_t)(wake / 1000000000ULL);
+            ts.tv_nsec = (long)(wake % 1000000000ULL);
+            pthread_cond_timedwait(&hostTickChanged, &hostTickLock, &ts);
+            continue;
+        }
+
+        hostTickSequence.fetch_add(1);
+        hostTickAnchor = deadline;
+        hostTickValue = hostTickLoad;
+        // late thread: the periods already elapsed raise a single interrupt
+        uint64_t period = CyclesToNs((uint64_t)hostTickLoad + 1);
+        now = HostNow();
+        if((period > 0)&&(now >= deadline + period)){
+            hostTickAnchor = deadline + (((now - deadline) / period) * period);
+        }
+        hostTickFlag = true;
+        hostTickSequence.fetch_add(1);
+        NPortRaise(__SYS_HOST_SYSTICK);
+    }
+    return(NULL);
+}
+
+//------------------------------------------------------------------------------
+void NPortTickStart(){
+    sigset_t previous;
+    TickLock(&previous);
+    if(!hostTickEnabled){
+        hostTickAnchor = HostNow();
+        hostTickEnabled = true;
+    }
+    TickUnlock(&previous);
+}
+
+//------------------------------------------------------------------------------
+bool NPortTickStop(){
+    sigset_t previous;
+    TickLock(&previous);
+    uint64_t now = HostNow();
+    bool flag = TickWrapped(now);
+    hostTickValue = TickValue(now);
+    hostTickEnabled = false;
+    hostTickFlag = false;
+    TickUnlock(&previous);
+    return(flag);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NPortTickCount(){
+    uint32_t sequence, value;
+    do{
+        sequence = hostTickSequence.load();
+        value = TickValue(HostNow());
+    } while((sequence & 1L)||(sequence != hostTickSequence.load()));
+    return(value);
+}
+
+//------------------------------------------------------------------------------
+// any write clears the counter (reloaded on the next cycle) and COUNTFLAG
+void NPortTickClear(){
+    sigset_t previous;
+    TickLock(&previous);
+    hostTickAnchor = HostNow();
+    hostTickValue = hostTickLoad;
+    hostTickFlag = false;
+    TickUnlock(&previous);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NPortTickGetLoad(){ return(hostTickLoad);}
+
+void NPortTickSetLoad(uint32_t load){
+    sigset_t previous;
+    TickLock(&previous);
+    hostTickLoad = load & __SYS_TICK_RELOAD_MAX;
+    TickUnlock(&previous);
+}
+
+//------------------------------------------------------------------------------
+bool NPortTickPending(){
+    return((hostPending[__SYS_HOST_SYSTICK >> 5].load() & (1UL << (__SYS_HOST_SYSTICK & 31))) != 0L);
+}
+
+//------------------------------------------------------------------------------
+// as CMSIS: reload, lowest priority, counter and interrupt enabled
+uint32_t NHostTickConfig(uint32_t ticks){
+    if((ticks - 1) > __SYS_TICK_RELOAD_MAX){ return(1L);}
+    NPortTickSetLoad(ticks - 1);
+    NHostSetPriority(__SYS_HOST_SYSTICK, (1UL << __NVIC_PRIO_BITS) - 1);
+    NPortTickClear();
+    NPortTickStart();
+    return(0L);
+}
+
+//------------------------------------------------------------------------------
+// core
+//------------------------------------------------------------------------------
+void NPortInitialize(){
+    if(hostStarted){ return;}
+    hostCore = pthread_self();
+
+    struct sigaction action;
+    action.sa_handler = Signal;
+    sigemptyset(&action.sa_mask);
+    sigaddset(&action.sa_mask, __SYS_HOST_SIGNAL);
+    action.sa_flags = SA_RESTART;
+    sigaction(__SYS_HOST_SIGNAL, &action, NULL);
+
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&hostTickChanged, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    hostStarted = true;
+    pthread_create(&hostTimer, NULL, TickThread, NULL);
+}
+
+//------------------------------------------------------------------------------
+void NPortSetPendSV(){ NPortRaise(__SYS_HOST_PENDSV);}
+void NPortClearPendSV(){}
+bool NPortInHandler(){ return(hostActive != 0L);}
+void NPortWaitForInterrupt(){ NHostWaitForInterrupt();}
+void NPortSleepOnExit(bool enable){ (void)enable;}
+// no clocks to stop: Stop and Standby wait as Sleep does (Standby returns, no reset)
+void NPortDeepSleep(bool enable){ (void)enable;}
+void NPortStandby(bool enable){ (void)enable;}
+
+//------------------------------------------------------------------------------
+// vector table: the core handlers of the kernel
+extern "C" void RelocateVectors(){
+    NPortSetVector(__SYS_HOST_PENDSV, EDROS_PendSV_Handler);
+    NPortSetVector(__SYS_HOST_SYSTICK, EDROS_SysTick_Handler);
+}
+
+//------------------------------------------------------------------------------
+// threads
+//------------------------------------------------------------------------------
+void NPortClearContext(NPORTCONTEXT* Context){
+    Context->entry = NULL;
+    Context->argument = NULL;
+    Context->exit = NULL;
+}
+
+//------------------------------------------------------------------------------
+// first run of a thread: exception return from PendSV to thread mode
+static void ThreadStart(uint32_t high, uint32_t low){
+    NPORTCONTEXT* Context = (NPORTCONTEXT*)(((uintptr_t)high << 32) | (uintptr_t)low);
+    hostActive = 0L;
+    hostLevel = __SYS_HOST_THREAD_MODE;
+    hostPrimask = 0;
+    Preempt();
+
+    Context->entry(Context->argument);
+    Context->exit();
+}
+
+//------------------------------------------------------------------------------
+void NPortInitContext(NPORTCONTEXT* Context, uint32_t* stack, uint32_t words,
+                      void (*entry)(void*), void* argument, void (*exit)()){
+    Context->entry = entry;
+    Context->argument = argument;
+    Context->exit = exit;
+
+    getcontext(&Context->context);
+    Context->context.uc_stack.ss_sp = stack;
+    Context->context.uc_stack.ss_size = words << 2;
+    Context->context.uc_link = NULL;
+    sigemptyset(&Context->context.uc_sigmask);
+    uintptr_t address = (uintptr_t)Context;
+    makecontext(&Context->context, (void (*)())ThreadStart, 2,
+                (uint32_t)((uint64_t)address >> 32), (uint32_t)address);
+}
+
+//------------------------------------------------------------------------------
+void NPortSwitchContext(NPORTCONTEXT* From, NPORTCONTEXT* To){
+    swapcontext(&From->context, &To->context);
+}
+
+#endif
+//==============================================================================
@@ -0,0 +1,246 @@
+//==============================================================================
+// EDROS Linux host port: message stream replay (see NReplay.h)
+//------------------------------------------------------------------------------
+// - Load unwraps the 32-bit record times of the stream to nanoseconds from the
+//   first record.
+// - A player thread waits for the time of each selected record, hands it over to
+//   the core through a single-producer ring and raises the injection exception;
+//   the handler injects every record handed over.
+// - The capture thread drains the recorder every few milliseconds (single consumer).
+//==============================================================================
+#ifdef EDROS_HOST
+
+#include "System.h"
+#include "NReplay.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <vector>
+
+//------------------------------------------------------------------------------
+#define __SYS_REPLAY_HANDOVER 		((uint32_t) 1024)		// power of two
+#define __SYS_CAPTURE_PERIOD 		((uint32_t) 5000000)	// ns
+#define __SYS_CAPTURE_CHUNK 		((uint32_t) 64)
+
+//------------------------------------------------------------------------------
+struct REPLAYITEM{
+    uint64_t at;                // ns from the first record
+    NRECORD record;
+};
+
+static std::vector<REPLAYITEM> replayItems;
+static NREPLAYSTATS replayStats;
+static uint32_t replayOrigins = 0L;
+static uint32_t replaySpeed = 100L;
+static uint64_t replayStart = 0L;
+static pthread_t replayPlayer;
+static bool replayRunning = false;
+
+// handover to the core: indexes in replayItems, with their due time
+static uint32_t replayIndex[__SYS_REPLAY_HANDOVER];
+static uint64_t replayDue[__SYS_REPLAY_HANDOVER];
+static std::atomic<uint32_t> replayHead(0), replayTail(0);
+static std::atomic<uint32_t> replayInjected(0);
+
+static FILE* captureFile = NULL;
+static pthread_t captureThread;
+static std::atomic<bool> captureRunning(false);
+
+//------------------------------------------------------------------------------
+static uint64_t HostNow(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static void SleepUntil(uint64_t ns){
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec = (long)(ns % 1000000000ULL);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0){}
+}
+
+static bool IsSelected(const NRECORD* r){
+    return((replayOrigins & (1UL << (r->info & __SYS_RECORD_ORIGIN))) != 0L);
+}
+
+//------------------------------------------------------------------------------
+bool NReplay::Load(const char* path){
+    if(replayRunning && !IsDone()){ return(false);}
+    FILE* f = fopen(path, "rb");
+    if(f == NULL){ return(false);}
+
+    replayItems.clear();
+    memset(&replayStats, 0, sizeof(replayStats));
+    uint64_t now = 0L;
+    uint32_t previous = 0L;
+    bool first = true, valid = true;
+
+    //-----------------------------------------
+    NRECORDHEADER header;
+    while(fread(&header, sizeof(header), 1, f) == 1){
+        if((header.magic != __SYS_RECORD_MAGIC)||(header.version != __SYS_RECORD_VERSION)||
+           (header.size != sizeof(NRECORD))||(header.clock == 0L)){ valid = false; break;}
+        replayStats.lost += header.lost;
+
+        for(uint32_t n=0L; n<header.count; n++){
+            REPLAYITEM item;
+            if(fread(&item.record, sizeof(NRECORD), 1, f) != 1){ valid = false; break;}
+            // the counter wraps; records may be slightly out of order (signed delta)
+            if(!first){
+                int32_t delta = (int32_t)(item.record.time - previous);
+                int64_t ns = ((int64_t)delta * 1000000000LL) / header.clock;
+                now = ((ns < 0)&&((uint64_t)(-ns) > now))? 0L : (uint64_t)((int64_t)now + ns);
+            }
+            previous = item.record.time;
+            first = false;
+            item.at = now;
+            replayItems.push_back(item);
+        }
+        if(!valid){ break;}
+    }
+    fclose(f);
+
+    replayStats.records = (uint32_t)replayItems.size();
+    if(!valid){ replayItems.clear(); replayStats.records = 0L;}
+    return(valid);
+}
+
+//------------------------------------------------------------------------------
+// injection handler (emulated interrupt)
+static void Inject(){
+    uint32_t tail = replayTail.load();
+    while(tail != replayHead.load()){
+        uint32_t slot = tail & (__SYS_REPLAY_HANDOVER - 1);
+        NRECORD* r = &replayItems[replayIndex[slot]].record;
+        NMESSAGE Msg = r->message;
+        uint32_t level = r->info >> __SYS_RECORD_LEVEL_SHIFT;
+
+        //-------------------------------------
+        uint64_t late = HostNow() - replayDue[slot];
+        if(late > replayStats.late_max){ replayStats.late_max = (uint32_t)((late > 0xFFFFFFFFULL)? 0xFFFFFFFFULL : late);}
+        replayStats.late_total += late;
+
+        switch(r->kind){
+            case __SYS_RECORD_DISPATCH: SYS->Dispatch(&Msg); break;
+            case __SYS_RECORD_INSERT: SYS->PostMessage(&Msg, level); break;
+            case __SYS_RECORD_SEND:{
+                HANDLE destination = SYS->GetComponent(r->target);
+                if(destination == NULL){ replayStats.unresolved++;}
+                else { SYS->SendMessage(&Msg, destination, level);}
+                break;
+            }
+            default: break;
+        }
+        replayTail.store(++tail);
+        replayInjected.fetch_add(1);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void* Player(void* argument){
+    uint32_t exception = (uint32_t)(uintptr_t)argument;
+    for(uint32_t i=0L; i<replayItems.size(); i++){
+        if(!IsSelected(&replayItems[i].record)){ continue;}
+        uint64_t due = replayStart + (replayItems[i].at * 100L) / replaySpeed;
+        SleepUntil(due);
+
+        // the core is behind: wait for room in the handover ring
+        uint32_t head = replayHead.load();
+        while((head - replayTail.load()) >= __SYS_REPLAY_HANDOVER){ SleepUntil(HostNow() + 50000L);}
+        replayIndex[head & (__SYS_REPLAY_HANDOVER - 1)] = i;
+        replayDue[head & (__SYS_REPLAY_HANDOVER - 1)] = due;
+        replayHead.store(head + 1);
+        NPortRaise(exception);
+    }
+    return(NULL);
+}
+
+//------------------------------------------------------------------------------
+bool NReplay::Start(uint32_t origins, uint32_t speed, uint32_t exception, uint32_t priority){
+    if((replayRunning && !IsDone())||(replayItems.empty())||(speed == 0L)){ return(false);}
+    if((exception < 16)||(exception >= __SYS_HOST_EXCEPTIONS)){ return(false);}
+
+    replayOrigins = origins;
+    replaySpeed = speed;
+    replayStats.selected = 0L;
+    for(uint32_t i=0L; i<replayItems.size(); i++){
+        if(IsSelected(&replayItems[i].record)){ replayStats.selected++;}
+    }
+    replayInjected.store(0L);
+    NPortSetVector(exception, Inject);
+    NHostSetPriority(exception, priority);
+
+    replayStart = HostNow();
+    replayRunning = true;
+    pthread_create(&replayPlayer, NULL, Player, (void*)(uintptr_t)exception);
+    pthread_detach(replayPlayer);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+bool NReplay::IsDone(){
+    return(replayInjected.load() >= replayStats.selected);
+}
+
+//------------------------------------------------------------------------------
+void NReplay::GetStats(NREPLAYSTATS* Stats){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *Stats = replayStats;
+    Stats->injected = replayInjected.load();
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+// writes the drained records as chunks; false if nothing was drained
+static bool Drain(){
+    NRECORDHEADER header;
+    NRECORD records[__SYS_CAPTURE_CHUNK];
+    uint32_t n = SYS->ReadRecords(&header, records, __SYS_CAPTURE_CHUNK);
+    if((n == 0L)&&(header.lost == 0L)){ return(false);}
+    fwrite(&header, sizeof(header), 1, captureFile);
+    fwrite(records, sizeof(NRECORD), n, captureFile);
+    return(n == __SYS_CAPTURE_CHUNK);
+}
+
+#ifdef __SYS_RECORD
+static void* Capturer(void* argument){
+    (void)argument;
+    while(captureRunning.load()){
+        while(Drain()){}
+        SleepUntil(HostNow() + __SYS_CAPTURE_PERIOD);
+    }
+    return(NULL);
+}
+#endif
+
+//------------------------------------------------------------------------------
+bool NReplay::Capture(const char* path){
+#ifdef __SYS_RECORD
+    if(captureFile != NULL){ return(false);}
+    captureFile = fopen(path, "wb");
+    if(captureFile == NULL){ return(false);}
+    captureRunning.store(true);
+    pthread_create(&captureThread, NULL, Capturer, NULL);
+    return(true);
+#else
+    (void)path;
+    return(false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void NReplay::EndCapture(){
+    if(captureFile == NULL){ return;}
+    captureRunning.store(false);
+    pthread_join(captureThread, NULL);
+    while(Drain()){}
+    fclose(captureFile);
+    captureFile = NULL;
+}
+
+#endif
+//==============================================================================
@@ -0,0 +1,110 @@
+//==============================================================================
+/**
+ * @file NReplay.h
+ * @brief EDROS Linux host port: message stream replay\n
+ * Feeds a stream recorded by @ref NRecorder (on the target or on the host) back
+ * into a host build, with the recorded timing:
+ * - The records of the selected origins (by default the peripheral interrupts)
+ * are injected from an emulated interrupt, at their recorded time: System::Dispatch
+ * for the routed messages, System::PostMessage and SendMessage for the queued ones.
+ * The other records (derived, kernel) are reproduced by the kernel itself.
+ * - The application must create the same components, in the same order, as the
+ * recorded one: routing uses the vector table (InstallCallback) and unicast
+ * destinations the component identifiers.
+ * - With -D__SYS_RECORD, @ref NReplay::Capture writes the stream of the host build
+ * to a file, to be compared with the original (tools/edros_record.py). The injected
+ * origins match record for record; the interleaving of the derived messages and the
+ * number of kernel ones depend on the timing of the host.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NREPLAY_H
+    #define NREPLAY_H
+
+    #include "NRecorder.h"
+
+#ifndef EDROS_HOST
+    #error "NReplay.h: host builds only (-DEDROS_HOST)"
+#endif
+
+//------------------------------------------------------------------------------
+// default exception of the injection (IRQ 40) and its NVIC priority
+#define __SYS_REPLAY_EXCEPTION 		((uint32_t) 56)
+#define __SYS_REPLAY_PRIORITY 		((uint32_t) 2)
+#define __SYS_REPLAY_INTERRUPTS 	((uint32_t)(1UL << __SYS_ORIGIN_INTERRUPT))
+
+    //------------------------------------------------
+	/**
+	 * @struct NREPLAYSTATS
+	 * Replay counters.
+ 	 */
+    struct NREPLAYSTATS{
+        uint32_t records;       //!< records in the stream
+        uint32_t lost;          //!< records lost by the recorder (ring full)
+        uint32_t selected;      //!< records to be injected
+        uint32_t injected;      //!< records injected so far
+        uint32_t unresolved;    //!< unicast records whose destination is not registered
+        uint32_t late_max;      //!< highest injection delay (ns)
+        uint64_t late_total;    //!< sum of the injection delays (ns)
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS message stream replay (host port).
+ 	 */
+    class NReplay{
+        private:
+            NReplay();
+
+    public:
+            /**
+             * @brief Loads a recorded stream (chunks of @ref NRECORDHEADER and records).
+             * @return
+             * - false if the file cannot be read or is not a valid stream.
+             */
+            static bool Load(const char* path);
+
+            /**
+             * @brief Starts the replay, from now on (after Load).
+             * @arg origins
+             * - mask of the origins to inject (1 << __SYS_ORIGIN_*).
+             * @arg speed
+             * - replay speed in percent (100: recorded timing; 200: twice as fast).
+             */
+            static bool Start(uint32_t origins = __SYS_REPLAY_INTERRUPTS, uint32_t speed = 100,
+                              uint32_t exception = __SYS_REPLAY_EXCEPTION, uint32_t priority = __SYS_REPLAY_PRIORITY);
+
+            /**
+             * @brief Checks if every selected record was injected.
+             */
+            static bool IsDone();
+
+            /**
+             * @brief Reads the replay counters.
+             */
+            static void GetStats(NREPLAYSTATS* Stats);
+
+            //-------------------------------------------
+            /**
+             * @brief Starts writing the messages recorded by this build to a file (requires __SYS_RECORD).
+             */
+            static bool Capture(const char* path);
+
+            /**
+             * @brief Drains the recorder and closes the capture file.
+             */
+            static void EndCapture();
+    };
+
+#endif
+//==============================================================================
@@ -0,0 +1,137 @@
+//==============================================================================
+/**
+ * @file NAtomic.h
+ * @brief EDROS atomic primitives\n
+ * 32-bit atomic variable used by the kernel lock-free structures.\n
+ * - Cortex-M: built on LDREX/STREX. The exclusive monitor is cleared on every
+ * exception entry/return, so a sequence interrupted by a nested IRQ fails its
+ * STREX and is simply retried (no need to disable interrupts).
+ * - Host builds: built on std::atomic.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NATOMIC_H
+    #define NATOMIC_H
+
+    #include <stdint.h>
+
+    #if defined(__arm__) || defined(__ICCARM__)
+        #include "DRV_CPU.h"
+    #else
+        #include <atomic>
+    #endif
+
+    //------------------------------------------------
+	/** @brief EDROS 32-bit atomic variable.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NAtomic{
+        private:
+        #if defined(__arm__) || defined(__ICCARM__)
+            volatile uint32_t value;
+        #else
+            std::atomic<uint32_t> value;
+        #endif
+
+            NAtomic(const NAtomic&);
+            NAtomic& operator=(const NAtomic&);
+
+    public:
+        #if defined(__arm__) || defined(__ICCARM__)
+            //-------------------------------------------
+            NAtomic(uint32_t v = 0L){ value = v;}
+
+            /**
+             * @brief Reads the current value.
+             */
+            uint32_t Load() const { uint32_t v = value; __DMB(); return(v);}
+
+            /**
+             * @brief Writes a new value (previous memory writes become visible first).
+             */
+            void Store(uint32_t v){ __DMB(); value = v;}
+
+            /**
+             * @brief Replaces the value with "desired" if it still equals "expected".
+             * @return
+             * - true if the value was replaced.
+             * - false otherwise; "expected" receives the current value.
+             */
+            bool CompareExchange(uint32_t& expected, uint32_t desired){
+                do{
+                    uint32_t current = __LDREXW(&value);
+                    if(current != expected){ __CLREX(); expected = current; return(false);}
+                } while(__STREXW(desired, &value) != 0L);
+                __DMB();
+                return(true);
+            }
+
+            /**
+             * @brief Replaces the value, returning the previous one.
+             */
+            uint32_t Exchange(uint32_t v){
+                uint32_t old;
+                do{ old = __LDREXW(&value);} while(__STREXW(v, &value) != 0L);
+                __DMB();
+                return(old);
+            }
+
+            /**
+             * @brief Adds "v" to the value, returning the previous one.
+             */
+            uint32_t FetchAdd(uint32_t v){
+                uint32_t old;
+                do{ old = __LDREXW(&value);} while(__STREXW(old + v, &value) != 0L);
+                __DMB();
+                return(old);
+            }
+
+            /**
+             * @brief Sets the bits of "v" in the value, returning the previous one.
+             */
+            uint32_t FetchOr(uint32_t v){
+                uint32_t old;
+                do{ old = __LDREXW(&value);} while(__STREXW(old | v, &value) != 0L);
+                __DMB();
+                return(old);
+            }
+
+            /**
+             * @brief Keeps only the bits of "v" in the value, returning the previous one.
+             */
+            uint32_t FetchAnd(uint32_t v){
+                uint32_t old;
+                do{ old = __LDREXW(&value);} while(__STREXW(old & v, &value) != 0L);
+                __DMB();
+                return(old);
+            }
+        #else
+            //-------------------------------------------
+            NAtomic(uint32_t v = 0L) : value(v){}
+            uint32_t Load() const { return(value.load());}
+            void Store(uint32_t v){ value.store(v);}
+            bool CompareExchange(uint32_t& expected, uint32_t desired){
+                return(value.compare_exchange_strong(expected, desired));
+            }
+            uint32_t Exchange(uint32_t v){ return(value.exchange(v));}
+            uint32_t FetchAdd(uint32_t v){ return(value.fetch_add(v));}
+            uint32_t FetchOr(uint32_t v){ return(value.fetch_or(v));}
+            uint32_t FetchAnd(uint32_t v){ return(value.fetch_and(v));}
+        #endif
+    };
+
+#endif
+
+//==============================================================================
@@ -0,0 +1,165 @@
+//==============================================================================
+/**
+ * @file NBufferPool.h
+ * @brief EDROS buffer pool\n
+ * Fixed-size data blocks shared by messages without copying.\n
+ * - A block is allocated with one reference, owned by the sender. Posting a message
+ * whose "tag" is the block handle, flagged as carrying it (System::PostBuffer),
+ * transfers that reference to the message pipe, which releases it after the last
+ * component has been notified (or when the message is discarded by the queue
+ * overflow policy). Unflagged messages never touch the pool.
+ * - Components that keep the block beyond Notify() take their own reference
+ * (Retain) and release it later (Release).
+ * - Allocation, retain and release use atomic operations only: ISR-safe and O(1).
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NBUFFERPOOL_H
+    #define NBUFFERPOOL_H
+
+    #include "NComponent.h"
+    #include "NAtomic.h"
+
+//------------------------------------------------------------------------------
+#define __SYS_BUFFER_NONE 			((uint32_t) 0)
+
+    //------------------------------------------------
+	/**
+	 * @struct NBUFFERSTATS
+	 * Buffer pool counters, readable at runtime.
+ 	 */
+    struct NBUFFERSTATS{
+        uint32_t blocks;        //!< number of blocks
+        uint32_t size;          //!< block size in bytes
+        uint32_t used;          //!< blocks currently allocated
+        uint32_t watermark;     //!< highest number of blocks allocated at once
+        uint32_t failures;      //!< allocations refused (pool exhausted)
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS reference-counted buffer pool.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NBufferPool{
+        protected:
+            /**
+             * @brief Constructor used by @ref NStaticBufferPool.
+             * @arg storage
+             * - memory area of "blocks" x "words" 32-bit words.
+             * @arg references
+             * - array of "blocks" reference counters.
+             * @arg words
+             * - block size, in 32-bit words.
+             * @arg blocks
+             * - number of blocks (up to 32).
+             */
+            NBufferPool(uint32_t* storage, NAtomic* references, uint32_t words, uint32_t blocks);
+
+        private:
+            uint32_t* arena;
+            uint32_t origin;
+            NAtomic* refs;
+            uint32_t block_words;
+            uint32_t number;
+            NAtomic free_blocks;
+
+            NAtomic used;
+            NAtomic watermark;
+            NAtomic failures;
+
+            uint32_t Index(uint32_t handle);
+
+            NBufferPool(const NBufferPool&);
+            NBufferPool& operator=(const NBufferPool&);
+
+    public:
+            //-------------------------------------------
+            // METHODS
+
+            /**
+             * @brief Allocates a block with one reference (any context, any priority).
+             * @return
+             * - pointer to the block data, or NULL if the pool is exhausted.
+             */
+            void* Allocate();
+
+            /**
+             * @brief Adds a reference to an allocated block.
+             * @arg handle
+             * - block handle (see @ref Handle).
+             * @return
+             * - false if "handle" is not an allocated block of this pool.
+             */
+            bool Retain(uint32_t handle);
+
+            /**
+             * @brief Removes a reference; the block returns to the pool with the last one.
+             * @arg handle
+             * - block handle (see @ref Handle).
+             * @return
+             * - false if "handle" is not an allocated block of this pool.
+             */
+            bool Release(uint32_t handle);
+
+            /**
+             * @brief Converts a block pointer into the 32-bit handle carried by a message "tag".
+             * @return
+             * - block handle, or __SYS_BUFFER_NONE if "data" is not a block of this pool.
+             */
+            uint32_t Handle(const void* data);
+
+            /**
+             * @brief Converts a block handle back into a pointer.
+             * @return
+             * - pointer to the block data, or NULL if "handle" is not an allocated block.
+             */
+            void* Data(uint32_t handle);
+
+            /**
+             * @brief Checks if a 32-bit value (a message "tag") is an allocated block of this pool.
+             */
+            bool Contains(uint32_t handle);
+
+            /**
+             * @brief Block size, in bytes.
+             */
+            uint32_t BlockSize(){ return(block_words << 2);}
+
+            /**
+             * @brief This method reads the pool counters.
+             */
+            void GetStats(NBUFFERSTATS* Stats);
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS buffer pool with statically allocated storage.
+	 * @arg Size: block size in bytes (rounded up to a multiple of 4).
+	 * @arg Blocks: number of blocks (1 to 32).
+ 	 */
+    template<uint32_t Size, uint32_t Blocks>
+    class NStaticBufferPool : public NBufferPool{
+        static_assert((Blocks > 0) && (Blocks <= 32), "NStaticBufferPool: 1 to 32 blocks");
+        static_assert(Size > 0, "NStaticBufferPool: empty blocks");
+
+        private:
+            uint32_t storage[Blocks * ((Size + 3) / 4)];
+            NAtomic references[Blocks];
+
+    public:
+            NStaticBufferPool() : NBufferPool(storage, references, (Size + 3) / 4, Blocks){}
+    };
+
+#endif
+//==============================================================================
@@ -0,0 +1,221 @@
+//==============================================================================
+/**
+ * @file NLatency.h
+ * @brief EDROS interrupt latency histograms\n
+ * Time from the interrupt entry to the component handler (enabled with -D__SYS_LATENCY).\n
+ * - Each EDROS_*_IRQHandler stamps its entry time (@ref NIRQ_ENTRY). The message
+ * routed by System::Dispatch carries the stamp through the callback queue or the
+ * message pipe, until its handler runs:
+ *   - __SYS_PATH_CRITICAL: nTimeCritical, InterruptCallBack called at once (ISR);
+ *   - __SYS_PATH_CALLBACK: nNormal, InterruptCallBack called by PendSV;
+ *   - __SYS_PATH_QUEUED: message queued, Notify called by the dispatcher.
+ * - Per path and per vector (NV_ID): number of samples, minimum, maximum and a
+ * log2 histogram of the latency in cycles (bucket "b" counts the latencies from
+ * 2^(b + __SYS_LATENCY_SHIFT) cycles up to twice that; bucket 0 also counts the
+ * shorter ones, the last bucket also the longer ones).
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NLATENCY_H
+    #define NLATENCY_H
+
+    #include "NProfiler.h"
+    #include "NTrace.h"
+    #include "NRecorder.h"
+    #include "NLoad.h"
+
+//------------------------------------------------------------------------------
+#define __SYS_LATENCY_BUCKETS 		((uint32_t) 16)
+#define __SYS_LATENCY_SHIFT 		((uint32_t) 4)
+#define __SYS_LATENCY_ALL 			((uint32_t) 0xFFFFFFFF)
+#define __SYS_PATH_CRITICAL 		((uint32_t) 0)
+#define __SYS_PATH_CALLBACK 		((uint32_t) 1)
+#define __SYS_PATH_QUEUED 			((uint32_t) 2)
+#define __SYS_LATENCY_PATHS 		((uint32_t) 3)
+// number of (vector, path) pairs with their own histogram
+#ifndef __SYS_LATENCY_SOURCES
+	#define __SYS_LATENCY_SOURCES 		((uint32_t) 8)
+#endif
+
+    //------------------------------------------------
+	/**
+	 * @struct NLATENCYSTATS
+	 * Latency histogram of a vector (or of all vectors) on a routing path, in cycles.
+ 	 */
+    struct NLATENCYSTATS{
+        uint32_t vector;        //!< NV_ID, or __SYS_LATENCY_ALL
+        uint32_t path;          //!< __SYS_PATH_CRITICAL, __SYS_PATH_CALLBACK or __SYS_PATH_QUEUED
+        uint32_t samples;       //!< number of messages measured
+        uint32_t min;           //!< shortest latency
+        uint32_t max;           //!< longest latency (worst case observed)
+        uint32_t buckets[__SYS_LATENCY_BUCKETS];
+    };
+
+#ifdef __SYS_LATENCY
+    //------------------------------------------------
+	/** @brief EDROS interrupt latency histograms.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NLatency{
+        private:
+            NLATENCYSTATS totals[__SYS_LATENCY_PATHS];
+            NLATENCYSTATS sources[__SYS_LATENCY_SOURCES];
+            uint32_t overflows;
+
+            static volatile uint32_t entry;     //!< entry stamp of the running interrupt
+            static volatile uint32_t armed;     //!< stamp given to the message being routed
+
+            static void Update(NLATENCYSTATS* Stats, uint32_t cycles);
+            static void Clear(NLATENCYSTATS* Stats, uint32_t vector, uint32_t path);
+
+            NLatency(const NLatency&);
+            NLatency& operator=(const NLatency&);
+
+    public:
+            NLatency();
+
+            //-------------------------------------------
+            /**
+             * @brief Stamps the entry of an interrupt handler (see @ref NIrqScope).
+             * @return
+             * - the stamps of the interrupted context, for @ref Leave.
+             */
+            static uint64_t Enter(){
+                uint64_t previous = ((uint64_t)armed << 32) | entry;
+                entry = NCycles() | 1UL;
+                armed = 0L;
+                return(previous);
+            }
+
+            /**
+             * @brief Restores the stamps of the interrupted context.
+             */
+            static void Leave(uint64_t previous){
+                entry = (uint32_t)previous;
+                armed = (uint32_t)(previous >> 32);
+            }
+
+            /**
+             * @brief The messages queued from now on carry the entry stamp (System::Dispatch).
+             * @return
+             * - the entry stamp, or 0 outside of an instrumented interrupt handler.
+             */
+            static uint32_t Arm(){ armed = entry; return(entry);}
+
+            /**
+             * @brief Ends @ref Arm.
+             */
+            static void Disarm(){ armed = 0L;}
+
+            /**
+             * @brief Stamp of the message being queued (0: not measured).
+             */
+            static uint32_t Armed(){ return(armed);}
+
+            //-------------------------------------------
+            /**
+             * @brief Records the latency of a message whose handler is about to run.
+             * @arg vector
+             * - NV_ID of the message source.
+             * @arg path
+             * - routing path (__SYS_PATH_*).
+             * @arg stamp
+             * - entry stamp carried by the message (ignored if 0).
+             */
+            void Record(uint32_t vector, uint32_t path, uint32_t stamp);
+
+            /**
+             * @brief Reads a histogram.
+             * @arg vector
+             * - NV_ID, or __SYS_LATENCY_ALL for all the vectors of the path.
+             * @return
+             * - false if the pair has no histogram (never measured, or table full).
+             */
+            bool Get(uint32_t vector, uint32_t path, NLATENCYSTATS* Stats);
+
+            /**
+             * @brief Reads the histograms per vector, one at a time.
+             * @arg index
+             * - 0 up to the first false return.
+             */
+            bool GetSource(uint32_t index, NLATENCYSTATS* Stats);
+
+            /**
+             * @brief Number of samples without a histogram per vector (table full).
+             */
+            uint32_t GetOverflows(){ return(overflows);}
+
+            /**
+             * @brief Clears all histograms.
+             */
+            void Reset();
+    };
+
+    //------------------------------------------------
+    #define NLATENCY_ARMED()        NLatency::Armed()
+#else
+    #define NLATENCY_ARMED()        ((uint32_t) 0)
+#endif
+
+#if defined(__SYS_LATENCY) || defined(__SYS_TRACE) || defined(__SYS_RECORD) || defined(__SYS_LOAD)
+    //------------------------------------------------
+	/** @brief Instrumentation of an interrupt handler, for its whole body: entry stamp
+	 * (nested interrupts restore it), trace of the entry and exit, origin of the
+	 * recorded messages and interrupt time.
+ 	 */
+    class NIrqScope{
+        private:
+#ifdef __SYS_LATENCY
+            uint64_t previous;
+#endif
+#ifdef __SYS_RECORD
+            uint32_t derived;
+#endif
+
+    public:
+            NIrqScope(){
+#ifdef __SYS_LOAD
+                NLoad::Enter();
+#endif
+#ifdef __SYS_LATENCY
+                previous = NLatency::Enter();
+#endif
+#ifdef __SYS_RECORD
+                derived = NRecorder::Enter();
+#endif
+                NTRACE(__SYS_TRACE_IRQ_ENTER, 0, __get_IPSR(), 0);
+            }
+            ~NIrqScope(){
+                NTRACE(__SYS_TRACE_IRQ_EXIT, 0, __get_IPSR(), 0);
+#ifdef __SYS_RECORD
+                NRecorder::Leave(derived);
+#endif
+#ifdef __SYS_LATENCY
+                NLatency::Leave(previous);
+#endif
+#ifdef __SYS_LOAD
+                NLoad::Leave();
+#endif
+            }
+    };
+
+    //------------------------------------------------
+    #define NIRQ_ENTRY()            NIrqScope irq_scope
+#else
+    #define NIRQ_ENTRY()
+#endif
+
+#endif
+//==============================================================================
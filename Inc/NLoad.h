@@ -0,0 +1,164 @@
+//==============================================================================
+/**
+ * @file NLoad.h
+ * @brief EDROS CPU load accounting\n
+ * Busy and idle time of the core per window (enabled with -D__SYS_LOAD).\n
+ * - Idle: the main loop (System::Execute) finds the message pipe empty, polling it
+ * or asleep in WFI (System::Sleep, tickless idle, System::WaitFor); interrupt
+ * handlers running meanwhile are busy time.
+ * - Interrupts: peripheral handlers (@ref NIRQ_ENTRY), SysTick and the PendSV callbacks,
+ * the outermost handler only.
+ * - Dispatch: thread time in the message pipe dispatcher (Notify and coroutines),
+ * interrupts excluded.
+ * - The busy periods (from a wake-up to the next idle entry) and the time of the
+ * handlers are measured with the cycle counter, which may stop while the core sleeps;
+ * the window length comes from the kernel ticks (default 1 s, @ref __SYS_LOAD_WINDOW).
+ * Idle time is the window minus the busy time.
+ * - With -D__SYS_THREADS the time of the other threads takes the state of the main loop.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NLOAD_H
+    #define NLOAD_H
+
+    #include "NProfiler.h"
+
+//------------------------------------------------------------------------------
+// window length in milliseconds
+#ifndef __SYS_LOAD_WINDOW
+	#define __SYS_LOAD_WINDOW 			((uint32_t) 1000)
+#endif
+// full scale of the percentages (0.01 %)
+#define __SYS_LOAD_SCALE 			((uint32_t) 10000)
+
+    //------------------------------------------------
+	/**
+	 * @struct NLOADSTATS
+	 * Core usage in the last complete window.
+ 	 */
+    struct NLOADSTATS{
+        uint32_t window;        //!< window length (ms)
+        uint32_t load;          //!< busy time: 0 to __SYS_LOAD_SCALE (0.01 %)
+        uint32_t isr;           //!< time in interrupt handlers (0.01 %)
+        uint32_t dispatch;      //!< time dispatching messages, interrupts excluded (0.01 %)
+        uint32_t busy_max;      //!< longest busy period (microseconds)
+        uint32_t wakeups;       //!< idle periods ended
+        uint32_t windows;       //!< windows completed since the start
+    };
+
+#ifdef __SYS_LOAD
+
+    //------------------------------------------------
+	/** @brief EDROS CPU load accounting.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NLoad{
+        private:
+            static volatile uint32_t depth;     // nested interrupt handlers
+            static volatile uint32_t idle;      // main loop idle (interrupts may run)
+            static volatile uint32_t woken;     // busy period started by a handler
+            static uint32_t dispatching;        // nested dispatcher calls
+            static uint32_t isrMark, awakeMark, periodMark, dispatchMark;
+            static uint64_t isrTotal, busyTotal, dispatchTotal, isrDispatch;
+            static uint64_t isrStart, busyStart, dispatchStart;
+            static uint32_t busyMax, wakeups;
+            static uint32_t frequency;          // cycle counter (Hz)
+            static uint32_t window, windowStart, windows;
+            static NLOADSTATS last;
+
+            static void Flush(uint32_t now);
+            static void Woken(uint32_t now);
+
+            NLoad();
+
+    public:
+            /**
+             * @brief Starts the accounting (called by System::Initialize).
+             * @arg frequency
+             * - frequency of the cycle counter in Hz.
+             */
+            static void Initialize(uint32_t frequency, uint32_t time);
+
+            /**
+             * @brief Frequency of the cycle counter changed (System::ClockChanged).
+             */
+            static void SetFrequency(uint32_t frequency);
+
+            /**
+             * @brief Window length in milliseconds (from the next window on).
+             */
+            static void SetWindow(uint32_t ms);
+
+            //-------------------------------------------
+            /**
+             * @brief Entry and exit of an interrupt handler.
+             */
+            static void Enter();
+            static void Leave();
+
+            /**
+             * @brief The main loop becomes idle, or busy again (thread mode).
+             */
+            static void Idle();
+            static void Busy();
+
+            /**
+             * @brief Entry and exit of the message pipe dispatcher (thread mode, may nest).
+             */
+            static void DispatchEnter();
+            static void DispatchLeave();
+
+            /**
+             * @brief Closes the window when due (System::Step, interrupts masked or SysTick).
+             * @arg time
+             * - system time (ms).
+             */
+            static void Update(uint32_t time);
+
+            /**
+             * @brief Reads the last complete window.
+             * @return
+             * - false if no window is complete yet.
+             */
+            static bool Get(NLOADSTATS* Stats);
+    };
+
+    //------------------------------------------------
+	/** @brief Accounts a block of a handler as interrupt time (SysTick, PendSV).
+ 	 */
+    class NLoadScope{
+    public:
+            NLoadScope(){ NLoad::Enter();}
+            ~NLoadScope(){ NLoad::Leave();}
+    };
+
+    //------------------------------------------------
+    #define NLOAD_ISR()                 NLoadScope load_scope
+    #define NLOAD_IDLE()                NLoad::Idle()
+    #define NLOAD_BUSY()                NLoad::Busy()
+    #define NLOAD_DISPATCH_ENTER()      NLoad::DispatchEnter()
+    #define NLOAD_DISPATCH_LEAVE()      NLoad::DispatchLeave()
+    #define NLOAD_UPDATE(time)          NLoad::Update(time)
+#else
+    #define NLOAD_ISR()
+    #define NLOAD_IDLE()
+    #define NLOAD_BUSY()
+    #define NLOAD_DISPATCH_ENTER()
+    #define NLOAD_DISPATCH_LEAVE()
+    #define NLOAD_UPDATE(time)
+#endif
+
+#endif
+//==============================================================================
@@ -3,6 +3,9 @@
  * @file NMessagePipe.h
  * @brief EDROS system messages manager\n
  * This class provides the message queues for the kernel.\n
+ * Messages are queued in @ref __SYS_PRIORITY_LEVELS priority levels and the
+ * highest non-empty level is always served first.\n
+ * The queue storage is provided by @ref NStaticMessagePipe.\n
  * @version 1.0.0
  * @author Joao Nilo Rodrigues - nilo@pobox.com
  * @warning This class must be used exclusively by the system kernel.
@@ -21,8 +24,35 @@
 #ifndef NMESSAGEPIPE_H
     #define NMESSAGEPIPE_H
 
-    #include "NFifo.h"
     #include "NComponent.h"
+    #include "NMessageRing.h"
+    #include "NRegistry.h"
+    #include "NTask.h"
+    #include "NProfiler.h"
+
+//------------------------------------------------------------------------------
+#define __SYS_MAX_SUBSCRIPTIONS 	((uint32_t) 16)
+#define __SYS_PERIODIC_MESSAGES 	((uint32_t) 3)
+#ifndef __SYS_PRIORITY_LEVELS
+	#define __SYS_PRIORITY_LEVELS 	((uint32_t) 2)
+#endif
+#ifndef __SYS_DEFERRED_MESSAGES
+	#define __SYS_DEFERRED_MESSAGES 	((uint32_t) 8)
+#endif
+#define __SYS_QUEUE_STANDARD 		((uint32_t) 0)
+#define __SYS_QUEUE_PRIORITY 		((uint32_t)(__SYS_PRIORITY_LEVELS - 1))
+#define __SYS_QUEUE_DEFERRED 		((uint32_t) 0x81)
+
+    //------------------------------------------------
+	/**
+	 * @struct NDISPATCHSTATS
+	 * Dispatcher counters, readable at runtime.
+ 	 */
+    struct NDISPATCHSTATS{
+        uint32_t rounds;        //!< calls to @ref NMessagePipe::Dispatch
+        uint32_t messages;      //!< messages dispatched
+        uint32_t starved;       //!< rounds cut by the budget with messages still queued
+    };
 
     //------------------------------------------------
 	/** @brief EDROS system messages manager.
@@ -30,16 +60,99 @@
  	 */
     class NMessagePipe{
         private:
-            NFifo* fila;
-            NFifo* filah;
+            NMessageRing* levels[__SYS_PRIORITY_LEVELS];
+            NAtomic ready;
             NComponent* comp;
 
-            uint32_t objects_number;
+            //-------------------------------------------
+            NRegistry registry;
+            uint32_t dispatching;
+            uint32_t sysZombies[__SYS_OBJECT_WORDS];
+
+            void ReleaseZombies();
+
+            //-------------------------------------------
+            // components waiting in a cooperative delay: their messages are deferred
+            uint32_t sysBusy[__SYS_OBJECT_WORDS];
+            NMessageRing* deferred;
+
+            bool IsBusy(uint32_t slot){ return((sysBusy[slot >> 5] & (1UL << (slot & 31))) != 0L);}
+            uint32_t Redeliver();
+
+            //-------------------------------------------
+            NBufferPool* buffers;
+
+            void ReleaseBuffer(const NMESSAGE* Msg, uint32_t flags);
 
-            HANDLE sysObjects[__SYS_MAX_OBJECTS];
+#ifdef __SYS_COROUTINES
+            //-------------------------------------------
+            NTaskScheduler* tasks;
+#endif
+
+#ifdef __SYS_PROFILER
+            //-------------------------------------------
+            NProfiler* profiler;
+#endif
+
+#ifdef __SYS_LATENCY
+            //-------------------------------------------
+            NLatency* latency;
+#endif
 
-            NMESSAGE    Message;
-            NMESSAGE    BkMessage;
+            //-------------------------------------------
+            uint32_t rounds;
+            uint32_t messages;
+            uint32_t starved;
+
+            //-------------------------------------------
+            /**
+             * @struct SUBSCRIPTION
+             * Subscription index entry: one bit per component slot interested in "message".
+             */
+            struct SUBSCRIPTION{
+                uint32_t message;
+                uint32_t mask[__SYS_OBJECT_WORDS];
+            };
+
+            uint32_t subscriptions_number;
+            SUBSCRIPTION sysSubscriptions[__SYS_MAX_SUBSCRIPTIONS];
+            uint32_t sysListeners[__SYS_OBJECT_WORDS];
+
+            SUBSCRIPTION* FindSubscription(uint32_t message);
+            void RemoveSubscription(SUBSCRIPTION* entry);
+            void Broadcast(const NMESSAGE* Msg, uint32_t flags, bool extinguish);
+            bool Deliver(uint32_t slot, const NMESSAGE* Msg, uint32_t flags, bool extinguish);
+
+            //-------------------------------------------
+            /**
+             * @struct PERIODIC
+             * Coalescing slot of a periodic system message (NM_TIMETICK, NM_KEYSCAN, NM_REPAINT).
+             * At most one instance of each periodic message is queued at any time.
+             */
+            struct PERIODIC{
+                uint32_t message;       //!< periodic message identifier
+                NAtomic pending;        //!< an instance is queued and not yet delivered
+                NAtomic count;          //!< periods elapsed since the last delivery
+                volatile uint32_t time; //!< system time of the latest period
+                uint32_t merged;        //!< periods merged into an already queued instance
+            };
+
+            PERIODIC sysPeriodic[__SYS_PERIODIC_MESSAGES];
+
+            PERIODIC* FindPeriodic(uint32_t message);
+            bool Collect(NMESSAGE* Msg);
+
+
+        protected:
+            /**
+             * @brief Attaches the ring of a priority level (used by @ref NStaticMessagePipe).
+             */
+            void AttachQueue(uint32_t level, NMessageRing* ring);
+
+            /**
+             * @brief Attaches the ring of the deferred messages (used by @ref NStaticMessagePipe).
+             */
+            void AttachDeferred(NMessageRing* ring){ deferred = ring;}
 
     public:
             //-------------------------------------------
@@ -56,21 +169,167 @@
 
             /**
              * @brief This method is used to insert a message in the system queue.
+             * Messages above @ref __SYS_PRIORITY_BORDERLINE go to the highest priority level,
+             * the others to the standard level.
              * @arg Msg
              * - pointer to the @ref NMESSAGE structure containing the message to be inserted.
+             * @return
+             * - true if the message was queued.
+             * - false if the message was discarded by the queue overflow policy.
              */
-            void Insert(NMESSAGE* Msg);
+            bool Insert(NMESSAGE* Msg);
+
+            /**
+             * @brief This method is used to insert a message in a particular priority level.
+             * @arg Msg
+             * - pointer to the @ref NMESSAGE structure containing the message to be inserted.
+             * @arg priority
+             * - 0 (@ref __SYS_QUEUE_STANDARD) to @ref __SYS_PRIORITY_LEVELS - 1 (@ref __SYS_QUEUE_PRIORITY).
+             * Higher values are clipped to the highest level.
+             * @arg flags
+             * - @ref __SYS_MESSAGE_BUFFER: "tag" carries a data block reference, passed to the
+             * pipe and released after the last component has been notified.
+             * @return
+             * - true if the message was queued.
+             * - false if the message was discarded by the queue overflow policy.
+             */
+            bool Insert(NMESSAGE* Msg, uint32_t priority, uint32_t flags = __SYS_MESSAGE_PLAIN);
+
+            /**
+             * @brief This method is used to insert a message addressed to a single component (unicast).
+             * Only the destination is notified, without visiting the other registered components.
+             * @arg Msg
+             * - pointer to the @ref NMESSAGE structure containing the message to be inserted.
+             * @arg destination
+             * - handle of the destination component.
+             * @arg priority
+             * - 0 (@ref __SYS_QUEUE_STANDARD) to @ref __SYS_QUEUE_PRIORITY.
+             * @arg flags
+             * - @ref __SYS_MESSAGE_BUFFER: see @ref Insert (the reference is released at once
+             * if the destination is not registered).
+             * @return
+             * - true if the message was queued.
+             * - false if the destination is not registered, or if the message was discarded
+             * by the queue overflow policy.
+             * @note
+             * - A destination excluded before the message is dispatched is not notified.
+             */
+            bool Send(NMESSAGE* Msg, HANDLE destination, uint32_t priority, uint32_t flags = __SYS_MESSAGE_PLAIN);
+
+            /**
+             * @brief This method is used by the kernel timers to insert a periodic message (NM_TIMETICK, NM_KEYSCAN, NM_REPAINT).
+             * If an instance of the same message is still waiting in the queue, its payload is updated
+             * in place instead of queueing a duplicate. When delivered:
+             * - data1: number of periods elapsed since the previous delivery (1 if none was merged).
+             * - data2: system time of the latest period.
+             * @arg Msg
+             * - pointer to the @ref NMESSAGE structure (data2 must contain the current system time).
+             * @arg periods
+             * - number of periods elapsed (more than 1 after a tickless idle period).
+             * @warning
+             * - This method must be called from a single context (the SysTick handler).
+             */
+            void InsertPeriodic(NMESSAGE* Msg, uint32_t periods = 1);
+
+            /**
+             * @brief This method returns the number of periods merged into an already queued instance of a periodic message.
+             * @arg message
+             * - periodic message identifier (NM_TIMETICK, NM_KEYSCAN or NM_REPAINT).
+             * @return
+             * - number of merged periods since the system startup (0 for non-periodic messages).
+             */
+            uint32_t GetMergedCount(uint32_t message);
+
+            /**
+             * @brief This method returns one of the pipe queues.
+             * @arg queue
+             * - priority level: @ref __SYS_QUEUE_STANDARD to @ref __SYS_QUEUE_PRIORITY.
+             * - @ref __SYS_QUEUE_DEFERRED: messages of the components in a cooperative delay.
+             * @return
+             * - pointer to the queue, or NULL if "queue" is invalid.
+             */
+            NMessageRing* GetQueue(uint32_t queue);
 
             /**
              * @brief This method is called by the system kernel to notify the registered components
-             * of queued messages.
+             * of queued messages. The priority levels are checked again after every message,
+             * so an urgent message waits for one message at most.
+             * @arg budget
+             * - maximum number of messages in this round (0: no limit).
+             * @arg time_budget
+             * - maximum duration of this round, in microseconds (0: no limit).
              * @return
              * - number of messages dispatched (for each component)
+             * @note
+             * - Messages left when the budget runs out stay queued for the next round.
+             * - Reentrant: a component may dispatch the pending messages while it waits
+             * (see @ref Suspend).
+             */
+            uint32_t Dispatch(uint32_t budget = 0, uint32_t time_budget = 0);
+
+            /**
+             * @brief This method marks the component being notified as busy, before it waits
+             * for something while the messages are still dispatched (cooperative delay).
+             * Its messages are deferred, then delivered in order once it is resumed.
+             * @return
+             * - the component slot, or __SYS_INDEX_INVALID if called outside of a notification.
+             */
+            uint32_t Suspend();
+
+            /**
+             * @brief This method ends the busy state set by @ref Suspend.
+             * @arg slot
+             * - value returned by @ref Suspend.
+             */
+            void Resume(uint32_t slot);
+
+            /**
+             * @brief This method selects the buffer pool of the messages carrying data blocks:
+             * the reference held by such a message is released after its broadcast,
+             * or when it is discarded by a queue.
+             * @arg Pool
+             * - buffer pool (@ref NBufferPool), or NULL.
+             */
+            void SetBufferPool(NBufferPool* Pool);
+
+#ifdef __SYS_COROUTINES
+            /**
+             * @brief This method selects the scheduler of the coroutine tasks (@ref NTask),
+             * resumed by the dispatcher.
+             */
+            void SetScheduler(NTaskScheduler* Scheduler){ tasks = Scheduler;}
+#endif
+
+#ifdef __SYS_PROFILER
+            /**
+             * @brief This method selects the profiler timing the notifications (@ref NProfiler).
+             */
+            void SetProfiler(NProfiler* Profiler){ profiler = Profiler;}
+#endif
+
+#ifdef __SYS_LATENCY
+            /**
+             * @brief This method selects the histograms of the interrupt latency (@ref NLatency):
+             * the latency of a queued message ends when its notification starts.
+             */
+            void SetLatency(NLatency* Latency){ latency = Latency;}
+#endif
+
+            /**
+             * @brief This method checks if there are messages (or resumed tasks) waiting to be dispatched.
              */
-            uint32_t Dispatch();
+            bool IsPending();
+
+            /**
+             * @brief This method reads the dispatcher counters.
+             * @arg Stats
+             * - pointer to the @ref NDISPATCHSTATS to be filled in.
+             */
+            void GetDispatchStats(NDISPATCHSTATS* Stats);
 
             /**
              * @brief This method is used "by the kernel" to register a given component in the notification table.
+             * A component included while a message is being dispatched is notified from the next message on.
              * @arg inComp
              * - the handle of the component to be registered.
              * @return
@@ -83,19 +342,93 @@
              * @arg fComp
              * - the handle of the component to be searched.
              * @return
-             * - the component index, if the component is registered.
+             * - the component slot, if the component is registered.
              * - __SYS_INDEX_INVALID, otherwise.
              */
 			uint32_t FindComponent(HANDLE fComp);
 
             /**
              * @brief This method is used "by the kernel" to exclude a registered component from the notification table.
+             * The component is not notified anymore from the moment it is excluded. If a message is being dispatched,
+             * its slot is only recycled once the message has been delivered to the other components.
              * @arg inComp
              * - the handle of the component to be excluded.
              * @return
              * - true if the component was successfully excluded.
              */
 			bool ExcludeComponent(HANDLE);
+
+            /**
+             * @brief This method returns the identifier of a registered component.
+             * The identifier carries a generation number: it is never valid for another component,
+             * even if that component later takes the same slot.
+             * @arg iComp
+             * - the handle of the component.
+             * @return
+             * - the component identifier, or @ref __SYS_COMPONENT_NONE if not registered.
+             */
+            uint32_t GetComponentId(HANDLE iComp);
+
+            /**
+             * @brief This method returns the component matching an identifier.
+             * @arg id
+             * - identifier returned by @ref GetComponentId.
+             * @return
+             * - the component handle, or NULL if the component was excluded meanwhile.
+             */
+            HANDLE GetComponent(uint32_t id);
+
+            /**
+             * @brief This method is used "by the kernel" to register the interest of a component in a particular message.
+             * Once a component subscribes to any message, it will be notified only of the messages it subscribed to.
+             * Components that never subscribe keep receiving every message (broadcast).
+             * @arg sComp
+             * - the handle of a registered component.
+             * @arg message
+             * - the message identifier (NM_TIMETICK, NM_KEYSCAN, etc.).
+             * @return
+             * - true if the subscription was registered.
+             * - false if the component is not registered or @ref __SYS_MAX_SUBSCRIPTIONS was reached.
+             */
+            bool Subscribe(HANDLE sComp, uint32_t message);
+
+            /**
+             * @brief This method is used "by the kernel" to cancel a subscription made by @ref Subscribe.
+             * @arg uComp
+             * - the handle of a registered component.
+             * @arg message
+             * - the message identifier.
+             * @return
+             * - true if the subscription was found and removed.
+             */
+            bool Unsubscribe(HANDLE uComp, uint32_t message);
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS system messages manager with statically allocated queues.
+	 * @arg StandardSize: number of messages of the standard level (power of two).
+	 * @arg PrioritySize: number of messages of each higher level (power of two).
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    template<uint32_t StandardSize, uint32_t PrioritySize>
+    class NStaticMessagePipe : public NMessagePipe{
+        static_assert((__SYS_PRIORITY_LEVELS >= 2) && (__SYS_PRIORITY_LEVELS <= 32),
+                      "NStaticMessagePipe: 2 to 32 priority levels");
+
+        private:
+            NStaticMessageRing<StandardSize> standard;
+            NStaticMessageRing<PrioritySize> priority[__SYS_PRIORITY_LEVELS - 1];
+            NStaticMessageRing<__SYS_DEFERRED_MESSAGES> deferral;
+
+    public:
+            /**
+             * @brief Standard constructor for this class.
+             */
+            NStaticMessagePipe(){
+                AttachQueue(__SYS_QUEUE_STANDARD, &standard);
+                for(uint32_t l=1L; l<__SYS_PRIORITY_LEVELS; l++) AttachQueue(l, &priority[l - 1]);
+                AttachDeferred(&deferral);
+            }
     };
 
 #endif
@@ -0,0 +1,305 @@
+//==============================================================================
+/**
+ * @file NMessageRing.h
+ * @brief EDROS lock-free message ring\n
+ * Multi-producer/single-consumer queue of @ref NMESSAGE used by the kernel.\n
+ * - Producers (ISRs at any priority, PendSV, main loop) reserve a cell with an
+ * atomic increment and publish it through the cell sequence number.
+ * - The consumer never waits for a producer: a cell reserved but not yet published
+ * is seen as "empty" until the producer completes.
+ * - Storage is provided by @ref NStaticMessageRing, with a compile-time
+ * power-of-two capacity (cell index = position & mask).
+ * - When full, the ring applies its overflow policy (@ref NOVERFLOW) and keeps
+ * insert/drop/spill counters and the occupancy high-watermark.
+ * - Every message has a destination: a component identifier (unicast, see
+ * @ref NRegistry) or __SYS_COMPONENT_NONE (broadcast).
+ * - A discarded message carrying a buffer handle (@ref NBufferPool) releases
+ * the buffer reference held by the message.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NMESSAGERING_H
+    #define NMESSAGERING_H
+
+    #include "NComponent.h"
+    #include "NAtomic.h"
+    #include "NBufferPool.h"
+    #include "NRegistry.h"
+    #include "NLatency.h"
+
+//------------------------------------------------------------------------------
+// message flags, kept in the ring cell next to the message
+#define __SYS_MESSAGE_PLAIN 		((uint32_t) 0x00000000)
+// "tag" carries a reference to a kernel data block (see System::PostBuffer)
+#define __SYS_MESSAGE_BUFFER 		((uint32_t) 0x00000001)
+
+    //------------------------------------------------
+	/** @brief Overflow policy of a message ring.
+ 	 */
+    enum NOVERFLOW{
+        nDropNewest,    //!< the message being inserted is discarded (default)
+        nDropOldest,    //!< the oldest queued message is discarded to make room
+        nSpillReserve   //!< the message is moved to the shared reserve pool (@ref NMessageReserve)
+    };
+
+    //------------------------------------------------
+	/**
+	 * @struct NQUEUESTATS
+	 * Message ring counters, readable at runtime.
+ 	 */
+    struct NQUEUESTATS{
+        uint32_t capacity;      //!< number of cells
+        uint32_t inserts;       //!< messages accepted (ring or reserve)
+        uint32_t drops;         //!< messages discarded by the overflow policy
+        uint32_t spills;        //!< messages moved to the reserve pool
+        uint32_t watermark;     //!< highest ring occupancy observed
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS message reserve pool.
+	 * Small pool of message blocks shared by the rings with the @ref nSpillReserve policy.
+	 * Blocks are claimed and released with atomic bit operations (ISR-safe).
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NMessageReserve{
+        protected:
+            //-------------------------------------------
+            /**
+             * @struct BLOCK
+             * Reserve block: message spilled by "owner", in spill order "ticket".
+             */
+            struct BLOCK{
+                const void* owner;
+                uint32_t ticket;
+                uint32_t target;
+                uint32_t flags;
+#ifdef __SYS_LATENCY
+                uint32_t stamp;
+#endif
+                NMESSAGE message;
+            };
+
+            /**
+             * @brief Constructor used by @ref NStaticMessageReserve.
+             * @arg storage
+             * - array of "size" blocks (up to 32).
+             */
+            NMessageReserve(BLOCK* storage, uint32_t size);
+
+        private:
+            BLOCK* blocks;
+            NAtomic free_blocks;
+            NAtomic ready_blocks;
+
+            NMessageReserve(const NMessageReserve&);
+            NMessageReserve& operator=(const NMessageReserve&);
+
+    public:
+            //-------------------------------------------
+            /**
+             * @brief Claims a free block (any context, any priority).
+             * @return
+             * - block index, or __SYS_INDEX_INVALID if the pool is exhausted.
+             */
+            uint32_t Claim();
+
+            /**
+             * @brief Fills a claimed block and makes it visible to the owner consumer.
+             */
+            void Publish(uint32_t block, const void* owner, uint32_t ticket, const NMESSAGE* Msg, uint32_t target, uint32_t flags, uint32_t stamp);
+
+            /**
+             * @brief Extracts the message spilled by "owner" with the given ticket.
+             * @return
+             * - true if the message was found (and its block released).
+             */
+            bool Take(const void* owner, uint32_t ticket, NMESSAGE* Msg, uint32_t* target, uint32_t* flags, uint32_t* stamp);
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS message reserve pool with statically allocated storage.
+	 * @arg Size: number of blocks (1 to 32).
+ 	 */
+    template<uint32_t Size>
+    class NStaticMessageReserve : public NMessageReserve{
+        static_assert((Size > 0) && (Size <= 32), "NStaticMessageReserve: 1 to 32 blocks");
+
+        private:
+            BLOCK storage[Size];
+
+    public:
+            NStaticMessageReserve() : NMessageReserve(storage, Size){}
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS lock-free message ring.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NMessageRing{
+        protected:
+            //-------------------------------------------
+            /**
+             * @struct CELL
+             * Ring cell: "sequence" tells producers and consumer who owns the cell.
+             */
+            struct CELL{
+                NAtomic sequence;
+                uint32_t target;
+                uint32_t flags;             //!< __SYS_MESSAGE_BUFFER, ...
+#ifdef __SYS_LATENCY
+                uint32_t stamp;             //!< interrupt entry (see @ref NLatency)
+#endif
+                NMESSAGE message;
+            };
+
+            /**
+             * @brief Constructor used by @ref NStaticMessageRing.
+             * @arg storage
+             * - array of "capacity" cells.
+             * @arg capacity
+             * - number of cells (power of two).
+             */
+            NMessageRing(CELL* storage, uint32_t capacity);
+
+            /**
+             * @brief Prepares the cells for the first round of producers.
+             * Called by @ref NStaticMessageRing once its storage is constructed.
+             */
+            void Reset();
+
+        private:
+            CELL* cells;
+            uint32_t mask;
+            NAtomic head;
+            NAtomic tail;
+
+            //-------------------------------------------
+            NOVERFLOW policy;
+            NMessageReserve* reserve;
+            NAtomic spill_head;
+            uint32_t spill_tail;
+            NBufferPool* buffers;
+
+            NAtomic inserts;
+            NAtomic drops;
+            NAtomic spills;
+            NAtomic watermark;
+
+            bool Push(const NMESSAGE* Msg, uint32_t target, uint32_t flags, uint32_t stamp);
+            bool Pop(NMESSAGE* Msg, uint32_t* target, uint32_t* flags, uint32_t* stamp);
+            bool Spill(const NMESSAGE* Msg, uint32_t target, uint32_t flags, uint32_t stamp);
+            void Discard(const NMESSAGE* Msg, uint32_t flags);
+
+            NMessageRing(const NMessageRing&);
+            NMessageRing& operator=(const NMessageRing&);
+
+    public:
+            //-------------------------------------------
+            // METHODS
+
+            /**
+             * @brief Inserts a message in the ring (any context, any priority).
+             * When the ring is full, the overflow policy is applied.
+             * @arg Msg
+             * - pointer to the @ref NMESSAGE to be copied into the ring.
+             * @arg target
+             * - destination component identifier, or __SYS_COMPONENT_NONE (broadcast).
+             * @arg flags
+             * - @ref __SYS_MESSAGE_BUFFER if "tag" carries a data block reference, which is
+             * released if the message is discarded.
+             * @return
+             * - true if the message was inserted (in the ring or in the reserve pool).
+             * - false if the message was discarded.
+             */
+            bool Put(const NMESSAGE* Msg, uint32_t target = __SYS_COMPONENT_NONE, uint32_t flags = __SYS_MESSAGE_PLAIN);
+
+            /**
+             * @brief Extracts the oldest message from the ring (single consumer only).
+             * Messages spilled to the reserve pool are extracted after the ones in the ring.
+             * @arg Msg
+             * - pointer to the @ref NMESSAGE to receive the message.
+             * @arg target
+             * - receives the destination component identifier (may be NULL).
+             * @arg stamp
+             * - receives the interrupt entry stamp of the message, 0 if not measured
+             * or without __SYS_LATENCY (may be NULL).
+             * @arg flags
+             * - receives the flags given to @ref Put (may be NULL).
+             * @return
+             * - true if a message was extracted.
+             * - false if the ring is empty.
+             */
+            bool Get(NMESSAGE* Msg, uint32_t* target = NULL, uint32_t* stamp = NULL, uint32_t* flags = NULL);
+
+            /**
+             * @brief Returns the number of messages in the ring (including messages being inserted).
+             */
+            uint32_t Counter();
+
+            /**
+             * @brief Returns the ring capacity.
+             */
+            uint32_t Capacity();
+
+            /**
+             * @brief Selects the overflow policy.
+             * @arg Policy
+             * - @ref NOVERFLOW policy.
+             * @arg Reserve
+             * - reserve pool (required by @ref nSpillReserve, ignored otherwise).
+             * @return
+             * - false if nSpillReserve was requested without a reserve pool.
+             */
+            bool SetOverflow(NOVERFLOW Policy, NMessageReserve* Reserve);
+
+            /**
+             * @brief Selects the buffer pool whose references are released by discarded
+             * messages (those inserted with @ref __SYS_MESSAGE_BUFFER).
+             * @arg Pool
+             * - buffer pool, or NULL (messages are discarded as they are).
+             */
+            void SetBufferPool(NBufferPool* Pool){ buffers = Pool;}
+
+            /**
+             * @brief Reads the ring counters.
+             * @arg Stats
+             * - pointer to the @ref NQUEUESTATS to be filled in.
+             */
+            void GetStats(NQUEUESTATS* Stats);
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS lock-free message ring with statically allocated storage.
+	 * @arg Size: number of messages (must be a power of two).
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    template<uint32_t Size>
+    class NStaticMessageRing : public NMessageRing{
+        static_assert((Size > 0) && ((Size & (Size - 1)) == 0),
+                      "NStaticMessageRing: capacity must be a power of two");
+
+        private:
+            CELL storage[Size];
+
+    public:
+            /**
+             * @brief Standard constructor for this class.
+             */
+            NStaticMessageRing() : NMessageRing(storage, Size){ Reset();}
+    };
+
+#endif
+
+//==============================================================================
@@ -0,0 +1,248 @@
+//==============================================================================
+/**
+ * @file NPort.h
+ * @brief EDROS port layer\n
+ * Hardware accessed by the kernel: SysTick, PendSV, sleep and thread contexts.\n
+ * - Cortex-M3 (default): inline CMSIS register accesses. With -DEDROS_QEMU the same
+ * port runs on the QEMU STM32 board model (Qemu/NQemu.h).
+ * - Linux host (-DEDROS_HOST): emulated core (Host/NHost.cpp). The interrupts are
+ * delivered to the thread running the kernel as a signal, at their NVIC priority,
+ * and masked by the emulated PRIMASK; SysTick is a timer thread. The CMSIS
+ * intrinsics and the NVIC functions used by the kernel come from Host/DRV_CPU.h.
+ * - Critical sections keep using the CMSIS intrinsics (__disable_irq, __get_PRIMASK,
+ * __set_PRIMASK) on both ports.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This file must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NPORT_H
+    #define NPORT_H
+
+    #include <stdint.h>
+    #include "DRV_CPU.h"
+
+//------------------------------------------------------------------------------
+// SysTick counter width
+#define __SYS_TICK_RELOAD_MAX 		((uint32_t) 0x00FFFFFF)
+
+#ifndef EDROS_HOST
+//------------------------------------------------------------------------------
+// Cortex-M3
+//------------------------------------------------------------------------------
+#define __SYS_EXC_RETURN_MSP 		((uint32_t) 0xFFFFFFF9)
+#define __SYS_EXC_RETURN_PSP 		((uint32_t) 0xFFFFFFFD)
+#define __SYS_XPSR_THUMB 			((uint32_t) 0x01000000)
+
+#ifdef EDROS_QEMU
+// QEMU board model (stm32vldiscovery, see Qemu/NQemu.h): fixed system clock, the
+// clock tree (RCC) is not emulated
+#define __SYS_QEMU_CLOCK 			((uint32_t) 24000000)
+#endif
+
+    //------------------------------------------------
+	/**
+	 * @struct NPORTCONTEXT
+	 * Saved context of a thread (offsets used by the PendSV context switch).
+ 	 */
+    struct NPORTCONTEXT{
+        uint32_t* sp;               //!< saved stack pointer
+        uint32_t exc_return;        //!< EXC_RETURN: main or process stack
+    };
+
+    /**
+     * @brief Sets up the core before the kernel starts (nothing to do on the target).
+     */
+    static inline void NPortInitialize(){}
+
+    //------------------------------------------------
+    // PendSV: callback notifications and context switch
+    static inline void NPortSetPendSV(){ SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;}
+    static inline void NPortClearPendSV(){ SCB->ICSR &= ~SCB_ICSR_PENDSVSET_Msk;}
+
+    /**
+     * @brief Checks if the caller runs in an interrupt handler.
+     */
+    static inline bool NPortInHandler(){ return((SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0L);}
+
+    /**
+     * @brief Sleeps up to the next interrupt (also woken if the interrupts are masked).
+     */
+    static inline void NPortWaitForInterrupt(){ __DSB(); __WFI();}
+
+    /**
+     * @brief Sleeps again after the last handler returns, instead of resuming the main loop.
+     */
+    static inline void NPortSleepOnExit(bool enable){
+        __DSB();
+        if(enable){ SCB->SCR |= SCB_SCR_SLEEPONEXIT_Msk;}
+        else { SCB->SCR &= ~SCB_SCR_SLEEPONEXIT_Msk;}
+    }
+
+    /**
+     * @brief Selects the deep sleep (Stop, or Standby) for the next WFI.
+     */
+    static inline void NPortDeepSleep(bool enable){
+        if(enable){ SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;}
+        else { SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;}
+    }
+
+    /**
+     * @brief Standby instead of Stop in deep sleep: the core restarts from reset on wake-up.
+     */
+    static inline void NPortStandby(bool enable){
+        RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+        if(enable){ PWR->CR |= (PWR_CR_PDDS | PWR_CR_CWUF);}
+        else { PWR->CR &= ~PWR_CR_PDDS;}
+    }
+
+    //------------------------------------------------
+    // SysTick: 24-bit down counter, interrupt when it reaches 0, then reloaded
+    static inline void NPortTickStart(){
+        SysTick->CTRL |= (SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
+    }
+
+    /**
+     * @brief Stops the counter.
+     * @return
+     * - true if the counter reached 0 since the last call (COUNTFLAG).
+     */
+    static inline bool NPortTickStop(){
+        uint32_t ctrl = SysTick->CTRL;	// reading clears COUNTFLAG
+        SysTick->CTRL = ctrl & ~(SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
+        return((ctrl & SysTick_CTRL_COUNTFLAG_Msk) != 0L);
+    }
+
+    static inline uint32_t NPortTickCount(){ return(SysTick->VAL);}
+    static inline void NPortTickClear(){ SysTick->VAL = 0L;}
+    static inline uint32_t NPortTickGetLoad(){ return(SysTick->LOAD);}
+    static inline void NPortTickSetLoad(uint32_t load){ SysTick->LOAD = load & __SYS_TICK_RELOAD_MAX;}
+
+    /**
+     * @brief Checks if the tick interrupt is pending (ended, handler not run yet).
+     */
+    static inline bool NPortTickPending(){ return((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0L);}
+
+    //------------------------------------------------
+    // threads
+    static inline void NPortClearContext(NPORTCONTEXT* Context){
+        Context->sp = 0;
+        Context->exc_return = __SYS_EXC_RETURN_MSP;
+    }
+
+    /**
+     * @brief Builds the first context of a thread: the frame popped by its first switch,
+     * r4-r11 (software), then r0-r3, r12, lr, pc and xPSR (exception return).
+     * @arg stack, words
+     * - stack area and its size in 32-bit words.
+     * @arg exit
+     * - return address of "entry".
+     */
+    static inline void NPortInitContext(NPORTCONTEXT* Context, uint32_t* stack, uint32_t words,
+                                        void (*entry)(void*), void* argument, void (*exit)()){
+        uint32_t* top = (uint32_t*)((uintptr_t)(stack + words) & ~(uintptr_t)7);
+
+        *(--top) = __SYS_XPSR_THUMB;
+        *(--top) = (uint32_t)(uintptr_t)entry & ~1UL;
+        *(--top) = (uint32_t)(uintptr_t)exit;
+        for(uint32_t r=0L; r<4; r++) *(--top) = 0L;     // r12, r3, r2, r1
+        *(--top) = (uint32_t)(uintptr_t)argument;       // r0
+        for(uint32_t r=0L; r<8; r++) *(--top) = 0L;     // r11 - r4
+
+        Context->sp = top;
+        Context->exc_return = __SYS_EXC_RETURN_PSP;
+    }
+
+#else
+//------------------------------------------------------------------------------
+// Linux host (Host/NHost.cpp)
+//------------------------------------------------------------------------------
+    #include <ucontext.h>
+
+// number of emulated exceptions (16 core exceptions, then the IRQs)
+#define __SYS_HOST_EXCEPTIONS 		((uint32_t) 128)
+
+    //------------------------------------------------
+	/**
+	 * @struct NPORTCONTEXT
+	 * Saved context of a thread.
+ 	 */
+    struct NPORTCONTEXT{
+        ucontext_t context;
+        void (*entry)(void*);
+        void* argument;
+        void (*exit)();
+    };
+
+    void NPortInitialize();
+
+    void NPortSetPendSV();
+    void NPortClearPendSV();
+    bool NPortInHandler();
+    void NPortWaitForInterrupt();
+    void NPortSleepOnExit(bool enable);
+    void NPortDeepSleep(bool enable);
+    void NPortStandby(bool enable);
+
+    void NPortTickStart();
+    bool NPortTickStop();
+    uint32_t NPortTickCount();
+    void NPortTickClear();
+    uint32_t NPortTickGetLoad();
+    void NPortTickSetLoad(uint32_t load);
+    bool NPortTickPending();
+
+    void NPortClearContext(NPORTCONTEXT* Context);
+    void NPortInitContext(NPORTCONTEXT* Context, uint32_t* stack, uint32_t words,
+                          void (*entry)(void*), void* argument, void (*exit)());
+
+    /**
+     * @brief Saves the running context in "From" and resumes "To" (PendSV).
+     */
+    void NPortSwitchContext(NPORTCONTEXT* From, NPORTCONTEXT* To);
+
+    //------------------------------------------------
+    // simulated peripherals
+    /**
+     * @brief Installs the handler of an exception (16 + IRQ number), as the vector table does.
+     */
+    void NPortSetVector(uint32_t exception, void (*handler)(void));
+
+    /**
+     * @brief Makes an exception pending (any host thread): its handler preempts the
+     * kernel as soon as its priority and PRIMASK allow.
+     */
+    void NPortRaise(uint32_t exception);
+#endif
+
+//------------------------------------------------------------------------------
+// Both ports
+//------------------------------------------------------------------------------
+    /**
+     * @brief Enters a short critical section (all maskable interrupts), nestable.
+     * @return
+     * - previous PRIMASK, to be given to @ref NPortUnlock.
+     */
+    static inline uint32_t NPortLock(){
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        return(primask);
+    }
+
+    /**
+     * @brief Leaves the critical section entered by @ref NPortLock.
+     */
+    static inline void NPortUnlock(uint32_t primask){ __set_PRIMASK(primask);}
+
+#endif
+//==============================================================================
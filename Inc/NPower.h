@@ -0,0 +1,236 @@
+//==============================================================================
+/**
+ * @file NPower.h
+ * @brief EDROS low-power governor\n
+ * Selects the power mode of each idle entry of the main loop (enabled with -D__SYS_POWER,
+ * effective while @ref System::Sleep is ON).\n
+ * - Modes, from the lightest: Run (no sleep, the main loop polls), Sleep (WFI, the
+ * clocks keep running), Stop (SLEEPDEEP: clocks stopped, RAM and registers kept) and
+ * Standby (SLEEPDEEP and PDDS: the core restarts from reset on wake-up).
+ * - Constraints: a component forbids the modes deeper than a given one while it holds
+ * an @ref NPowerConstraint (e.g. UART reception or a DMA transfer running: nPowerSleep,
+ * their clocks would stop). The application sets the deepest mode allowed and the
+ * longest wake-up latency it tolerates (System::SetPowerPolicy).
+ * - Choice: the deepest mode allowed whose wake-up latency meets the policy and whose
+ * break-even time (@ref __SYS_POWER_STOP_RESIDENCY) and latency fit in the ticks left
+ * up to the next kernel deadline.
+ * - Latency of a mode: the wake-up time of the device (datasheet, @ref __SYS_POWER_STOP_WAKEUP)
+ * plus the longest resume measured (clock restart after Stop, with the cycle counter: the
+ * cycles up to @ref NPowerClockRestored count at @ref __SYS_POWER_RESUME_CLOCK, the
+ * following ones at the restored core clock).
+ * - SysTick stops in Stop and Standby: a timed deep idle needs a wake-up timer running in
+ * those modes (RTC alarm, ApplicationWakeupStart); without one Stop is chosen only
+ * when no deadline is pending, and the kernel time does not advance while stopped.
+ * - Standby is never entered without a deadline: it wakes up only on WKUP, the RTC or
+ * the IWDG, and could leave the device asleep indefinitely.
+ * - An untimed Stop lasts up to the next external interrupt. The IWDG keeps counting in
+ * Stop: with it running, limit the policy to nPowerSleep, or keep a kernel timer shorter
+ * than its period together with a wake-up timer, so that every Stop is bounded.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NPOWER_H
+    #define NPOWER_H
+
+    #include "NProfiler.h"
+
+//------------------------------------------------------------------------------
+// deepest mode allowed by default (Standby restarts the application: opt-in)
+#ifndef __SYS_POWER_DEEPEST
+	#define __SYS_POWER_DEEPEST 		nPowerStop
+#endif
+// wake-up time of the device, without the resume (microseconds)
+#ifndef __SYS_POWER_SLEEP_WAKEUP
+	#define __SYS_POWER_SLEEP_WAKEUP 	((uint32_t) 1)
+#endif
+#ifndef __SYS_POWER_STOP_WAKEUP
+	#define __SYS_POWER_STOP_WAKEUP 	((uint32_t) 5)
+#endif
+// reset and start-up up to the application (microseconds)
+#ifndef __SYS_POWER_STANDBY_WAKEUP
+	#define __SYS_POWER_STANDBY_WAKEUP 	((uint32_t) 10000)
+#endif
+// shortest idle period worth the mode (ticks)
+#ifndef __SYS_POWER_STOP_RESIDENCY
+	#define __SYS_POWER_STOP_RESIDENCY 	((uint32_t) 5)
+#endif
+#ifndef __SYS_POWER_STANDBY_RESIDENCY
+	#define __SYS_POWER_STANDBY_RESIDENCY 	((uint32_t) 1000)
+#endif
+// clock of the core while it resumes from Stop (HSI): converts the measured cycles
+#ifndef __SYS_POWER_RESUME_CLOCK
+	#define __SYS_POWER_RESUME_CLOCK 	((uint32_t) 8000000)
+#endif
+// no deadline pending
+#define __SYS_POWER_FOREVER 		((uint32_t) 0xFFFFFFFF)
+
+    //------------------------------------------------
+	/**
+	 * @enum NPOWERMODE
+	 * Power modes, from the lightest to the deepest.
+ 	 */
+    enum NPOWERMODE{ nPowerRun = 0, nPowerSleep, nPowerStop, nPowerStandby, nPowerModes};
+
+    //------------------------------------------------
+	/**
+	 * @struct NPOWERSTATS
+	 * Use of a power mode.
+ 	 */
+    struct NPOWERSTATS{
+        uint32_t entries;       //!< idle periods in the mode
+        uint32_t latency;       //!< wake-up latency: device + longest resume (microseconds)
+        uint32_t resume;        //!< longest resume measured (microseconds)
+        uint32_t locks;         //!< constraints held limiting the idle to this mode
+    };
+
+    //------------------------------------------------
+    // board hooks (weak, System.cpp), called with the interrupts masked
+    /**
+     * @brief Arms a wake-up timer running in Stop and Standby (RTC alarm).
+     * @arg ms
+     * - milliseconds up to the wake-up.
+     * @return
+     * - false if the board has none (default): the deep modes are then chosen only
+     * when no kernel deadline is pending.
+     */
+    bool ApplicationWakeupStart(uint32_t ms);
+
+    /**
+     * @brief Disarms the wake-up timer after a deep idle period.
+     * @return the milliseconds elapsed since ApplicationWakeupStart.
+     */
+    uint32_t ApplicationWakeupStop();
+
+    /**
+     * @brief Restores the clocks after Stop (default: the clock setup of main, then
+     * NPowerClockRestored).
+     */
+    void ApplicationResume(NPOWERMODE mode);
+
+    /**
+     * @brief Called by ApplicationResume as soon as the core clock is back: the resume
+     * cycles counted before run at @ref __SYS_POWER_RESUME_CLOCK, those after at
+     * SystemCoreClock. Without this call the whole resume is converted at SystemCoreClock.
+     */
+    void NPowerClockRestored();
+
+#ifdef __SYS_POWER
+
+    //------------------------------------------------
+	/** @brief EDROS low-power governor.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NPower{
+        private:
+            static volatile uint32_t locks[nPowerModes];
+            static NPOWERMODE deepest;
+            static uint32_t latencyMax;         // tolerated wake-up latency (us, 0: any)
+            static bool wakeupTimer;            // ApplicationWakeupStart available
+            static uint32_t wakeup[nPowerModes];
+            static uint32_t resume[nPowerModes];
+            static uint32_t entries[nPowerModes];
+            static uint32_t residency[nPowerModes];
+            static uint32_t frequency;          // cycle counter while resuming (Hz)
+            static uint32_t resumeStamp;        // cycle counter at the wake-up
+            static uint32_t clockStamp;         // cycle counter when the clock was restored
+            static bool resuming;
+            static bool clockRestored;
+
+            static uint32_t CoreClock();
+
+            static bool Fits(uint32_t mode, uint32_t ticks);
+
+            NPower();
+
+    public:
+            /**
+             * @brief Resets the policy and the statistics (called by System::Initialize).
+             * @arg frequency
+             * - frequency of the cycle counter while resuming, in Hz.
+             */
+            static void Initialize(uint32_t frequency);
+
+            /**
+             * @brief Deepest mode allowed and tolerated wake-up latency (microseconds, 0: any).
+             */
+            static void SetPolicy(NPOWERMODE deepest, uint32_t latency);
+
+            /**
+             * @brief Adds or removes a constraint limiting the idle to "mode" (any context).
+             */
+            static void Lock(NPOWERMODE mode);
+            static void Unlock(NPOWERMODE mode);
+
+            /**
+             * @brief Selects the mode of an idle entry (interrupts masked).
+             * @arg ticks
+             * - ticks up to the next kernel deadline (@ref __SYS_POWER_FOREVER if none).
+             */
+            static NPOWERMODE Select(uint32_t ticks);
+
+            /**
+             * @brief The board has no wake-up timer (ApplicationWakeupStart failed).
+             */
+            static void NoWakeupTimer();
+
+            /**
+             * @brief Marks the wake-up from a deep mode: the resume is measured from here.
+             */
+            static void Resuming();
+
+            /**
+             * @brief Marks the restart of the core clock during the resume.
+             */
+            static void ClockRestored();
+
+            /**
+             * @brief Accounts an idle period in "mode", with the resume measured since Resuming.
+             */
+            static void Resumed(NPOWERMODE mode);
+
+            /**
+             * @brief Wake-up latency of a mode (microseconds).
+             */
+            static uint32_t Latency(uint32_t mode);
+
+            /**
+             * @brief Reads the statistics of a mode.
+             * @return
+             * - false if "mode" is invalid.
+             */
+            static bool Get(NPOWERMODE mode, NPOWERSTATS* Stats);
+    };
+#endif
+
+    //------------------------------------------------
+	/** @brief Power constraint of a component: while held, the modes deeper than
+	 * "mode" are not used (e.g. reception running: nPowerSleep). Acquire and Release
+	 * may be called from any context, repeatedly; without -D__SYS_POWER they do nothing.
+ 	 */
+    class NPowerConstraint{
+        private:
+            NPOWERMODE mode;
+            volatile bool held;
+
+        public:
+            NPowerConstraint(NPOWERMODE deepest){ mode = deepest; held = false;}
+            ~NPowerConstraint(){ Release();}
+
+            void Acquire();
+            void Release();
+            bool IsHeld(){ return(held);}
+    };
+
+#endif
+//==============================================================================
@@ -0,0 +1,169 @@
+//==============================================================================
+/**
+ * @file NProfiler.h
+ * @brief EDROS execution-time profiler\n
+ * Measures the time spent in the components (enabled with -D__SYS_PROFILER).\n
+ * - Every Notify() called by the message pipe and every InterruptCallBack() called
+ * by the callback path is timed with the DWT cycle counter (nanoseconds on the
+ * host port).
+ * - Counters are kept per component (notifications and callbacks apart) and per
+ * message identifier: calls, minimum, average and maximum cycles. The component
+ * counters are keyed by the component identifier: a component that takes the slot
+ * of an excluded one starts from zero.
+ * - Times are inclusive: a component that dispatches while it waits
+ * (System::WaitFor) is also charged the components notified meanwhile.
+ * - Compiled out, the instrumentation macros expand to nothing.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NPROFILER_H
+    #define NPROFILER_H
+
+    #include "NComponent.h"
+
+//------------------------------------------------------------------------------
+// number of message identifiers profiled (power of two)
+#ifndef __SYS_PROFILE_MESSAGES
+	#define __SYS_PROFILE_MESSAGES 		((uint32_t) 32)
+#endif
+
+    //------------------------------------------------
+	/**
+	 * @struct NPROFILESTATS
+	 * Execution-time counters of a component or a message, in cycles.
+ 	 */
+    struct NPROFILESTATS{
+        uint32_t key;           //!< component identifier or message identifier
+        uint32_t calls;         //!< number of calls
+        uint32_t min;           //!< shortest call
+        uint32_t max;           //!< longest call
+        uint32_t average;       //!< total / calls
+        uint64_t total;         //!< time of all calls
+    };
+
+//------------------------------------------------------------------------------
+// cycle counter, shared by the profiler, the latency histograms (@ref NLatency),
+// the event trace (@ref NTrace), the message recorder (@ref NRecorder), the
+// load accounting (@ref NLoad) and the power governor (@ref NPower)
+#if defined(__SYS_PROFILER) || defined(__SYS_LATENCY) || defined(__SYS_TRACE) || defined(__SYS_RECORD) || defined(__SYS_LOAD) || defined(__SYS_POWER)
+    #include "DRV_CPU.h"
+#ifdef EDROS_HOST
+    #include <time.h>
+#endif
+
+    /**
+     * @brief Starts the cycle counter (DWT).
+     */
+    static inline void NStartCycles(){
+#ifndef EDROS_HOST
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0L;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    }
+
+    /**
+     * @brief Reads the cycle counter (nanoseconds on the host port).
+     */
+    static inline uint32_t NCycles(){
+#ifndef EDROS_HOST
+        return(DWT->CYCCNT);
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return((uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec));
+#endif
+    }
+#endif
+
+#ifdef __SYS_PROFILER
+
+    //------------------------------------------------
+	/** @brief EDROS execution-time profiler.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NProfiler{
+        private:
+            struct RECORD{
+                uint32_t key;
+                uint32_t calls;
+                uint32_t min;
+                uint32_t max;
+                uint64_t total;
+            };
+
+            RECORD notifications[__SYS_MAX_OBJECTS];
+            RECORD callbacks[__SYS_MAX_OBJECTS];
+            RECORD messages[__SYS_PROFILE_MESSAGES];
+            uint32_t overflows;
+
+            static void Update(RECORD* record, uint32_t cycles);
+            static void Read(const RECORD* record, NPROFILESTATS* Stats);
+            static RECORD* Component(RECORD* table, uint32_t id);
+            RECORD* Message(uint32_t message);
+
+            NProfiler(const NProfiler&);
+            NProfiler& operator=(const NProfiler&);
+
+    public:
+            NProfiler();
+
+            /**
+             * @brief Records a notification (Notify) of a component (identifier: generation << 16 | slot).
+             */
+            void Notified(uint32_t id, uint32_t message, uint32_t cycles);
+
+            /**
+             * @brief Records a callback (InterruptCallBack) of a component (identifier).
+             */
+            void Called(uint32_t id, uint32_t message, uint32_t cycles);
+
+            /**
+             * @brief Reads the counters of a component (identifier).
+             * @return
+             * - false if "id" is invalid.
+             */
+            bool GetComponent(uint32_t id, NPROFILESTATS* Notify, NPROFILESTATS* Callback);
+
+            /**
+             * @brief Reads the counters of the messages, one at a time.
+             * @arg index
+             * - 0 up to the first false return.
+             */
+            bool GetMessage(uint32_t index, NPROFILESTATS* Stats);
+
+            /**
+             * @brief Number of message identifiers not profiled (table full).
+             */
+            uint32_t GetOverflows(){ return(overflows);}
+
+            /**
+             * @brief Clears all counters.
+             */
+            void Reset();
+    };
+
+    //------------------------------------------------
+    #define NPROFILE_START(t)                       uint32_t t = NCycles()
+    #define NPROFILE_NOTIFY(p, t, id, message)      if((p) != NULL){ (p)->Notified((id), (message), NCycles() - (t));}
+    #define NPROFILE_CALLBACK(p, t, id, message)    if((p) != NULL){ (p)->Called((id), (message), NCycles() - (t));}
+#else
+    #define NPROFILE_START(t)
+    #define NPROFILE_NOTIFY(p, t, id, message)
+    #define NPROFILE_CALLBACK(p, t, id, message)
+#endif
+
+#endif
+//==============================================================================
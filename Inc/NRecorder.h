@@ -0,0 +1,185 @@
+//==============================================================================
+/**
+ * @file NRecorder.h
+ * @brief EDROS message recorder\n
+ * Records every message passed to System::Dispatch and to the message pipe
+ * (Insert, Send), with its time, for an offline replay (enabled with -D__SYS_RECORD).\n
+ * - Each record is 28 bytes: cycle counter, kind, origin, queue level, exception
+ * number, destination and the whole @ref NMESSAGE.
+ * - The origin tells the replay which messages come from outside the kernel:
+ *   - __SYS_ORIGIN_INTERRUPT: peripheral interrupt handler (the stimuli to replay);
+ *   - __SYS_ORIGIN_THREAD: thread mode, outside of a dispatch (application start, threads);
+ *   - __SYS_ORIGIN_DERIVED: caused by another message (Notify, InterruptCallBack,
+ *     System::Dispatch routing), reproduced by the replay itself;
+ *   - __SYS_ORIGIN_KERNEL: SysTick and PendSV (timers, periodic messages).
+ * - Records are kept in a RAM ring until the application drains them
+ * (System::ReadRecords) to a serial port, a file or a debugger. When the ring is
+ * full new records are lost and counted. The drained chunks (@ref NRECORDHEADER
+ * followed by the records) make the stream: Host/NReplay.h feeds it back into a
+ * host build with the same timing, tools/edros_record.py lists and compares streams.
+ * - Compiled out, the instrumentation macros expand to nothing.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NRECORDER_H
+    #define NRECORDER_H
+
+    #include "NComponent.h"
+    #include "NProfiler.h"
+    #include "NAtomic.h"
+
+//------------------------------------------------------------------------------
+#define __SYS_RECORD_MAGIC 			((uint32_t) 0x52524445)		// "EDRR"
+#define __SYS_RECORD_VERSION 		((uint32_t) 1)
+// number of records kept until drained (power of two)
+#ifndef __SYS_RECORD_EVENTS
+	#define __SYS_RECORD_EVENTS 		((uint32_t) 128)
+#endif
+
+//------------------------------------------------------------------------------
+// record kinds
+#define __SYS_RECORD_DISPATCH 		((uint32_t) 1)		// System::Dispatch
+#define __SYS_RECORD_INSERT 		((uint32_t) 2)		// NMessagePipe::Insert (broadcast)
+#define __SYS_RECORD_SEND 			((uint32_t) 3)		// NMessagePipe::Send (unicast)
+
+// origins (info, bits 0-1)
+#define __SYS_ORIGIN_THREAD 		((uint32_t) 0)
+#define __SYS_ORIGIN_INTERRUPT 		((uint32_t) 1)
+#define __SYS_ORIGIN_DERIVED 		((uint32_t) 2)
+#define __SYS_ORIGIN_KERNEL 		((uint32_t) 3)
+
+// info: origin | accepted | queue level
+#define __SYS_RECORD_ORIGIN 		((uint32_t) 0x03)
+#define __SYS_RECORD_ACCEPTED 		((uint32_t) 0x04)
+#define __SYS_RECORD_LEVEL_SHIFT 	((uint32_t) 3)
+
+    //------------------------------------------------
+	/**
+	 * @struct NRECORD
+	 * Message record (28 bytes, little-endian in the stream).
+ 	 */
+    struct NRECORD{
+        uint32_t time;          //!< cycle counter
+        uint8_t kind;           //!< __SYS_RECORD_* (0: being written)
+        uint8_t info;           //!< origin, accepted, queue level (see __SYS_RECORD_ORIGIN)
+        uint16_t vector;        //!< active exception number (0: thread mode)
+        uint32_t target;        //!< destination component identifier (Send), or 0
+        NMESSAGE message;       //!< the message as passed
+    };
+
+    //------------------------------------------------
+	/**
+	 * @struct NRECORDHEADER
+	 * Header of a drained chunk of records (20 bytes).
+ 	 */
+    struct NRECORDHEADER{
+        uint32_t magic;         //!< __SYS_RECORD_MAGIC
+        uint16_t version;       //!< __SYS_RECORD_VERSION
+        uint16_t size;          //!< sizeof(NRECORD)
+        uint32_t clock;         //!< counter frequency in Hz
+        uint32_t count;         //!< number of records that follow
+        uint32_t lost;          //!< records lost (ring full) since the previous chunk
+    };
+
+#ifdef __SYS_RECORD
+
+    //------------------------------------------------
+	/** @brief EDROS message recorder.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NRecorder{
+        private:
+            static NRECORD records[__SYS_RECORD_EVENTS];
+            static NAtomic head;                // records claimed
+            static volatile uint32_t tail;      // records drained
+            static NAtomic lost;
+            static uint32_t clock;
+            static volatile uint32_t enabled;
+            static volatile uint32_t derived;   // current context handles another message
+
+            NRecorder();
+
+    public:
+            /**
+             * @brief Empties the ring and starts recording (called by System::Initialize).
+             * @arg clock
+             * - frequency of the cycle counter in Hz.
+             */
+            static void Initialize(uint32_t clock);
+
+            /**
+             * @brief Starts or stops recording.
+             */
+            static void Enable(bool enable){ enabled = enable? 1L : 0L;}
+
+            /**
+             * @brief Records a message (any context).
+             * @arg nested
+             * - the message pipe is dispatching a message (Notify).
+             */
+            static void Record(uint32_t kind, uint32_t level, uint32_t target, const NMESSAGE* Msg,
+                               bool accepted, bool nested);
+
+            /**
+             * @brief Drains the oldest records (single consumer).
+             * @arg header
+             * - receives the chunk header.
+             * @return
+             * - number of records copied.
+             */
+            static uint32_t Read(NRECORDHEADER* header, NRECORD* buffer, uint32_t max);
+
+            //-------------------------------------------
+            /**
+             * @brief Entry of an interrupt handler: its messages are not derived (see @ref NIrqScope).
+             * @return
+             * - the state of the interrupted context, for @ref Leave.
+             */
+            static uint32_t Enter(){ uint32_t previous = derived; derived = 0L; return(previous);}
+
+            /**
+             * @brief The messages recorded from now on are caused by the current one.
+             */
+            static uint32_t Derive(){ uint32_t previous = derived; derived = 1L; return(previous);}
+
+            /**
+             * @brief Restores the state saved by @ref Enter or @ref Derive.
+             */
+            static void Leave(uint32_t previous){ derived = previous;}
+    };
+
+    //------------------------------------------------
+	/** @brief Marks the messages recorded within a block as derived.
+ 	 */
+    class NRecordScope{
+        private:
+            uint32_t previous;
+
+    public:
+            NRecordScope(){ previous = NRecorder::Derive();}
+            ~NRecordScope(){ NRecorder::Leave(previous);}
+    };
+
+    //------------------------------------------------
+    #define NRECORD(kind, level, target, Msg, accepted, nested) \
+                NRecorder::Record((kind), (level), (target), (Msg), (accepted), (nested))
+    #define NRECORD_DERIVED()       NRecordScope record_scope
+#else
+    #define NRECORD(kind, level, target, Msg, accepted, nested)
+    #define NRECORD_DERIVED()
+#endif
+
+#endif
+//==============================================================================
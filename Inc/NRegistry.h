@@ -0,0 +1,177 @@
+//==============================================================================
+/**
+ * @file NRegistry.h
+ * @brief EDROS component registry\n
+ * Slot map holding the components registered in the message pipe.\n
+ * - Include, exclude and find run in constant time: a free-slot stack hands out
+ * slots and a small open-addressing table maps a component handle to its slot.
+ * - Slots are reused, so their numbers say nothing about the inclusion order: a
+ * doubly linked list indexed by slot keeps the registered slots in inclusion order
+ * (the order in which broadcasts are delivered), and every slot has an inclusion
+ * rank to sort a few of them. Until a slot is reused below a newer component, the
+ * slot numbers follow the inclusion order and neither is needed. Exclude unlinks the slot but keeps its link to the
+ * next one, so a walk of the list survives the exclusion of its current slot.
+ * - Include, exclude and release run with the interrupts masked: Find, Identify
+ * and Resolve may be called from any context.
+ * - Every slot has a generation counter, so a component identifier
+ * (generation << 16 | slot) becomes invalid as soon as the component is excluded,
+ * even if the slot is later reused by another component.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NREGISTRY_H
+    #define NREGISTRY_H
+
+    #include "NComponent.h"
+
+//------------------------------------------------------------------------------
+#define __SYS_OBJECT_WORDS 			((uint32_t)((__SYS_MAX_OBJECTS + 31) / 32))
+#ifndef __SYS_REGISTRY_BUCKETS
+	#define __SYS_REGISTRY_BUCKETS 	((uint32_t) 128)
+#endif
+#define __SYS_COMPONENT_NONE 		((uint32_t) 0)
+#define __SYS_SLOT_NONE 			((uint16_t) 0xFFFF)
+
+    //------------------------------------------------
+	/** @brief EDROS component registry.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NRegistry{
+        static_assert(__SYS_MAX_OBJECTS < 0xFFFF, "NRegistry: too many objects");
+        static_assert((__SYS_REGISTRY_BUCKETS >= (2 * __SYS_MAX_OBJECTS)) &&
+                      ((__SYS_REGISTRY_BUCKETS & (__SYS_REGISTRY_BUCKETS - 1)) == 0),
+                      "NRegistry: buckets must be a power of two, at least twice __SYS_MAX_OBJECTS");
+
+        private:
+            HANDLE objects[__SYS_MAX_OBJECTS];
+            uint16_t generations[__SYS_MAX_OBJECTS];
+            uint16_t free_slots[__SYS_MAX_OBJECTS];
+            uint16_t buckets[__SYS_REGISTRY_BUCKETS];
+            uint16_t older[__SYS_MAX_OBJECTS];      // inclusion order list
+            uint16_t newer[__SYS_MAX_OBJECTS];
+            uint16_t oldest;
+            uint16_t newest;
+            bool ordered;                           // slot order is the inclusion order
+            uint32_t ranks[__SYS_MAX_OBJECTS];      // inclusion number of each slot
+            uint32_t next_rank;
+            uint32_t free_number;
+            uint32_t objects_number;
+
+            uint32_t Hash(HANDLE comp);
+            void Unlink(uint32_t bucket);
+
+    public:
+            /**
+             * @brief Bitmap of the registered components (one bit per slot).
+             */
+            uint32_t live[__SYS_OBJECT_WORDS];
+
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Standard constructor for this class.
+             */
+            NRegistry();
+
+            /**
+             * @brief Registers a component.
+             * @return
+             * - the component slot, or __SYS_INDEX_INVALID if the component is already
+             * registered or @ref __SYS_MAX_OBJECTS was reached.
+             */
+            uint32_t Include(HANDLE comp);
+
+            /**
+             * @brief Unregisters a component, keeping its slot reserved until @ref Release.
+             * From now on the component is not found and receives no notification.
+             * @return
+             * - the component slot, or __SYS_INDEX_INVALID if not registered.
+             */
+            uint32_t Detach(HANDLE comp);
+
+            /**
+             * @brief Returns a detached slot to the free list and invalidates its identifiers.
+             */
+            void Release(uint32_t slot);
+
+            /**
+             * @brief Finds the slot of a registered component.
+             * @return
+             * - the component slot, or __SYS_INDEX_INVALID if not registered.
+             */
+            uint32_t Find(HANDLE comp);
+
+            /**
+             * @brief Returns the component registered in a slot (NULL if none).
+             */
+            HANDLE Object(uint32_t slot){ return(objects[slot]);}
+
+            /**
+             * @brief Returns the identifier (generation << 16 | slot) of a registered component.
+             * @return
+             * - identifier, or @ref __SYS_COMPONENT_NONE if not registered.
+             */
+            uint32_t Identify(HANDLE comp);
+
+            /**
+             * @brief Returns the identifier of the component registered in a slot.
+             */
+            uint32_t Slot(uint32_t slot){ return(((uint32_t)generations[slot] << 16) | slot);}
+
+            /**
+             * @brief Checks an identifier and returns its slot.
+             * @return
+             * - the component slot, or __SYS_INDEX_INVALID if the identifier is stale.
+             */
+            uint32_t Resolve(uint32_t id);
+
+            /**
+             * @brief Returns the slot of the oldest registered component
+             * (@ref __SYS_SLOT_NONE if none).
+             */
+            uint32_t Oldest(){ return(oldest);}
+
+            /**
+             * @brief Returns the slot included after "slot" (@ref __SYS_SLOT_NONE if none).
+             * For a slot excluded meanwhile, the one that followed it when it was excluded.
+             */
+            uint32_t Newer(uint32_t slot){ return(newer[slot]);}
+
+            /**
+             * @brief Checks if the registered slots are numbered in inclusion order (no
+             * slot was reused below a newer component since the registry was last empty).
+             */
+            bool InOrder(){ return(ordered);}
+
+            /**
+             * @brief Returns the inclusion number of a slot (increasing with the
+             * inclusion order, never 0 for a registered component).
+             */
+            uint32_t Rank(uint32_t slot){ return(ranks[slot]);}
+
+            /**
+             * @brief Returns the number of registered components.
+             */
+            uint32_t Counter(){ return(objects_number);}
+
+            /**
+             * @brief Checks if a slot holds a registered component.
+             */
+            bool IsLive(uint32_t slot){ return((live[slot >> 5] & (1UL << (slot & 31))) != 0L);}
+    };
+
+#endif
+
+//==============================================================================
@@ -0,0 +1,213 @@
+//==============================================================================
+/**
+ * @file NTask.h
+ * @brief EDROS coroutine tasks\n
+ * Stackless C++20 coroutines driven by the message pipe.\n
+ * - A task is a member function returning @ref NTask: it runs up to its first
+ * "co_await", then it is resumed by the dispatcher (thread mode) when the awaited
+ * message arrives or its timeout expires. The frame is released when it returns.
+ * - Frames come from a static pool (@ref __SYS_MAX_TASKS frames of
+ * @ref __SYS_TASK_FRAME_SIZE bytes): no heap. A task that does not fit is not
+ * started (@ref NTask::IsStarted).
+ * - Awaitables:
+ *   - NTask::Message(message, data1, timeout): message dispatched by the pipe (broadcast
+ *     or unicast), optionally filtered by "data1" (e.g. NM_DMA_OK on a given NV_ID);
+ *     resumes with the message, or with message = NM_NULL on timeout.
+ *   - NTask::Sleep(ms): resumes after "ms" milliseconds.
+ * - Peripheral completions reach the tasks only through the pipe: when the callback
+ * owner of the peripheral has nLow priority, or when its InterruptCallBack posts them
+ * (nTimeCritical and nNormal owners get them directly, never through the pipe).
+ * - Enabled with -D__SYS_COROUTINES (requires -std=c++20).
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NTASK_H
+    #define NTASK_H
+
+    #include "NComponent.h"
+    #include "NAtomic.h"
+
+//------------------------------------------------------------------------------
+#ifdef __SYS_COROUTINES
+#ifndef __cpp_impl_coroutine
+    #error "NTask.h: __SYS_COROUTINES requires C++20 coroutines (-std=c++20)"
+#endif
+    #include <coroutine>
+
+//------------------------------------------------------------------------------
+#ifndef __SYS_MAX_TASKS
+	#define __SYS_MAX_TASKS 			((uint32_t) 8)
+#endif
+#ifndef __SYS_TASK_FRAME_SIZE
+	#define __SYS_TASK_FRAME_SIZE 		((uint32_t) 256)
+#endif
+#define __SYS_TASK_ANY 				((uint32_t) 0xFFFFFFFF)
+
+    //------------------------------------------------
+	/**
+	 * @struct NTASKWAIT
+	 * Waiting record of a suspended task (lives in the task frame).
+ 	 */
+    struct NTASKWAIT{
+        NTASKWAIT* next;
+        void* frame;                //!< coroutine handle address
+        uint32_t message;           //!< awaited message (NM_NULL: timeout only)
+        uint32_t data1;             //!< awaited data1, or __SYS_TASK_ANY
+        uint32_t timer;             //!< timeout timer, or __SYS_TIMER_NONE
+        volatile bool expired;      //!< set by the timeout timer
+        NMESSAGE result;
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS task scheduler: frame pool and waiting list.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NTaskScheduler{
+        private:
+            alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) uint32_t frames[__SYS_MAX_TASKS][__SYS_TASK_FRAME_SIZE / 4];
+            NAtomic free_frames;
+            NAtomic expired;
+            NTASKWAIT* waiting;
+
+            static void Timeout(uint32_t timer, void* context);
+
+            NTaskScheduler(const NTaskScheduler&);
+            NTaskScheduler& operator=(const NTaskScheduler&);
+
+    public:
+            NTaskScheduler();
+
+            /**
+             * @brief Takes a frame from the pool (NULL if exhausted or "size" too large).
+             */
+            void* AllocateFrame(size_t size);
+
+            /**
+             * @brief Returns a frame to the pool.
+             */
+            void ReleaseFrame(void* frame);
+
+            /**
+             * @brief Suspends a task on a waiting record (thread mode).
+             * @arg timeout
+             * - milliseconds (0: no timeout).
+             */
+            void Wait(NTASKWAIT* wait, uint32_t timeout);
+
+            /**
+             * @brief Resumes the tasks waiting for "Msg" (called by the dispatcher).
+             * @return
+             * - number of tasks resumed.
+             */
+            uint32_t Match(const NMESSAGE* Msg);
+
+            /**
+             * @brief Resumes the tasks whose timeout expired (called by the dispatcher).
+             * @return
+             * - number of tasks resumed.
+             */
+            uint32_t Poll();
+
+            /**
+             * @brief Checks if a timeout expired since the last @ref Poll.
+             */
+            bool IsPending(){ return(expired.Load() != 0L);}
+
+            /**
+             * @brief Number of frames in use.
+             */
+            uint32_t Counter();
+    };
+
+    //------------------------------------------------
+	/** @brief Return type of the EDROS coroutine tasks.
+	 * The task starts immediately and releases its frame by itself when it returns
+	 * (fire and forget): the NTask object only tells whether it could be started.
+	 * Example (NSerial owns its DMA channel with Priority = nLow, so NM_DMA_OK is
+	 * queued to the pipe):
+	 * @code
+	 * NTask NSerial::Transfer(){
+	 *     for(;;){
+	 *         NMESSAGE m = co_await NTask::Message(NM_DMA_OK, NV_DMA1_CH1, 100);
+	 *         if(m.message == NM_NULL){ Recover(); continue;}
+	 *         co_await NTask::Sleep(5);
+	 *     }
+	 * }
+	 * @endcode
+	 * @warning A task must finish (or keep waiting forever) before its component is destroyed.
+ 	 */
+    class NTask{
+        public:
+            //-------------------------------------------
+            struct promise_type{
+                static void* operator new(size_t size) noexcept;
+                static void operator delete(void* frame) noexcept;
+                static NTask get_return_object_on_allocation_failure(){ return(NTask(false));}
+
+                NTask get_return_object(){ return(NTask(true));}
+                std::suspend_never initial_suspend() noexcept { return{};}
+                std::suspend_never final_suspend() noexcept { return{};}
+                void return_void(){}
+                void unhandled_exception(){}
+            };
+
+            //-------------------------------------------
+            /**
+             * @brief Awaitable of a message and/or a timeout.
+             */
+            class Awaiter{
+                private:
+                    NTASKWAIT wait;
+                    uint32_t timeout;
+
+                public:
+                    Awaiter(uint32_t message, uint32_t data1, uint32_t ms);
+                    bool await_ready(){ return(false);}
+                    void await_suspend(std::coroutine_handle<> handle);
+                    NMESSAGE await_resume(){ return(wait.result);}
+            };
+
+            /**
+             * @brief Waits for a message dispatched by the pipe.
+             * @arg message
+             * - message identifier (NM_DMA_OK, NM_UARTRX, etc.).
+             * @arg data1
+             * - required "data1" (e.g. the NV_ID of a peripheral), or __SYS_TASK_ANY.
+             * @arg timeout
+             * - milliseconds (0: no timeout).
+             * @return
+             * - awaitable resuming with the message, or with message = NM_NULL on timeout.
+             */
+            static Awaiter Message(uint32_t message, uint32_t data1 = __SYS_TASK_ANY, uint32_t timeout = 0){
+                return(Awaiter(message, data1, timeout));
+            }
+
+            /**
+             * @brief Waits for the specified number of milliseconds.
+             */
+            static Awaiter Sleep(uint32_t ms){ return(Awaiter(NM_NULL, __SYS_TASK_ANY, (ms > 0L)? ms : 1L));}
+
+            /**
+             * @brief Checks if the task got a frame and started.
+             */
+            bool IsStarted(){ return(started);}
+
+        private:
+            bool started;
+            explicit NTask(bool s) : started(s){}
+    };
+
+#endif
+#endif
+//==============================================================================
@@ -0,0 +1,247 @@
+//==============================================================================
+/**
+ * @file NThread.h
+ * @brief EDROS preemptive threads\n
+ * Optional fixed-priority preemptive layer (enabled with -D__SYS_THREADS).\n
+ * - The system thread (System::Execute: message dispatch, callbacks, power down)
+ * is the lowest priority thread (0) and runs on the main stack. The other threads
+ * have their own stack and a unique priority from 1 (lowest) to 31 (highest).
+ * - The highest priority ready thread always runs: a thread woken by an interrupt,
+ * a timer or a mailbox preempts the running one at once. The context switch is
+ * done by PendSV, after the callback notifications are attended.
+ * - Interrupt priorities: PendSV moves to the lowest priority and SysTick one level
+ * above it (the reverse of the default order). The switch can only be done when
+ * PendSV returns to thread mode. Above SysTick, the PendSV pended by a thread woken
+ * from a timer would run nested in the tick and skip the switch. As a consequence, in
+ * threaded builds the tick (timers, periodic messages) may preempt the attendance of
+ * the nNormal callbacks, instead of waiting for it.
+ * - Threads block on a mailbox (@ref NMailbox::Wait) or sleep (@ref NThread::Sleep).
+ * The system thread never blocks: there, waits fall back to System::WaitFor.
+ * - The message pipe is dispatched by the system thread only: other threads post
+ * messages (System::PostMessage, NMailbox::Post) but do not call Dispatch.
+ * - Stacks are filled with a pattern at start: @ref NThread::GetStats reports the
+ * highest stack usage (watermark).
+ * - On the Linux host port (EDROS_HOST), threads are switched with ucontext: the
+ * emulated interrupts run on the stack of the running thread, so host stacks need
+ * several kilobytes (16 KB or more with the sanitizers).
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NTHREAD_H
+    #define NTHREAD_H
+
+    #include "NComponent.h"
+    #include "NMessageRing.h"
+    #include "NPort.h"
+
+#ifdef __SYS_THREADS
+#if !defined(__GNUC__)
+    #error "EDROS threads: the context switch is written for GCC"
+#endif
+
+//------------------------------------------------------------------------------
+#define __SYS_THREAD_PRIORITIES 	((uint32_t) 32)
+#define __SYS_THREAD_SYSTEM 		((uint32_t) 0)
+#define __SYS_STACK_FILL 			((uint32_t) 0xCDCDCDCD)
+#define __SYS_STACK_MINIMUM 		((uint32_t) 64)
+
+    //------------------------------------------------
+	/**
+	 * @struct NTHREADSTATS
+	 * Thread counters, readable at runtime.
+ 	 */
+    struct NTHREADSTATS{
+        uint32_t priority;      //!< thread priority
+        uint32_t stack_size;    //!< stack size in bytes (0: main stack)
+        uint32_t stack_used;    //!< highest stack usage in bytes (watermark)
+        uint32_t switches;      //!< number of times the thread was switched in
+    };
+
+    //------------------------------------------------
+	/** @brief Thread entry function.
+	 * @arg argument: value given to @ref NThread::Start.
+	 * The thread ends when the function returns.
+ 	 */
+    typedef void (*NTHREADENTRY)(void* argument);
+
+    //------------------------------------------------
+	/** @brief EDROS thread (control block and stack).
+ 	 */
+    class NThread{
+        protected:
+            /**
+             * @brief Constructor used by @ref NStaticThread.
+             * @arg stack
+             * - stack area (8-byte aligned), or NULL for the system thread.
+             * @arg words
+             * - stack size in 32-bit words.
+             */
+            NThread(uint32_t* stack, uint32_t words);
+
+        private:
+            //-------------------------------------------
+            // the first field is used by the PendSV context switch
+            NPORTCONTEXT context;       //!< saved context (see NPort.h)
+
+            uint32_t* stack;
+            uint32_t stack_words;
+            uint32_t priority;
+            uint32_t state;
+            uint32_t timer;
+            uint32_t switches;
+            bool timed_out;
+
+            static void Exit();
+            static void Expire(uint32_t timer, void* context);
+            static void Ready(NThread* thread);
+            static void Block(uint32_t ms);
+            static void Reschedule();
+
+            friend class NMailbox;
+
+            NThread(const NThread&);
+            NThread& operator=(const NThread&);
+
+    public:
+            //-------------------------------------------
+            /**
+             * @brief Starts the thread.
+             * @arg entry
+             * - thread function.
+             * @arg argument
+             * - value passed to "entry".
+             * @arg priority
+             * - 1 (lowest) to 31 (highest), not used by another thread.
+             * @return
+             * - false if the priority is invalid or taken, or the thread is already running.
+             */
+            bool Start(NTHREADENTRY entry, void* argument, uint32_t priority);
+
+            /**
+             * @brief Checks if the thread was started and has not returned yet.
+             */
+            bool IsRunning();
+
+            /**
+             * @brief This method reads the thread counters.
+             */
+            void GetStats(NTHREADSTATS* Stats);
+
+            //-------------------------------------------
+            /**
+             * @brief Suspends the calling thread for the specified number of milliseconds.
+             * In the system thread, behaves as System::Delay (cooperative).
+             */
+            static void Sleep(uint32_t ms);
+
+            /**
+             * @brief Returns the running thread.
+             */
+            static NThread* Current();
+
+            /**
+             * @brief Checks if the caller runs in the system thread (or before the threads start).
+             */
+            static bool IsSystemThread();
+
+            /**
+             * @brief Sets up the system thread (called by System::Initialize).
+             */
+            static void Initialize();
+
+#ifdef EDROS_HOST
+            /**
+             * @brief Switches to the selected thread (PendSV handler of the host port).
+             */
+            static void Switch();
+#endif
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS thread with statically allocated stack.
+	 * @arg StackSize: stack size in bytes (multiple of 8).
+ 	 */
+    template<uint32_t StackSize>
+    class NStaticThread : public NThread{
+        static_assert((StackSize % 8) == 0, "NStaticThread: stack size must be a multiple of 8");
+        static_assert(StackSize >= (__SYS_STACK_MINIMUM * 4), "NStaticThread: stack too small");
+
+        private:
+            alignas(8) uint32_t stack_area[StackSize / 4];
+
+    public:
+            NStaticThread() : NThread(stack_area, StackSize / 4){}
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS mailbox: message queue a thread blocks on.
+	 * Any context posts (ISR, components, threads); a single thread waits.
+ 	 */
+    class NMailbox{
+        protected:
+            /**
+             * @brief Constructor used by @ref NStaticMailbox.
+             */
+            NMailbox(NMessageRing* Ring);
+
+        private:
+            NMessageRing* ring;
+            NThread* volatile waiter;
+
+            static bool IsFilled(void* context);
+
+            NMailbox(const NMailbox&);
+            NMailbox& operator=(const NMailbox&);
+
+    public:
+            /**
+             * @brief Posts a message (any context).
+             * @return
+             * - false if the mailbox is full.
+             */
+            bool Post(const NMESSAGE* Msg);
+
+            /**
+             * @brief Waits for a message.
+             * @arg Msg
+             * - message received.
+             * @arg timeout
+             * - milliseconds (0: no timeout).
+             * @return
+             * - false on timeout.
+             */
+            bool Wait(NMESSAGE* Msg, uint32_t timeout = 0);
+
+            /**
+             * @brief Number of messages waiting.
+             */
+            uint32_t Counter(){ return(ring->Counter());}
+    };
+
+    //------------------------------------------------
+	/** @brief EDROS mailbox with statically allocated storage.
+	 * @arg Size: number of messages (power of two).
+ 	 */
+    template<uint32_t Size>
+    class NStaticMailbox : public NMailbox{
+        private:
+            NStaticMessageRing<Size> storage;
+
+    public:
+            NStaticMailbox() : NMailbox(&storage){}
+    };
+
+#endif
+#endif
+//==============================================================================
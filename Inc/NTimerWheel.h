@@ -0,0 +1,198 @@
+//==============================================================================
+/**
+ * @file NTimerWheel.h
+ * @brief EDROS timing wheel\n
+ * Hierarchical timing wheel holding the kernel timers.\n
+ * - 5 levels of 64 slots: level 0 resolves 1 tick (1 ms) over 64 ticks, each level
+ * above is 64 times coarser, for a range of 2^30 ticks (about 12 days).
+ * - A timer is linked in the slot of its expiration time: start, cancel and expire
+ * run in constant time, whatever the number of armed timers. Timers of the upper
+ * levels move down one level when the level below wraps around (cascade).
+ * - Empty stretches of level 0 are skipped at once, so advancing the wheel by many
+ * ticks after a tickless idle period costs little more than a single tick.
+ * - On expiration a timer sets a flag, calls a function or posts a message
+ * (broadcast or unicast); periodic timers are re-armed automatically.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NTIMERWHEEL_H
+    #define NTIMERWHEEL_H
+
+    #include "NComponent.h"
+
+//------------------------------------------------------------------------------
+#ifndef __SYS_MAX_TIMERS
+	#define __SYS_MAX_TIMERS 		__SYS_MAX_SIGNALS
+#endif
+#define __SYS_WHEEL_LEVELS 			((uint32_t) 5)
+#define __SYS_WHEEL_BITS 			((uint32_t) 6)
+#define __SYS_WHEEL_SLOTS 			((uint32_t)(1UL << __SYS_WHEEL_BITS))
+#define __SYS_WHEEL_RANGE 			((uint32_t)(1UL << (__SYS_WHEEL_LEVELS * __SYS_WHEEL_BITS)))
+#define __SYS_TIMER_NONE 			((uint32_t) 0)
+
+    class NMessagePipe;
+
+    //------------------------------------------------
+	/** @brief Timer expiration function.
+	 * Called from the SysTick interrupt: it must be short and must not block.
+	 * @arg timer: identifier of the expired timer.
+	 * @arg context: value given when the timer was started.
+ 	 */
+    typedef void (*NTIMERCALLBACK)(uint32_t timer, void* context);
+
+    //------------------------------------------------
+	/** @brief EDROS hierarchical timing wheel.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NTimerWheel{
+        private:
+            //-------------------------------------------
+            /**
+             * @brief Expiration action of a timer.
+             */
+            enum KIND{ kFree, kFlag, kCallback, kMessage};
+
+            /**
+             * @struct TIMER
+             * Timer entry, linked in a wheel slot by index.
+             */
+            struct TIMER{
+                uint32_t expires;           //!< absolute expiration tick
+                uint32_t period;            //!< re-arm interval (0: one-shot)
+                uint32_t generation;        //!< identifier generation
+                NTIMERCALLBACK callback;    //!< kCallback: function
+                void* target;               //!< flag, callback context or destination component
+                uint32_t message;           //!< kMessage: message identifier
+                uint8_t kind;
+                uint8_t level;
+                uint8_t slot;
+                uint8_t next;
+                uint8_t prev;
+            };
+
+            TIMER timers[__SYS_MAX_TIMERS];
+            uint8_t heads[__SYS_WHEEL_LEVELS][__SYS_WHEEL_SLOTS];
+            uint32_t occupied[__SYS_WHEEL_SLOTS / 32];  //!< non-empty slots of level 0
+            uint8_t free_head;
+            uint8_t firing;                 //!< expired timers detached from their slot
+            uint32_t armed;
+            uint32_t current;               //!< next tick to be processed
+            NMessagePipe* pipe;
+
+            uint32_t Allocate();
+            void Free(uint32_t index);
+            uint32_t Start(uint32_t index, uint32_t delay);
+            void Link(uint32_t index);
+            void Unlink(uint32_t index);
+            void Cascade(uint32_t level);
+            uint32_t Gap(uint32_t slot);
+            uint32_t Resolve(uint32_t id);
+
+            NTimerWheel(const NTimerWheel&);
+            NTimerWheel& operator=(const NTimerWheel&);
+
+    public:
+            //-------------------------------------------
+            /**
+             * @brief Standard constructor for this class.
+             */
+            NTimerWheel();
+
+            /**
+             * @brief Selects the message pipe used by the message timers.
+             */
+            void SetPipe(NMessagePipe* Pipe){ pipe = Pipe;}
+
+            /**
+             * @brief Starts a one-shot timer that sets a boolean flag.
+             * @arg flag
+             * - pointer to the flag, set to true on expiration.
+             * @arg delay
+             * - number of ticks (1 to @ref __SYS_WHEEL_RANGE - 1).
+             * @return
+             * - timer identifier, or @ref __SYS_TIMER_NONE if no timer is available.
+             */
+            uint32_t StartFlag(bool* flag, uint32_t delay);
+
+            /**
+             * @brief Starts a timer that calls a function (from the SysTick interrupt).
+             * @arg callback
+             * - function to be called on expiration.
+             * @arg context
+             * - value passed to the function.
+             * @arg delay
+             * - number of ticks to the first expiration.
+             * @arg period
+             * - number of ticks between later expirations (0: one-shot).
+             * @return
+             * - timer identifier, or @ref __SYS_TIMER_NONE if no timer is available.
+             */
+            uint32_t StartCallback(NTIMERCALLBACK callback, void* context, uint32_t delay, uint32_t period);
+
+            /**
+             * @brief Starts a timer that posts a message.
+             * The message carries: data1 = timer identifier, data2 = expiration tick, tag = 0.
+             * @arg message
+             * - message identifier.
+             * @arg destination
+             * - destination component, or NULL to broadcast the message.
+             * @arg delay
+             * - number of ticks to the first expiration.
+             * @arg period
+             * - number of ticks between later expirations (0: one-shot).
+             * @return
+             * - timer identifier, or @ref __SYS_TIMER_NONE if no timer is available.
+             */
+            uint32_t StartMessage(uint32_t message, HANDLE destination, uint32_t delay, uint32_t period);
+
+            /**
+             * @brief Cancels a timer (any context).
+             * @return
+             * - false if the timer had already expired or was cancelled.
+             */
+            bool Cancel(uint32_t id);
+
+            /**
+             * @brief Checks if a timer is still armed.
+             */
+            bool IsActive(uint32_t id){ return(Resolve(id) < __SYS_MAX_TIMERS);}
+
+            /**
+             * @brief Processes the elapsed ticks: expires the due timers (SysTick interrupt).
+             * @arg ticks
+             * - number of ticks elapsed since the last call.
+             * @return
+             * - number of timers expired.
+             */
+            uint32_t Advance(uint32_t ticks);
+
+            /**
+             * @brief Returns the number of ticks up to the next timer expiration (tickless idle).
+             * Visits the armed timers: meant to be called once before the idle period, not on every tick.
+             * @arg limit
+             * - value returned when no timer expires sooner.
+             * @return
+             * - 1 if a timer expires on the next tick, up to "limit".
+             */
+            uint32_t NextExpiration(uint32_t limit);
+
+            /**
+             * @brief Returns the number of armed timers.
+             */
+            uint32_t Counter(){ return(armed);}
+    };
+
+#endif
+//==============================================================================
@@ -0,0 +1,163 @@
+//==============================================================================
+/**
+ * @file NTrace.h
+ * @brief EDROS kernel event trace\n
+ * Binary trace of the kernel activity in a RAM ring (enabled with -D__SYS_TRACE).\n
+ * - Each event is a 12-byte record: cycle counter (nanoseconds on a host build),
+ * event code and three arguments. Recording costs an atomic increment and four
+ * stores; any context records (ISR, PendSV, dispatcher, threads).
+ * - Events recorded by the kernel:
+ *   - __SYS_TRACE_IRQ_ENTER / EXIT: body of every EDROS_*_IRQHandler (@ref NIRQ_ENTRY);
+ *   - __SYS_TRACE_ROUTE: routing decision of System::Dispatch;
+ *   - __SYS_TRACE_INSERT: message queued in the message pipe;
+ *   - __SYS_TRACE_DISPATCH / DISPATCHED: message delivered by the dispatcher;
+ *   - __SYS_TRACE_PENDSV_ENTER / EXIT: drain of the callback notifications;
+ *   - __SYS_TRACE_SLEEP_ENTER / EXIT: power down (WFI; tickless, Stop or Standby);
+ *   - __SYS_TRACE_MARK: application event (System::TraceMark).
+ * - The ring keeps the latest __SYS_TRACE_EVENTS events. Its header (@ref NTRACEHEADER)
+ * describes the layout, so the buffer can be dumped as is (debugger, serial port)
+ * and decoded on the host: tools/edros_trace.py converts it to the Chrome trace
+ * format (chrome://tracing, ui.perfetto.dev).
+ * - Compiled out, the instrumentation macros expand to nothing.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ * @warning This class must be used exclusively by the system kernel.
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NTRACE_H
+    #define NTRACE_H
+
+    #include "NProfiler.h"
+    #include "NAtomic.h"
+
+//------------------------------------------------------------------------------
+#define __SYS_TRACE_MAGIC 			((uint32_t) 0x52544445)		// "EDTR"
+#define __SYS_TRACE_VERSION 		((uint32_t) 1)
+// number of events kept (power of two)
+#ifndef __SYS_TRACE_EVENTS
+	#define __SYS_TRACE_EVENTS 			((uint32_t) 256)
+#endif
+
+//------------------------------------------------------------------------------
+// event codes (info, arg, data)
+#define __SYS_TRACE_IRQ_ENTER 		((uint32_t) 1)		// -, exception number, -
+#define __SYS_TRACE_IRQ_EXIT 		((uint32_t) 2)		// -, exception number, -
+#define __SYS_TRACE_ROUTE 			((uint32_t) 3)		// path (__SYS_PATH_*), NV_ID, message
+#define __SYS_TRACE_INSERT 			((uint32_t) 4)		// level, __SYS_TRACE_ACCEPTED | __SYS_TRACE_UNICAST, message
+#define __SYS_TRACE_DISPATCH 		((uint32_t) 5)		// level, unicast (1) or broadcast (0), message
+#define __SYS_TRACE_DISPATCHED 		((uint32_t) 6)		// level, -, message
+#define __SYS_TRACE_PENDSV_ENTER 	((uint32_t) 7)		// -, -, -
+#define __SYS_TRACE_PENDSV_EXIT 	((uint32_t) 8)		// -, callbacks attended, -
+#define __SYS_TRACE_SLEEP_ENTER 	((uint32_t) 9)		// tickless (1), Stop (2) or Standby (3), ticks suppressed, -
+#define __SYS_TRACE_SLEEP_EXIT 		((uint32_t) 10)		// tickless (1), Stop (2) or Standby (3), ticks elapsed, -
+#define __SYS_TRACE_MARK 			((uint32_t) 11)		// -, application id, application value
+
+#define __SYS_TRACE_ACCEPTED 		((uint32_t) 0x0001)
+#define __SYS_TRACE_UNICAST 		((uint32_t) 0x0002)
+
+    //------------------------------------------------
+	/**
+	 * @struct NTRACEEVENT
+	 * Trace record (12 bytes, little-endian in the dump).
+ 	 */
+    struct NTRACEEVENT{
+        uint32_t time;          //!< cycle counter
+        uint8_t event;          //!< __SYS_TRACE_* code (0: never written)
+        uint8_t info;           //!< first argument
+        uint16_t arg;           //!< second argument
+        uint32_t data;          //!< third argument (usually the message identifier)
+    };
+
+    //------------------------------------------------
+	/**
+	 * @struct NTRACEHEADER
+	 * Layout of the trace buffer, at its start.
+ 	 */
+    struct NTRACEHEADER{
+        uint32_t magic;         //!< __SYS_TRACE_MAGIC
+        uint16_t version;       //!< __SYS_TRACE_VERSION
+        uint16_t size;          //!< sizeof(NTRACEEVENT)
+        uint32_t capacity;      //!< number of events in the ring
+        uint32_t clock;         //!< counter frequency in Hz
+        NAtomic head;           //!< events recorded since the last reset (next one: head % capacity)
+        volatile uint32_t enabled;
+    };
+
+    //------------------------------------------------
+	/**
+	 * @struct NTRACEBUFFER
+	 * Trace buffer: header followed by the event ring.
+ 	 */
+    struct NTRACEBUFFER{
+        NTRACEHEADER header;
+        NTRACEEVENT events[__SYS_TRACE_EVENTS];
+    };
+
+#ifdef __SYS_TRACE
+
+    //------------------------------------------------
+	/** @brief EDROS kernel event trace.
+	 * @warning This class must be used exclusively by the system kernel.
+ 	 */
+    class NTrace{
+        private:
+            static NTRACEBUFFER buffer;
+
+            NTrace();
+
+    public:
+            /**
+             * @brief Fills in the header and starts recording (called by System::Initialize).
+             * @arg clock
+             * - frequency of the cycle counter in Hz.
+             */
+            static void Initialize(uint32_t clock);
+
+            /**
+             * @brief Starts or stops recording (stop it before dumping a running system).
+             */
+            static void Enable(bool enable){ buffer.header.enabled = enable? 1L : 0L;}
+
+            /**
+             * @brief Clears the ring.
+             */
+            static void Reset();
+
+            /**
+             * @brief Returns the trace buffer, to be dumped.
+             */
+            static const NTRACEBUFFER* Buffer(){ return(&buffer);}
+
+            /**
+             * @brief Records an event (any context).
+             */
+            static void Record(uint32_t event, uint32_t info, uint32_t arg, uint32_t data){
+                if(buffer.header.enabled == 0L){ return;}
+                uint32_t time = NCycles();
+                NTRACEEVENT* e = &buffer.events[buffer.header.head.FetchAdd(1) & (__SYS_TRACE_EVENTS - 1)];
+                e->time = time;
+                e->info = (uint8_t)info;
+                e->arg = (uint16_t)arg;
+                e->data = data;
+                e->event = (uint8_t)event;
+            }
+    };
+
+    //------------------------------------------------
+    #define NTRACE(event, info, arg, data)      NTrace::Record((event), (info), (arg), (data))
+#else
+    #define NTRACE(event, info, arg, data)
+#endif
+
+#endif
+//==============================================================================
@@ -20,56 +20,111 @@
 #ifndef SYSTEM_H
     #define SYSTEM_H
 
+    #include "NPort.h"
     #include "NMessagePipe.h"
+    #include "NTimerWheel.h"
+    #include "NThread.h"
+    #include "NPower.h"
 
 //------------------------------------------------------------------------------
-#define __SYS_STANDARD_MESSAGES 	((uint32_t) 4)
-#define __SYS_PRIORITY_MESSAGES 	((uint32_t) 4)
-#define __SYS_STANDARD_CALLBACKS 	((uint32_t) 4)
-#define __SYS_TICK_RATE 			((uint32_t) 1)
-#define __SYS_SCAN_RATE 			((uint32_t) 10)
-#define __SYS_UPDATE_RATE 			((uint32_t) 20)
+// queue capacities (powers of two): may be overridden per product (-D option)
+#ifndef __SYS_STANDARD_MESSAGES
+	#define __SYS_STANDARD_MESSAGES 	((uint32_t) 4)
+#endif
+#ifndef __SYS_PRIORITY_MESSAGES
+	#define __SYS_PRIORITY_MESSAGES 	((uint32_t) 4)
+#endif
+#ifndef __SYS_STANDARD_CALLBACKS
+	#define __SYS_STANDARD_CALLBACKS 	((uint32_t) 4)
+#endif
+#ifndef __SYS_RESERVE_MESSAGES
+	#define __SYS_RESERVE_MESSAGES 		((uint32_t) 8)
+#endif
+#define __SYS_QUEUE_CALLBACKS 		((uint32_t) 0x80)
+
+//------------------------------------------------------------------------------
+// data blocks carried by messages (see @ref AllocateBuffer)
+#ifndef __SYS_BUFFER_SIZE
+	#define __SYS_BUFFER_SIZE 			((uint32_t) 64)
+#endif
+#ifndef __SYS_BUFFER_BLOCKS
+	#define __SYS_BUFFER_BLOCKS 		((uint32_t) 8)
+#endif
+
+//------------------------------------------------------------------------------
+// dispatch budget per round of the "system thread" (0: no limit)
+#ifndef __SYS_DISPATCH_BUDGET
+	#define __SYS_DISPATCH_BUDGET 		((uint32_t) 32)
+#endif
+#ifndef __SYS_DISPATCH_TIME
+	#define __SYS_DISPATCH_TIME 		((uint32_t) 0)
+#endif
+
+//------------------------------------------------------------------------------
+// periodic messages (in ticks, 0: disabled): defaults of @ref SetPeriodicRates
+#ifndef __SYS_TICK_RATE
+	#define __SYS_TICK_RATE 			((uint32_t) 1)
+#endif
+#ifndef __SYS_SCAN_RATE
+	#define __SYS_SCAN_RATE 			((uint32_t) 10)
+#endif
+#ifndef __SYS_UPDATE_RATE
+	#define __SYS_UPDATE_RATE 			((uint32_t) 20)
+#endif
+// longest period of a periodic message (longer periods are clamped to it)
+#define __SYS_RATE_MAX 				((uint32_t) 0xFFFF)
 #define __SYS_PRIORITY_BORDERLINE 	((uint32_t) 0xFFFF0000)
 #define __SYS_INDEX_INVALID 		((uint32_t) 0xFFFFFFFF)
 
+//------------------------------------------------------------------------------
+// kernel services (SVC numbers) added on top of the standard service set
+#define SVC_SUBSCRIBE_MESSAGE 		((uint32_t) 32)
+#define SVC_UNSUBSCRIBE_MESSAGE 	((uint32_t) 33)
+#define SVC_POST_MESSAGE 			((uint32_t) 34)
+#define SVC_SEND_MESSAGE 			((uint32_t) 35)
+
 //------------------------------------------------------------------------------
 /** @brief EDROS System class.
  * @warning This class must be used exclusively by the system kernel.
  */
 class System{
-	public:
-		//----------------------------------------------------------------------
-		/**
-		 * @struct SIGNAL
-		 * Signal parameters definition.
-		 */
-		struct SIGNAL{
-			public:
-				void* flag;		//!< pointer to a boolean flag to receive the state changes
-				int counter;	//!< internal counter
-				SIGNAL(){ flag = NULL;  counter = -1;}
-		};
-
     private:
 	  	bool halt;
 		bool sleep;
-        uint32_t time;
+        volatile uint32_t time;
+        volatile uint32_t time_high;
 
-        uint16_t fclk;
+        uint32_t tick_cycles;
+        uint32_t ns_scale;
+        uint64_t read_ticks;                // last clock reading: never read backwards
+        uint32_t read_fraction;
         uint16_t ticks_timers;
         uint16_t ticks_inputs;
         uint16_t ticks_outputs;
+        uint16_t rate_timers;
+        uint16_t rate_inputs;
+        uint16_t rate_outputs;
         uint32_t ksc0, ksc1, ksc2;
 
-        uint32_t UpdateTimeouts();
+        uint32_t dispatch_budget;
+        uint32_t dispatch_time;
+
+        bool tickless;
+
 		void UpdatePowerdown();
+        void UpdatePeriodic(uint32_t message, uint32_t rate, uint16_t* counter, uint32_t elapsed);
+        void Step(uint32_t elapsed);
+        uint32_t NextDeadline(uint32_t limit);
+        void TicklessIdle();
+        void GovernedIdle();
+        uint64_t ReadClock(uint32_t* fraction);
+        void Route(NMESSAGE* Msg, uint32_t flags);
 
         HANDLE sysVectors[__SYS_MAX_VECTORS];
-        SIGNAL sysSignals[__SYS_MAX_SIGNALS];
 
     public:
     NMessagePipe* queue;
-	NFifo* CallbackQueue;
+	NMessageRing* CallbackQueue;
 
 	public:
 		/**
@@ -104,7 +159,7 @@ class System{
 
         /**
          * @brief This method is used to initialize all the system internal variables.
-         * It is also used to allocate some system buffers.
+         * It is also used to attach the (statically allocated) system queues.
          * For some unknown reason this could not be done from the constructor.
          * @warning
          * - This method MUST not be called by the application.
@@ -129,9 +184,44 @@ class System{
          * @note As the SysTick timer is not disabled, the execution of the
          * system messages dispatcher is not compromised, with the sleep mode being
          * activated between each dispatch round.
+         * - With -D__SYS_POWER the mode of each idle period (Sleep, Stop or Standby) is
+         * chosen by the power governor (@ref SetPowerPolicy).
          */
         void Sleep(bool Stat);
 
+        /**
+         * @brief This method selects the "tickless" power-saving mode.
+         * While sleeping, the SysTick timer is reprogrammed as a one-shot wake-up for the next
+         * deadline (kernel timers and periodic messages), instead of interrupting every millisecond.
+         * After the wake-up the system time, timers and periodic messages are advanced by the
+         * elapsed number of ticks.
+         * @arg Stat:
+         * - true: tickless mode (effective while @ref Sleep is ON).
+         * - false: periodic 1 ms tick (default).
+         *
+         * @note
+         * - Periodic messages bound the idle periods: reduce or disable them with @ref SetPeriodicRates.
+         * - An idle period is limited by the SysTick 24-bit counter (about 233 ms at 72 MHz).
+         * - Applies to the Sleep mode: SysTick stops in Stop mode, the power governor
+         * (-D__SYS_POWER) uses the board wake-up timer instead.
+         */
+        void SetTickless(bool Stat);
+
+        /**
+         * @brief This method check the status of the "tickless" mode flag.
+         */
+        bool IsTickless();
+
+        /**
+         * @brief This method sets the periods of the system periodic messages.
+         * @arg tick: period of NM_TIMETICK, in milliseconds (0: disabled). Default: @ref __SYS_TICK_RATE.
+         * @arg scan: period of NM_KEYSCAN, in milliseconds (0: disabled). Default: @ref __SYS_SCAN_RATE.
+         * @arg update: period of NM_REPAINT, in milliseconds (0: disabled). Default: @ref __SYS_UPDATE_RATE.
+         * @note Periods range from 1 to @ref __SYS_RATE_MAX (65535) ms: longer ones are clamped.
+         * May be called from any context.
+         */
+        void SetPeriodicRates(uint32_t tick, uint32_t scan, uint32_t update);
+
         /**
          * @brief This method check the status of the "power-saving" mode flag.
          * @return true if the "power-saving mode" (sleep) flag is ON.
@@ -146,6 +236,292 @@ class System{
          */
         void Heartbeat();
 
+        /**
+         * @brief This method returns how many periods of a periodic system message were merged
+         * into an instance still waiting in the queue (i.e. how often the dispatcher fell behind).
+         * @arg message:
+         * NM_TIMETICK, NM_KEYSCAN or NM_REPAINT.
+         * @return number of merged periods since the system startup.
+         */
+        uint32_t GetMergedCount(uint32_t message);
+
+        /**
+         * @brief This method selects what a system queue does when it is full.
+         * @arg queue:
+         * a message priority level (@ref __SYS_QUEUE_STANDARD to @ref __SYS_QUEUE_PRIORITY)
+         * @ref __SYS_QUEUE_CALLBACKS or @ref __SYS_QUEUE_DEFERRED.
+         * @arg policy:
+         * - nDropNewest: the message being inserted is discarded (default).
+         * - nDropOldest: the oldest queued message is discarded.
+         * - nSpillReserve: the message is kept in the system reserve pool
+         * (@ref __SYS_RESERVE_MESSAGES blocks shared by all queues).
+         * @return
+         * - true: policy selected.
+         * - false: invalid queue.
+         */
+        bool SetOverflowPolicy(uint32_t queue, NOVERFLOW policy);
+
+        /**
+         * @brief This method reads the counters of a system queue
+         * (inserts, drops, spills and occupancy high-watermark).
+         * @arg queue:
+         * a message priority level (@ref __SYS_QUEUE_STANDARD to @ref __SYS_QUEUE_PRIORITY)
+         * @ref __SYS_QUEUE_CALLBACKS or @ref __SYS_QUEUE_DEFERRED.
+         * @arg stats:
+         * pointer to the @ref NQUEUESTATS to be filled in.
+         * @return
+         * - false: invalid queue.
+         */
+        bool GetQueueStats(uint32_t queue, NQUEUESTATS* stats);
+
+        /**
+         * @brief This method allocates a data block (@ref __SYS_BUFFER_SIZE bytes) from the kernel
+         * buffer pool, with one reference owned by the caller. ISR-safe.
+         * @return
+         * - pointer to the block, or NULL if the pool is exhausted.
+         *
+         * <b> Zero-copy messages </b>
+         * - The sender fills the block and posts a message with "tag" = @ref GetBufferHandle,
+         * with @ref PostBuffer, @ref SendBuffer or @ref DispatchBuffer. The block reference
+         * passes to the message, even if the message is discarded. A "tag" posted with the
+         * other methods is never taken for a block.
+         * - Every notified component reads the same block (@ref GetBuffer) without copying it.
+         * - A component keeping the block after Notify() calls @ref RetainBuffer, and
+         * @ref ReleaseBuffer when done. The block returns to the pool with the last reference.
+         */
+        void* AllocateBuffer();
+
+        /**
+         * @brief This method converts a data block pointer into the handle to be sent in a message "tag".
+         * @return
+         * - block handle, or @ref __SYS_BUFFER_NONE if "data" is not an allocated block.
+         */
+        uint32_t GetBufferHandle(void* data);
+
+        /**
+         * @brief This method gets the data block carried by a message.
+         * @arg handle:
+         * the message "tag".
+         * @return
+         * - pointer to the block, or NULL if "handle" is not an allocated block.
+         */
+        void* GetBuffer(uint32_t handle);
+
+        /**
+         * @brief This method adds a reference to a data block. ISR-safe.
+         * @return
+         * - false: "handle" is not an allocated block.
+         */
+        bool RetainBuffer(uint32_t handle);
+
+        /**
+         * @brief This method removes a reference from a data block. ISR-safe.
+         * @return
+         * - false: "handle" is not an allocated block.
+         */
+        bool ReleaseBuffer(uint32_t handle);
+
+        /**
+         * @brief This method queues a message whose "tag" carries a data block reference
+         * (see @ref AllocateBuffer), which passes to the message pipe. ISR-safe.
+         * @arg Msg, priority:
+         * as in @ref PostMessage.
+         * @return
+         * - true: message queued.
+         * - false: message discarded (the reference was released).
+         */
+        bool PostBuffer(NMESSAGE* Msg, uint32_t priority);
+
+        /**
+         * @brief This method queues a message carrying a data block for a single component.
+         * @arg Msg, destination, priority:
+         * as in @ref SendMessage.
+         * @return
+         * - true: message queued.
+         * - false: destination not registered or message discarded (the reference was released).
+         */
+        bool SendBuffer(NMESSAGE* Msg, HANDLE destination, uint32_t priority);
+
+        /**
+         * @brief This method routes an interrupt message carrying a data block, as @ref Dispatch.
+         * The reference passes to the message: the kernel releases it after the
+         * InterruptCallBack of an nTimeCritical or nNormal owner returns, or after the
+         * last component has been notified (other priorities).
+         */
+        void DispatchBuffer(NMESSAGE* Msg);
+
+        /**
+         * @brief This method reads the kernel buffer pool counters.
+         * @arg stats:
+         * pointer to the @ref NBUFFERSTATS to be filled in.
+         */
+        void GetBufferStats(NBUFFERSTATS* stats);
+
+        /**
+         * @brief This method limits the work done by the dispatcher in each round of the "system thread",
+         * so the watchdog is kicked and the power-saving mode is entered at predictable intervals.
+         * Messages that do not fit in a round are kept queued for the next one.
+         * @arg messages:
+         * maximum number of messages per round (0: no limit). Default: @ref __SYS_DISPATCH_BUDGET.
+         * @arg microseconds:
+         * maximum duration of a round (0: no limit). Default: @ref __SYS_DISPATCH_TIME.
+         * @note
+         * - A single Notify() call is never interrupted: the time budget is checked between messages.
+         */
+        void SetDispatchBudget(uint32_t messages, uint32_t microseconds);
+
+        /**
+         * @brief This method reads the dispatcher counters: number of rounds, messages dispatched
+         * and rounds cut short by the budget with messages still waiting (starvation events).
+         * @arg stats:
+         * pointer to the @ref NDISPATCHSTATS to be filled in.
+         */
+        void GetDispatchStats(NDISPATCHSTATS* stats);
+
+        /**
+         * @brief This method reads the execution time of a component (requires __SYS_PROFILER):
+         * its notifications (Notify) and its interrupt callbacks (InterruptCallBack), in cycles.
+         * @arg comp:
+         * the component handle.
+         * @arg notify, callback:
+         * pointers to the @ref NPROFILESTATS to be filled in (NULL: not read).
+         * @return false if the component is not registered or the profiler is compiled out.
+         */
+        bool GetComponentProfile(HANDLE comp, NPROFILESTATS* notify, NPROFILESTATS* callback);
+
+        /**
+         * @brief This method reads a latency histogram: time from the entry of an interrupt handler
+         * to the handler of its message, in cycles (requires __SYS_LATENCY).
+         * @arg vector:
+         * the source @ref NV_ID, or __SYS_LATENCY_ALL for all the sources.
+         * @arg path:
+         * __SYS_PATH_CRITICAL (nTimeCritical), __SYS_PATH_CALLBACK (nNormal) or __SYS_PATH_QUEUED.
+         * @arg stats:
+         * pointer to the @ref NLATENCYSTATS to be filled in.
+         * @return false if the source was never measured on this path, or if the histograms are compiled out.
+         */
+        bool GetLatency(uint32_t vector, uint32_t path, NLATENCYSTATS* stats);
+
+        /**
+         * @brief This method reads the latency histograms per source, one at a time (requires __SYS_LATENCY).
+         * @arg index:
+         * 0 up to the first false return.
+         */
+        bool GetLatencySource(uint32_t index, NLATENCYSTATS* stats);
+
+        /**
+         * @brief This method clears the latency histograms.
+         */
+        void ResetLatency();
+
+        /**
+         * @brief This method reads the execution time per message identifier (requires __SYS_PROFILER).
+         * @arg index:
+         * 0 up to the first false return (stats->key: message identifier).
+         * @arg stats:
+         * pointer to the @ref NPROFILESTATS to be filled in.
+         * @return false past the last message, or if the profiler is compiled out.
+         */
+        bool GetMessageProfile(uint32_t index, NPROFILESTATS* stats);
+
+        /**
+         * @brief This method clears the profiler counters.
+         */
+        void ResetProfile();
+
+        /**
+         * @brief This method starts or stops the kernel event trace (requires __SYS_TRACE).
+         * Recording starts with the system; stop it before dumping the buffer of a running system.
+         */
+        void SetTrace(bool enable);
+
+        /**
+         * @brief This method records an application event in the kernel trace (requires __SYS_TRACE).
+         * @arg id:
+         * event identifier (16 bits), shown by the host tools.
+         * @arg value:
+         * event value.
+         */
+        void TraceMark(uint32_t id, uint32_t value);
+
+        /**
+         * @brief This method clears the kernel trace.
+         */
+        void ResetTrace();
+
+        /**
+         * @brief This method returns the kernel trace buffer, to be dumped as is and
+         * decoded on the host (tools/edros_trace.py).
+         * @arg size:
+         * receives the buffer size in bytes.
+         * @return the buffer (@ref NTRACEBUFFER), or NULL if the trace is compiled out.
+         */
+        const void* GetTrace(uint32_t* size);
+
+        /**
+         * @brief This method starts or stops the message recorder (requires __SYS_RECORD).
+         */
+        void SetRecorder(bool enable);
+
+        /**
+         * @brief This method drains the oldest recorded messages, to be stored or sent
+         * as a chunk of the stream: the header, then the records (see @ref NRecorder).
+         * @arg header:
+         * receives the chunk header (no records if the recorder is compiled out).
+         * @arg records, max:
+         * buffer for up to "max" records.
+         * @return the number of records copied.
+         */
+        uint32_t ReadRecords(NRECORDHEADER* header, NRECORD* records, uint32_t max);
+
+        /**
+         * @brief This method reads the CPU load of the last complete window
+         * (see @ref NLoad): busy, interrupt and dispatch time in 0.01 % units.
+         * @arg stats:
+         * receives the statistics.
+         * @return
+         * - true: statistics available.
+         * - false: no window complete yet, or compiled without -D__SYS_LOAD.
+         */
+        bool GetLoad(NLOADSTATS* stats);
+
+        /**
+         * @brief This method sets the length of the CPU load window (from the next window on).
+         * @arg ms:
+         * window length in milliseconds (default @ref __SYS_LOAD_WINDOW).
+         */
+        void SetLoadWindow(uint32_t ms);
+
+        /**
+         * @brief This method sets the policy of the power governor (see @ref NPower):
+         * the modes used while @ref Sleep is ON are chosen at each idle entry.
+         * @arg deepest:
+         * deepest mode allowed (default @ref __SYS_POWER_DEEPEST).
+         * @arg latency:
+         * longest wake-up latency tolerated, in microseconds (0: any).
+         * @note Components limit the modes with an @ref NPowerConstraint.
+         */
+        void SetPowerPolicy(NPOWERMODE deepest, uint32_t latency);
+
+        /**
+         * @brief This method reads the use of a power mode.
+         * @arg mode, stats:
+         * power mode and the statistics read.
+         * @return
+         * - true: statistics available.
+         * - false: invalid mode, or compiled without -D__SYS_POWER.
+         */
+        bool GetPowerStats(NPOWERMODE mode, NPOWERSTATS* stats);
+
+        /**
+         * @brief This method is used "by the kernel" to call the InterruptCallBack of a component (timed by the profiler).
+         */
+#ifdef __SYS_PROFILER
+        void InvokeCallback(NComponent* Owner, NMESSAGE* Msg);
+#else
+        void InvokeCallback(NComponent* Owner, NMESSAGE* Msg){ NRECORD_DERIVED(); Owner->InterruptCallBack(Msg);}
+#endif
+
         /**
          * @brief This method is used to request the inclusion of a particular component in the system notification table.
          * @arg iComp:
@@ -182,6 +558,55 @@ class System{
          */
 		bool FindComponent(HANDLE fComp);
 
+        /**
+         * @brief This method returns the identifier of a registered component.
+         * Unlike the component handle, the identifier is never reused: once the component
+         * is excluded, @ref GetComponent returns NULL for it, even if another component
+         * is created at the same address.
+         * @arg iComp:
+         * The component handle.
+         * @return
+         * - the component identifier, or @ref __SYS_COMPONENT_NONE if not registered.
+         */
+		uint32_t GetComponentId(HANDLE iComp);
+
+        /**
+         * @brief This method returns the component matching an identifier.
+         * @arg id:
+         * The identifier returned by @ref GetComponentId.
+         * @return
+         * - the component handle, or NULL if the component is not registered anymore.
+         */
+		HANDLE GetComponent(uint32_t id);
+
+        /**
+         * @brief This method is used to declare that a component handles a particular message.
+         * From its first subscription on, the component is notified only of the messages it subscribed to,
+         * sparing the dispatcher from calling its Notify method for every other message.
+         * @arg sComp:
+         * The component handle.
+         * @arg message:
+         * The message identifier (NM_TIMETICK, NM_KEYSCAN, etc.).
+         * @return
+         * - true: subscription registered.
+         * - false: component not registered or @ref __SYS_MAX_SUBSCRIPTIONS was reached.
+         * @note
+         * - Components that never subscribe keep receiving every message.
+         */
+		bool Subscribe(HANDLE sComp, uint32_t message);
+
+        /**
+         * @brief This method cancels a subscription registered by @ref Subscribe.
+         * @arg uComp:
+         * The component handle.
+         * @arg message:
+         * The message identifier.
+         * @return
+         * - true: subscription removed.
+         * - false: subscription not found.
+         */
+		bool Unsubscribe(HANDLE uComp, uint32_t message);
+
         /**
          * @brief Registers a given component in the system "hardware interrupt" notification table.
          * @arg hComp:
@@ -216,18 +641,22 @@ class System{
          *
          * <b> Message Rules </b>
          * - Field "data1" must contain the "vector index" of the component to be notified.
+         * @arg flags:
+         * @ref __SYS_MESSAGE_BUFFER if "tag" carries a data block reference.
          */
-		void CallbackSchedule(NMESSAGE* Msg);
+		void CallbackSchedule(NMESSAGE* Msg, uint32_t flags = __SYS_MESSAGE_PLAIN);
 
         /**
          * @brief This method extracts a message from system "callback notification queue".
          * @arg Msg:
          * The pointer to a @ref NMESSAGE data struct to be receive the extracted message.
+         * @arg flags:
+         * receives the flags given to @ref CallbackSchedule (may be NULL).
          *
          * @warning
          * - This method MUST not be called by the application.
          */
-		bool CallbackAttend(NMESSAGE* Msg);
+		bool CallbackAttend(NMESSAGE* Msg, uint32_t* flags = NULL);
 
         /**
          * @brief This method releases the system "callback notification queue".
@@ -253,6 +682,40 @@ class System{
          * - The components are notified by the InterruptCallback method.
          */
 		void Dispatch(NMESSAGE* Msg);
+
+        /**
+         * @brief This method queues a message for all the registered components, with an explicit priority.
+         * @arg Msg:
+         * The pointer to a @ref NMESSAGE data struct to be queued.
+         * @arg priority:
+         * The priority level: 0 (@ref __SYS_QUEUE_STANDARD) to @ref __SYS_QUEUE_PRIORITY
+         * (@ref __SYS_PRIORITY_LEVELS - 1). Messages of a higher level are always dispatched first.
+         * @return
+         * - true: message queued.
+         * - false: message discarded by the queue overflow policy.
+         */
+		bool PostMessage(NMESSAGE* Msg, uint32_t priority);
+
+        /**
+         * @brief This method queues a message for a single component (unicast).
+         * Only the destination is notified: request/response traffic between two components
+         * does not visit the other registered components.
+         * @arg Msg:
+         * The pointer to a @ref NMESSAGE data struct to be queued.
+         * @arg destination:
+         * The handle of the destination component.
+         * @return
+         * - true: message queued.
+         * - false: destination not registered, or message discarded by the queue overflow policy.
+         */
+		bool SendMessage(NMESSAGE* Msg, HANDLE destination);
+
+        /**
+         * @brief This method queues a message for a single component, with an explicit priority.
+         * @arg priority:
+         * The priority level: 0 (@ref __SYS_QUEUE_STANDARD) to @ref __SYS_QUEUE_PRIORITY.
+         */
+		bool SendMessage(NMESSAGE* Msg, HANDLE destination, uint32_t priority);
 	
         /**
          * @brief This method creates a "blocking" local timer
@@ -261,10 +724,43 @@ class System{
          * @return true if successfully created
          *
          * @note
-         * - This method is deprecated. Consider using @ref Delay.
+         * - This method is deprecated. Consider using @ref StartTimer or @ref StartMessageTimer.
          */
         bool InstallTimeout(void* flag, uint32_t delay);
 
+        /**
+         * @brief This method starts a kernel timer that calls a function.
+         * Timers are held in a timing wheel (@ref NTimerWheel): starting, cancelling and
+         * expiring a timer take constant time, whatever the number of armed timers.
+         * @arg callback: function called on expiration, from the SysTick interrupt
+         * (it must be short: consider @ref StartMessageTimer for longer processing).
+         * @arg context: value passed to the function.
+         * @arg delay: time to the first expiration, in milliseconds (up to about 12 days).
+         * @arg period: time between later expirations, in milliseconds (0: one-shot).
+         * @return the timer identifier, or @ref __SYS_TIMER_NONE if no timer is available
+         * (@ref __SYS_MAX_TIMERS).
+         */
+        uint32_t StartTimer(NTIMERCALLBACK callback, void* context, uint32_t delay, uint32_t period = 0);
+
+        /**
+         * @brief This method starts a kernel timer that queues a message.
+         * The message carries: data1 = timer identifier, data2 = expiration time, tag = 0.
+         * @arg message: the message identifier.
+         * @arg destination: the component to be notified, or NULL to broadcast the message.
+         * @arg delay: time to the first expiration, in milliseconds (up to about 12 days).
+         * @arg period: time between later expirations, in milliseconds (0: one-shot).
+         * @return the timer identifier, or @ref __SYS_TIMER_NONE if no timer is available.
+         */
+        uint32_t StartMessageTimer(uint32_t message, HANDLE destination, uint32_t delay, uint32_t period = 0);
+
+        /**
+         * @brief This method cancels a kernel timer.
+         * @arg timer: the timer identifier.
+         * @return
+         * - false: the timer had already expired or was cancelled.
+         */
+        bool CancelTimer(uint32_t timer);
+
         /**
          * @brief This method is used to get the system ticks counter.
          * The ticks counter is incremented every milliseconds,
@@ -273,6 +769,13 @@ class System{
          */
 		uint32_t GetSystemTime();
 
+        /**
+         * @brief This method is used to get the 64-bit system ticks counter (milliseconds),
+         * which never overlaps in practice.
+         * @return current value of the ticks counter.
+         */
+		uint64_t GetSystemTime64();
+
         /**
          * @brief This method returns a pseudo-random 8-bit number.
          * @return random 8-bit number
@@ -289,23 +792,51 @@ class System{
 
         /**
          * @brief This method gets the number of microseconds since the system startup.
-         * Due to hardware limitations, this method is not very accurate.
+         * The value overlaps every 71 minutes: use it for intervals (difference of two readings).
          * @return current number of microseconds.
          */
         uint32_t Microseconds();
 
         /**
-         * @brief This method freezes the execution for the specified number of milliseconds.
-         * This method should be avoided as much as possible, as it makes the application less efficient,
-         * both in terms of responsiveness and energy consumption.
+         * @brief This method gets the monotonic 64-bit system clock, in nanoseconds since the system startup.
+         * Resolution: one core clock cycle (the SysTick counter within the current tick).
+         * Race-free: a tick ending during the reading is detected, from any context.
+         * @return current number of nanoseconds.
+         */
+        uint64_t Nanoseconds();
+
+        /**
+         * @brief This method recalibrates the system tick (1 ms) and the clock readings to the core clock.
+         * It MUST be called after the core clock is changed (CPU_StartPLL, CPU_StartHSE, etc.).
+         */
+        void ClockChanged();
+
+        /**
+         * @brief This method waits until a condition is met or the timeout expires, without
+         * stopping the system: while waiting, the pending messages are dispatched to the
+         * other components, and the core sleeps (WFI) when there is nothing to do.
+         * The messages addressed to the calling component are deferred and delivered,
+         * in order, after the wait (no re-entrance in its Notify).
+         * @arg condition: function returning true when the wait is over (NULL: wait for the timeout).
+         * @arg context: value passed to "condition".
+         * @arg Tms: timeout, in milliseconds (0: no timeout).
+         * @return true if the condition was met, false on timeout.
+         * @note Called from an interrupt handler, it just spins (no dispatching).
+         */
+        bool WaitFor(bool (*condition)(void*), void* context, uint32_t Tms);
+
+        /**
+         * @brief This method waits for the specified number of milliseconds (see @ref WaitFor).
+         * The other components keep running meanwhile: a component calling it should
+         * expect the system state to change during the delay.
          * @arg Tms: time to wait, in milliseconds.
          */
         void Delay(uint32_t Tms);
 
         /**
          * @brief This method freezes the execution for the specified number of microseconds.
-         * The excessive use of this method should be avoided as, as mentioned in @ref Delay,
-         * significantly compromises efficiency.
+         * The excessive use of this method should be avoided as it significantly compromises
+         * efficiency. Safe in any context, even with the interrupts disabled.
          * @arg Tus: time to wait, in microseconds.
          */
         void MicroDelay(uint32_t Tus);
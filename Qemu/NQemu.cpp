@@ -0,0 +1,90 @@
+//==============================================================================
+// EDROS on QEMU: startup and semihosting (see NQemu.h)
+//------------------------------------------------------------------------------
+// - Flash vector table: initial stack and reset only; the other exceptions end
+//   the emulation with an error until the kernel relocates the table to RAM.
+// - Reset: .data and .bss (Qemu/stm32f100rb.ld), static constructors, main().
+// - Semihosting: "bkpt 0xAB", operation in r0 and its argument in r1.
+//
+// Build (tools/edros_qemu.py runs it):
+//   arm-none-eabi-g++ -mcpu=cortex-m3 -mthumb -O2 -DEDROS_QEMU -fno-exceptions
+//       -fno-rtti -ffunction-sections -fdata-sections -IQemu -IInc -I<framework Inc>
+//       Src/*.cpp Qemu/NQemu.cpp Bench/QemuWorkload.cpp <framework sources>
+//       -T Qemu/stm32f100rb.ld -Wl,--gc-sections --specs=nano.specs --specs=nosys.specs
+// Run:
+//   qemu-system-arm -M stm32vldiscovery -display none -monitor none -serial none
+//       -semihosting-config enable=on,target=native -icount shift=0,align=off,sleep=off
+//       -kernel <elf>
+//==============================================================================
+#ifdef EDROS_QEMU
+
+#include "NQemu.h"
+
+//------------------------------------------------------------------------------
+// linker script symbols
+extern uint32_t _sidata, _sdata, _edata, _sbss, _ebss, _estack;
+
+extern "C" void __libc_init_array(void);
+extern int main(void);
+
+extern "C" void Reset_Handler(void);
+extern "C" void NQemu_Fault_Handler(void);
+
+//------------------------------------------------------------------------------
+__attribute__((section(".isr_vector"), used))
+static void (* const qemuVectors[16])(void) = {
+    (void (*)(void))&_estack,
+    Reset_Handler,
+    NQemu_Fault_Handler,        // NMI
+    NQemu_Fault_Handler,        // HardFault
+    NQemu_Fault_Handler,        // MemManage
+    NQemu_Fault_Handler,        // BusFault
+    NQemu_Fault_Handler,        // UsageFault
+    0, 0, 0, 0,
+    NQemu_Fault_Handler,        // SVCall
+    NQemu_Fault_Handler,        // DebugMon
+    0,
+    NQemu_Fault_Handler,        // PendSV
+    NQemu_Fault_Handler         // SysTick
+};
+
+//------------------------------------------------------------------------------
+static inline uint32_t Semihost(uint32_t operation, uint32_t argument){
+    register uint32_t r0 asm("r0") = operation;
+    register uint32_t r1 asm("r1") = argument;
+    asm volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+    return(r0);
+}
+
+//------------------------------------------------------------------------------
+void NQemuWrite(const char* text){
+    Semihost(__SYS_SEMIHOST_WRITE0, (uint32_t)text);
+}
+
+//------------------------------------------------------------------------------
+void NQemuExit(bool success){
+    Semihost(__SYS_SEMIHOST_EXIT, success? __SYS_SEMIHOST_EXIT_OK : __SYS_SEMIHOST_EXIT_ERROR);
+    while(1);
+}
+
+//------------------------------------------------------------------------------
+extern "C" {
+void NQemu_Fault_Handler(void){
+    NQemuWrite("edros: unexpected exception before the vector table relocation\n");
+    NQemuExit(false);
+}}
+
+//------------------------------------------------------------------------------
+extern "C" {
+void Reset_Handler(void){
+    uint32_t* source = &_sidata;
+    for(uint32_t* p = &_sdata; p < &_edata; ) *p++ = *source++;
+    for(uint32_t* p = &_sbss; p < &_ebss; ) *p++ = 0L;
+    __libc_init_array();
+
+    main();
+    NQemuExit(false);
+}}
+
+#endif
+//==============================================================================
@@ -0,0 +1,64 @@
+//==============================================================================
+/**
+ * @file NQemu.h
+ * @brief EDROS on QEMU: STM32 board model (-DEDROS_QEMU)\n
+ * Runs the Cortex-M3 port, unchanged, on the QEMU "stm32vldiscovery" board
+ * (STM32F100RB: Cortex-M3, 128 KB flash, 8 KB SRAM, 24 MHz):
+ * - Qemu/NQemu.cpp: vector table, reset handler and semihosting (console, exit);
+ * Qemu/stm32f100rb.ld: memory map.
+ * - The kernel keeps its own RAM vector table (RelocateVectors) and main().
+ * - QEMU does not emulate the clock tree nor the DWT cycle counter. Run with
+ * "-icount shift=N", each instruction advances the virtual clock by 2^N ns and
+ * SysTick counts that clock: Bench/QemuWorkload.cpp measures instruction counts
+ * with it. Flash wait states, pipeline stalls and exception stacking are not
+ * modeled: the counts are ARM code paths, not cycles.
+ * - tools/edros_qemu.py builds the workload, boots it and compares the results.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ */
+//------------------------------------------------------------------------------
+#ifndef NQEMU_H
+    #define NQEMU_H
+
+    #include <stdint.h>
+
+#ifndef EDROS_QEMU
+    #error "NQemu.h: QEMU builds only (-DEDROS_QEMU)"
+#endif
+
+//------------------------------------------------------------------------------
+// "-icount shift" of the run: 2^N ns of virtual time per instruction
+#ifndef __SYS_QEMU_ICOUNT_SHIFT
+	#define __SYS_QEMU_ICOUNT_SHIFT 	((uint32_t) 0)
+#endif
+
+// semihosting operations and exit reasons (ARM semihosting specification)
+#define __SYS_SEMIHOST_WRITE0 		((uint32_t) 0x04)
+#define __SYS_SEMIHOST_EXIT 		((uint32_t) 0x18)
+#define __SYS_SEMIHOST_EXIT_OK 		((uint32_t) 0x20026)	// ADP_Stopped_ApplicationExit
+#define __SYS_SEMIHOST_EXIT_ERROR 	((uint32_t) 0x20023)	// ADP_Stopped_RunTimeErrorUnknown
+
+    /**
+     * @brief Writes a text to the QEMU console (semihosting).
+     */
+    void NQemuWrite(const char* text);
+
+    /**
+     * @brief Ends the emulation.
+     * @arg success
+     * - false: QEMU exits with status 1.
+     */
+    void NQemuExit(bool success) __attribute__((noreturn));
+
+#endif
+//==============================================================================
@@ -6,9 +6,13 @@
 //============================================================================//
 //#include "SysInts.h"
 #include "DRV_CPU.h"
+#ifndef EDROS_HOST
 #include "DRV_SSR.h"
+#endif
 #include "System.h"
+#ifndef EDROS_HOST
 #include "DRV_IO.h"
+#endif
 #include "Interrupts.h"
 
 #define optional __attribute__((unused))
@@ -19,6 +23,7 @@ void EDROS_BusFault_Handler(){ while(1);}
 void EDROS_UsageFault_Handler(){ while(1);}
 void EDROS_DebugMon_Handler(){ while(1);}
 
+#ifndef EDROS_HOST
 //------------------------------------------------------------------------------
 extern "C" {
 #ifdef __GNUC__	
@@ -81,12 +86,16 @@ void EDROS_SVCall_Handler(uint32_t* param){
             SYS->Dispatch(&Msg1);
         } break;
 
+        case SVC_SEND_MESSAGE:
+          param[0] = (uint32_t)SYS->SendMessage((NMESSAGE*)R0, (HANDLE)R1);
+          break;
+
         case SVC_THROW_EXCEPTION:
           SYS->AppException(R0);
           break;
 
         case SVC_MICROSECONDS:
-          SYS->Microseconds();
+          param[0] = SYS->Microseconds();
           break;
 
         case SVC_DELAY:
@@ -97,6 +106,18 @@ void EDROS_SVCall_Handler(uint32_t* param){
           SYS->MicroDelay(R0);
           break;
 
+        case SVC_SUBSCRIBE_MESSAGE:
+          param[0] = (uint32_t)SYS->Subscribe((HANDLE)R0, R1);
+          break;
+
+        case SVC_UNSUBSCRIBE_MESSAGE:
+          param[0] = (uint32_t)SYS->Unsubscribe((HANDLE)R0, R1);
+          break;
+
+        case SVC_POST_MESSAGE:
+          param[0] = (uint32_t)SYS->PostMessage((NMESSAGE*)R0, R1);
+          break;
+
         default: break;
     }
 }
@@ -143,42 +164,134 @@ __irq void EDROS_SVCall_Handler(uint32_t* svc_args){
           break;
         case SVC_THROW_MESSAGE:
           break;
+
+        case SVC_SEND_MESSAGE:
+          svc_args[0] = (uint32_t)SYS->SendMessage((NMESSAGE*)regR0, (HANDLE)regR1);
+          break;
         
         case SVC_THROW_EXCEPTION:
           break;
+
+        case SVC_SUBSCRIBE_MESSAGE:
+          svc_args[0] = (uint32_t)SYS->Subscribe((HANDLE)regR0, regR1);
+          break;
+        case SVC_UNSUBSCRIBE_MESSAGE:
+          svc_args[0] = (uint32_t)SYS->Unsubscribe((HANDLE)regR0, regR1);
+          break;
+        case SVC_POST_MESSAGE:
+          svc_args[0] = (uint32_t)SYS->PostMessage((NMESSAGE*)regR0, regR1);
+          break;
 	}
     return;
 }
 #endif
 }
+#endif
 
 //------------------------------------------------------------------------------
 extern "C" {
-void EDROS_PendSV_Handler(void){
+void EDROS_PendSV_Callbacks(void){
+	NLOAD_ISR();
 	NMESSAGE Msg1;
 	NComponent* Owner = NULL;
+	uint32_t flags;
+	NTRACE(__SYS_TRACE_PENDSV_ENTER, 0, 0, 0);
+#ifdef __SYS_TRACE
+	uint32_t attended = 0L;
+#endif
 
-	while(SYS->CallbackAttend(&Msg1)){
+	while(SYS->CallbackAttend(&Msg1, &flags)){
+#ifdef __SYS_TRACE
+		attended++;
+#endif
+		uint32_t tag = Msg1.tag;
+		bool buffer = ((flags & __SYS_MESSAGE_BUFFER) != 0L);
 		if(Msg1.data1 <= NV_LAST){
 			Owner = (NComponent*)SYS->GetCallback(Msg1.data1);
 			if(Owner != NULL){
-				Owner->InterruptCallBack(&Msg1);
-				if(Msg1.message != NM_NULL){ SYS->Dispatch(&Msg1);}
+				SYS->InvokeCallback(Owner, &Msg1);
+				if(Msg1.message != NM_NULL){
+					// a message forwarding the data block takes its own reference
+					if(buffer && (Msg1.tag == tag)){ SYS->RetainBuffer(tag); SYS->DispatchBuffer(&Msg1);}
+					else SYS->Dispatch(&Msg1);
+				}
 			}
 		}
+		// the data block reference of the callback ends with InterruptCallBack
+		if(buffer){ SYS->ReleaseBuffer(tag);}
 	}
 	SYS->CallbackAttended();
+	NTRACE(__SYS_TRACE_PENDSV_EXIT, 0, attended, 0);
 }}
 
+//------------------------------------------------------------------------------
+extern "C" {
+#if defined(__SYS_THREADS) && !defined(EDROS_HOST)
+// callbacks first, then the context switch to sysThreadSwitch[1] (see NThread.h):
+// the system thread is saved on the main stack, the other threads on their own
+void __attribute__((naked)) EDROS_PendSV_Handler(void){
+	asm volatile(
+		"push {r4, lr}\t\n"
+		"bl EDROS_PendSV_Callbacks\t\n"
+		"pop {r4, lr}\t\n"
+		"tst lr, #8\t\n"				// nested in another handler: not now
+		"beq 9f\t\n"
+		"cpsid i\t\n"
+		"ldr r2, =sysThreadSwitch\t\n"
+		"ldr r0, [r2]\t\n"				// running thread
+		"ldr r1, [r2, #4]\t\n"			// selected thread
+		"cmp r0, r1\t\n"
+		"beq 8f\t\n"
+		"tst lr, #4\t\n"
+		"bne 1f\t\n"
+		"push {r4-r11}\t\n"
+		"mrs r3, msp\t\n"
+		"b 2f\t\n"
+		"1: mrs r3, psp\t\n"
+		"stmdb r3!, {r4-r11}\t\n"
+		"2: str r3, [r0]\t\n"			// sp
+		"str lr, [r0, #4]\t\n"			// exc_return
+		"str r1, [r2]\t\n"
+		"ldr r3, [r1]\t\n"
+		"ldr lr, [r1, #4]\t\n"
+		"tst lr, #4\t\n"
+		"bne 3f\t\n"
+		"msr msp, r3\t\n"
+		"pop {r4-r11}\t\n"
+		"b 8f\t\n"
+		"3: ldmia r3!, {r4-r11}\t\n"
+		"msr psp, r3\t\n"
+		"8: cpsie i\t\n"
+		"9: bx lr"
+	);
+}
+#elif defined(__SYS_THREADS)
+// host port: PendSV has the lowest priority, it never preempts another handler
+void EDROS_PendSV_Handler(void){
+	EDROS_PendSV_Callbacks();
+	NThread::Switch();
+}
+#else
+void EDROS_PendSV_Handler(void){
+	EDROS_PendSV_Callbacks();
+}
+#endif
+}
+
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_SysTick_Handler (void){
+    NLOAD_ISR();
     SYS->Heartbeat();
 }}
 
+// peripherals and vector table: target only (the host port installs its own)
+#ifndef EDROS_HOST
+
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA1_Channel1_IRQHandler(void){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA1_CH1;
@@ -203,6 +316,7 @@ void EDROS_DMA1_Channel1_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA1_Channel2_IRQHandler(void){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA1_CH2;
@@ -227,6 +341,7 @@ void EDROS_DMA1_Channel2_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA1_Channel3_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
 	Msg1.data1 = NV_DMA1_CH3;
@@ -251,6 +366,7 @@ void EDROS_DMA1_Channel3_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA1_Channel4_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
 	Msg1.data1 = NV_DMA1_CH4;
@@ -275,6 +391,7 @@ void EDROS_DMA1_Channel4_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA1_Channel5_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA1_CH5;
@@ -299,6 +416,7 @@ void EDROS_DMA1_Channel5_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA1_Channel6_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA1_CH6;
@@ -323,6 +441,7 @@ void EDROS_DMA1_Channel6_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA1_Channel7_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
 	Msg1.data1 = NV_DMA1_CH7;
@@ -348,6 +467,7 @@ void EDROS_DMA1_Channel7_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA2_Channel1_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA2_CH1;
@@ -372,6 +492,7 @@ void EDROS_DMA2_Channel1_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA2_Channel2_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA2_CH2;
@@ -396,6 +517,7 @@ void EDROS_DMA2_Channel2_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA2_Channel3_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA2_CH3;
@@ -420,6 +542,7 @@ void EDROS_DMA2_Channel3_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA2_Channel4_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA2_CH4;
@@ -444,6 +567,7 @@ void EDROS_DMA2_Channel4_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_DMA2_Channel5_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     Msg1.data1 = NV_DMA2_CH5;
@@ -469,6 +593,7 @@ void EDROS_DMA2_Channel5_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_USART1_IRQHandler(void){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     USART_TypeDef* USARTx = USART1;
@@ -510,6 +635,7 @@ void EDROS_USART1_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_USART2_IRQHandler(void){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     USART_TypeDef* USARTx = USART2;
@@ -552,6 +678,7 @@ void EDROS_USART2_IRQHandler(void){
 #if defined(USART3)
 extern "C" {
 void EDROS_USART3_IRQHandler(void){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     USART_TypeDef* USARTx = USART3;
@@ -594,6 +721,7 @@ void EDROS_USART3_IRQHandler(void){
 #if defined(UART4)
 extern "C" {
 void EDROS_USART4_IRQHandler(void){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     USART_TypeDef* USARTx = USART4;
@@ -637,6 +765,7 @@ void EDROS_USART4_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_USART5_IRQHandler(void){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     USART_TypeDef* USARTx = USART5;
@@ -679,6 +808,7 @@ void EDROS_USART5_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_SPI1_IRQHandler(){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     SPI_TypeDef* SPIx = SPI1;
     
@@ -704,6 +834,7 @@ void EDROS_SPI1_IRQHandler(){
 #if defined(SPI2)
 extern "C" {
 void EDROS_SPI2_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     SPI_TypeDef* SPIx = SPI2;
     
@@ -729,6 +860,7 @@ void EDROS_SPI2_IRQHandler(){
 #if defined (SPI3)
 extern "C" {
 void EDROS_SPI3_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     SPI_TypeDef* SPIx = SPI3;
     
@@ -754,6 +886,7 @@ void EDROS_SPI3_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_I2C1_EV_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     I2C_TypeDef* I2Cx = I2C1;
@@ -784,6 +917,7 @@ void EDROS_I2C1_EV_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_I2C1_ER_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     I2C_TypeDef* I2Cx = I2C1;
@@ -820,6 +954,7 @@ void EDROS_I2C1_ER_IRQHandler(void){
 #if defined(I2C2)
 extern "C" {
 void EDROS_I2C2_EV_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     I2C_TypeDef* I2Cx = I2C2;
@@ -850,6 +985,7 @@ void EDROS_I2C2_EV_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_I2C2_ER_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     I2C_TypeDef* I2Cx = I2C2;
@@ -887,6 +1023,7 @@ void EDROS_I2C2_ER_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_CAN1_TX_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     CAN_TypeDef* CANx = CAN1;
     
@@ -908,6 +1045,7 @@ void EDROS_CAN1_TX_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_CAN1_RX0_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     CAN_TypeDef* CANx = CAN1;
 
@@ -931,6 +1069,7 @@ void EDROS_CAN1_RX0_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_CAN1_RX1_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     CAN_TypeDef* CANx = CAN1;
 
@@ -954,6 +1093,7 @@ void EDROS_CAN1_RX1_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_CAN1_SCE_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     CAN_TypeDef* CANx = CAN1;
 
@@ -975,6 +1115,7 @@ void EDROS_CAN1_SCE_IRQHandler(){
 #if defined(CAN2)
 extern "C" {
 void EDROS_CAN2_TX_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     CAN_TypeDef* CANx = CAN2;
     
@@ -996,6 +1137,7 @@ void EDROS_CAN2_TX_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_CAN2_RX0_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     CAN_TypeDef* CANx = CAN2;
 
@@ -1019,6 +1161,7 @@ void EDROS_CAN2_RX0_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_CAN2_RX1_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     CAN_TypeDef* CANx = CAN2;
 
@@ -1042,6 +1185,7 @@ void EDROS_CAN2_RX1_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_CAN2_SCE_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
     CAN_TypeDef* CANx = CAN2;
 
@@ -1063,6 +1207,7 @@ void EDROS_CAN2_SCE_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_EXTI0_IRQHandler(){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_EXTINT, (uint32_t)NV_EXTINT0, 0, 0};
 	
     EXTI->PR |= EXTI_PR_PR0;
@@ -1075,6 +1220,7 @@ void EDROS_EXTI0_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_EXTI1_IRQHandler(){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_EXTINT, (uint32_t)NV_EXTINT1, 0, 0};
 	
     EXTI->PR |= EXTI_PR_PR1;
@@ -1087,6 +1233,7 @@ void EDROS_EXTI1_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_EXTI2_IRQHandler(){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_EXTINT, (uint32_t)NV_EXTINT2, 0, 0};
 	
     EXTI->PR |= EXTI_PR_PR2;
@@ -1099,6 +1246,7 @@ void EDROS_EXTI2_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_EXTI3_IRQHandler(){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_EXTINT, (uint32_t)NV_EXTINT3, 0, 0};
 	
     EXTI->PR |= EXTI_PR_PR3;
@@ -1111,6 +1259,7 @@ void EDROS_EXTI3_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_EXTI4_IRQHandler(){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_EXTINT, (uint32_t)NV_EXTINT4, 0, 0};
 	
     EXTI->PR |= EXTI_PR_PR4;
@@ -1132,6 +1281,7 @@ void EDROS_EXTI4_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_EXTI9_5_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_EXTINT, 0, 0, 0};
 	uint32_t pin = -1;
 	
@@ -1159,6 +1309,7 @@ void EDROS_EXTI9_5_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_EXTI15_10_IRQHandler(){
+	NIRQ_ENTRY();
     NMESSAGE Msg1 = {NM_EXTINT, 0, 0, 0};
     uint32_t pin = -1;
 
@@ -1203,6 +1354,7 @@ void EDROS_OTG_FS_IRQHandler(){}
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_ADC1_2_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_EXTINT, 0, 0, 0};
 
     if(ADC1->SR & ADC_SR_EOC){
@@ -1226,6 +1378,7 @@ void EDROS_ADC1_2_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_TIM1_UP_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     TIM1->SR &= ~TIM_SR_UIF;
@@ -1238,6 +1391,7 @@ void EDROS_TIM1_UP_IRQHandler(void){
 
 //------------------------------------------------------------------------------
 void EDROS_TIM1_BRK_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     TIM1->SR &= ~TIM_SR_BIF;
@@ -1249,6 +1403,7 @@ void EDROS_TIM1_BRK_IRQHandler(){
 }
 //------------------------------------------------------------------------------
 void EDROS_TIM1_TRG_COM_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     if(TIM1->SR & TIM_SR_TIF){
@@ -1264,6 +1419,7 @@ void EDROS_TIM1_TRG_COM_IRQHandler(){
 }
 //------------------------------------------------------------------------------
 void EDROS_TIM1_CC_IRQHandler(){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     if(TIM1->SR & TIM_SR_CC1IF){ TIM1->SR &= ~TIM_SR_CC1IF; Msg1.data2 = 1;}
@@ -1289,6 +1445,7 @@ void EDROS_TIM1_CC_IRQHandler(){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_TIM2_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
 	Msg1.data1 = NV_TIM2;
@@ -1320,6 +1477,7 @@ void EDROS_TIM2_IRQHandler(void){
 //------------------------------------------------------------------------------
 extern "C" {
 void EDROS_TIM3_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     if(TIM3->SR & TIM_SR_UIF){ TIM3->SR &= ~TIM_SR_UIF;}
@@ -1351,6 +1509,7 @@ void EDROS_TIM3_IRQHandler(void){
 #if defined(TIM4)
 extern "C" {
 void EDROS_TIM4_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     if(TIM4->SR & TIM_SR_UIF){ TIM4->SR &= ~TIM_SR_UIF;}
@@ -1381,6 +1540,7 @@ void EDROS_TIM4_IRQHandler(void){
 #if defined(TIM5)
 extern "C" {
 void EDROS_TIM5_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     if(TIM5->SR & TIM_SR_UIF){ TIM5->SR &= ~TIM_SR_UIF;}
@@ -1411,6 +1571,7 @@ void EDROS_TIM5_IRQHandler(void){
 #if defined(TIM6)
 extern "C" {
 void EDROS_TIM6_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
     TIM6->SR &= ~TIM_SR_UIF;
@@ -1426,6 +1587,7 @@ void EDROS_TIM6_IRQHandler(void){
 #if defined(TIM7)
 extern "C" {
 void EDROS_TIM7_IRQHandler(void){
+	NIRQ_ENTRY();
 	NMESSAGE Msg1 = {NM_NULL, 0, 0, 0};
 
 	TIM7->SR &= ~TIM_SR_UIF;
@@ -1551,5 +1713,7 @@ void RelocateVectors(){
     __enable_irq();
 }
 
+#endif
+
 //==============================================================================
 
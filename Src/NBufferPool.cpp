@@ -0,0 +1,119 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+//------------------------------------------------------------------------------
+// handles are the block addresses on 32-bit targets; on wider hosts they are
+// offsets from a fixed origin, so they still fit in a message "tag"
+#if (UINTPTR_MAX > 0xFFFFFFFFUL)
+	#define __SYS_BUFFER_ORIGIN(a) 	((uint32_t) 0xB0000000)
+#else
+	#define __SYS_BUFFER_ORIGIN(a) 	((uint32_t)(uintptr_t)(a))
+#endif
+
+//------------------------------------------------------------------------------
+NBufferPool::NBufferPool(uint32_t* storage, NAtomic* references, uint32_t words, uint32_t blocks){
+    arena = storage;
+    origin = __SYS_BUFFER_ORIGIN(storage);
+    refs = references;
+    block_words = words;
+    number = blocks;
+    free_blocks.Store((blocks < 32)? ((1UL << blocks) - 1) : 0xFFFFFFFF);
+}
+
+//------------------------------------------------------------------------------
+// block index of an allocated block, or __SYS_INDEX_INVALID
+uint32_t NBufferPool::Index(uint32_t handle){
+    uint32_t offset = handle - origin;
+    uint32_t block_size = block_words << 2;
+
+    //---------------------------------------
+    // "offset" wraps around for handles below the origin
+    if(offset >= (number * block_size)){ return(__SYS_INDEX_INVALID);}
+    if((offset % block_size) != 0L){ return(__SYS_INDEX_INVALID);}
+    uint32_t index = offset / block_size;
+    if(refs[index].Load() == 0L){ return(__SYS_INDEX_INVALID);}
+    return(index);
+}
+
+//------------------------------------------------------------------------------
+void* NBufferPool::Allocate(){
+    uint32_t available = free_blocks.Load();
+    while(available != 0L){
+        uint32_t bit = __CLZ(__RBIT(available));
+        if(free_blocks.CompareExchange(available, available & ~(1UL << bit))){
+            refs[bit].Store(1L);
+
+            //-------------------------------
+            uint32_t n = used.FetchAdd(1) + 1;
+            uint32_t peak = watermark.Load();
+            while((n > peak)&&(!watermark.CompareExchange(peak, n))){}
+            return(&arena[bit * block_words]);
+        }
+    }
+    failures.FetchAdd(1);
+    return(NULL);
+}
+
+//------------------------------------------------------------------------------
+bool NBufferPool::Retain(uint32_t handle){
+    uint32_t index = Index(handle);
+    if(index == __SYS_INDEX_INVALID){ return(false);}
+
+    //---------------------------------------
+    // never resurrect a block released in the meantime
+    uint32_t count = refs[index].Load();
+    while(count != 0L){
+        if(refs[index].CompareExchange(count, count + 1)){ return(true);}
+    }
+    return(false);
+}
+
+//------------------------------------------------------------------------------
+bool NBufferPool::Release(uint32_t handle){
+    uint32_t index = Index(handle);
+    if(index == __SYS_INDEX_INVALID){ return(false);}
+
+    //---------------------------------------
+    uint32_t count = refs[index].Load();
+    while(count != 0L){
+        if(refs[index].CompareExchange(count, count - 1)){
+            if(count == 1L){
+                used.FetchAdd(0xFFFFFFFF);
+                free_blocks.FetchOr(1UL << index);
+            }
+            return(true);
+        }
+    }
+    return(false);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NBufferPool::Handle(const void* data){
+    uint32_t handle = origin + (uint32_t)((const uint8_t*)data - (const uint8_t*)arena);
+    if(Index(handle) == __SYS_INDEX_INVALID){ return(__SYS_BUFFER_NONE);}
+    return(handle);
+}
+
+//------------------------------------------------------------------------------
+void* NBufferPool::Data(uint32_t handle){
+    uint32_t index = Index(handle);
+    if(index == __SYS_INDEX_INVALID){ return(NULL);}
+    return(&arena[index * block_words]);
+}
+
+//------------------------------------------------------------------------------
+bool NBufferPool::Contains(uint32_t handle){
+    return(Index(handle) != __SYS_INDEX_INVALID);
+}
+
+//------------------------------------------------------------------------------
+void NBufferPool::GetStats(NBUFFERSTATS* Stats){
+    Stats->blocks = number;
+    Stats->size = block_words << 2;
+    Stats->used = used.Load();
+    Stats->watermark = watermark.Load();
+    Stats->failures = failures.Load();
+}
+
+//==============================================================================
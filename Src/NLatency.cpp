@@ -0,0 +1,109 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+#ifdef __SYS_LATENCY
+
+//------------------------------------------------------------------------------
+volatile uint32_t NLatency::entry = 0L;
+volatile uint32_t NLatency::armed = 0L;
+
+//------------------------------------------------------------------------------
+NLatency::NLatency(){
+    Reset();
+}
+
+//------------------------------------------------------------------------------
+void NLatency::Clear(NLATENCYSTATS* Stats, uint32_t vector, uint32_t path){
+    Stats->vector = vector;
+    Stats->path = path;
+    Stats->samples = 0L;
+    Stats->min = 0xFFFFFFFF;
+    Stats->max = 0L;
+    for(uint32_t b=0L; b<__SYS_LATENCY_BUCKETS; b++) Stats->buckets[b] = 0L;
+}
+
+//------------------------------------------------------------------------------
+void NLatency::Reset(){
+    uint32_t primask = NPortLock();
+    for(uint32_t p=0L; p<__SYS_LATENCY_PATHS; p++) Clear(&totals[p], __SYS_LATENCY_ALL, p);
+    for(uint32_t s=0L; s<__SYS_LATENCY_SOURCES; s++) Clear(&sources[s], __SYS_LATENCY_ALL, __SYS_LATENCY_PATHS);
+    overflows = 0L;
+    NPortUnlock(primask);
+}
+
+//------------------------------------------------------------------------------
+void NLatency::Update(NLATENCYSTATS* Stats, uint32_t cycles){
+    uint32_t bucket = 0L;
+    if(cycles >= (1UL << (__SYS_LATENCY_SHIFT + 1))){
+        bucket = (31 - __CLZ(cycles)) - __SYS_LATENCY_SHIFT;
+        if(bucket >= __SYS_LATENCY_BUCKETS){ bucket = __SYS_LATENCY_BUCKETS - 1;}
+    }
+
+    //---------------------------------------
+    Stats->samples++;
+    Stats->buckets[bucket]++;
+    if(cycles < Stats->min){ Stats->min = cycles;}
+    if(cycles > Stats->max){ Stats->max = cycles;}
+}
+
+//------------------------------------------------------------------------------
+void NLatency::Record(uint32_t vector, uint32_t path, uint32_t stamp){
+    if((stamp == 0L)||(path >= __SYS_LATENCY_PATHS)){ return;}
+    uint32_t cycles = NCycles() - stamp;
+
+    //---------------------------------------
+    uint32_t primask = NPortLock();
+    Update(&totals[path], cycles);
+
+    // histogram of the pair, added on first use
+    NLATENCYSTATS* Stats = NULL;
+    for(uint32_t s=0L; s<__SYS_LATENCY_SOURCES; s++){
+        if(sources[s].path == __SYS_LATENCY_PATHS){
+            Stats = &sources[s];
+            Clear(Stats, vector, path);
+            break;
+        }
+        if((sources[s].vector == vector)&&(sources[s].path == path)){ Stats = &sources[s]; break;}
+    }
+    if(Stats != NULL){ Update(Stats, cycles);}
+    else { overflows++;}
+    NPortUnlock(primask);
+}
+
+//------------------------------------------------------------------------------
+bool NLatency::Get(uint32_t vector, uint32_t path, NLATENCYSTATS* Stats){
+    if(path >= __SYS_LATENCY_PATHS){ return(false);}
+
+    uint32_t primask = NPortLock();
+    bool result = false;
+    if(vector == __SYS_LATENCY_ALL){
+        *Stats = totals[path];
+        result = true;
+    } else {
+        for(uint32_t s=0L; s<__SYS_LATENCY_SOURCES; s++){
+            if((sources[s].vector == vector)&&(sources[s].path == path)){
+                *Stats = sources[s];
+                result = true;
+                break;
+            }
+        }
+    }
+    NPortUnlock(primask);
+    if(result && (Stats->samples == 0L)){ Stats->min = 0L;}
+    return(result);
+}
+
+//------------------------------------------------------------------------------
+bool NLatency::GetSource(uint32_t index, NLATENCYSTATS* Stats){
+    if(index >= __SYS_LATENCY_SOURCES){ return(false);}
+
+    uint32_t primask = NPortLock();
+    bool result = (sources[index].path < __SYS_LATENCY_PATHS);
+    if(result){ *Stats = sources[index];}
+    NPortUnlock(primask);
+    return(result);
+}
+
+#endif
+//==============================================================================
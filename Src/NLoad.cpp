@@ -0,0 +1,207 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+#ifdef __SYS_LOAD
+
+//------------------------------------------------------------------------------
+volatile uint32_t NLoad::depth = 0L;
+volatile uint32_t NLoad::idle = 0L;
+volatile uint32_t NLoad::woken = 0L;
+uint32_t NLoad::dispatching = 0L;
+uint32_t NLoad::isrMark = 0L;
+uint32_t NLoad::awakeMark = 0L;
+uint32_t NLoad::periodMark = 0L;
+uint32_t NLoad::dispatchMark = 0L;
+uint64_t NLoad::isrTotal = 0L;
+uint64_t NLoad::busyTotal = 0L;
+uint64_t NLoad::dispatchTotal = 0L;
+uint64_t NLoad::isrDispatch = 0L;
+uint64_t NLoad::isrStart = 0L;
+uint64_t NLoad::busyStart = 0L;
+uint64_t NLoad::dispatchStart = 0L;
+uint32_t NLoad::busyMax = 0L;
+uint32_t NLoad::wakeups = 0L;
+uint32_t NLoad::frequency = 1L;
+uint32_t NLoad::window = __SYS_LOAD_WINDOW;
+uint32_t NLoad::windowStart = 0L;
+uint32_t NLoad::windows = 0L;
+NLOADSTATS NLoad::last;
+
+//------------------------------------------------------------------------------
+static uint32_t Share(uint64_t part, uint64_t whole){
+    if(whole == 0L){ return(0L);}
+    uint64_t share = (part * __SYS_LOAD_SCALE) / whole;
+    return((share > __SYS_LOAD_SCALE)? __SYS_LOAD_SCALE : (uint32_t)share);
+}
+
+//------------------------------------------------------------------------------
+void NLoad::Initialize(uint32_t clock, uint32_t time){
+    depth = 0L;
+    idle = 0L;
+    woken = 0L;
+    dispatching = 0L;
+    isrTotal = busyTotal = dispatchTotal = 0L;
+    isrStart = busyStart = dispatchStart = 0L;
+    busyMax = wakeups = windows = 0L;
+    frequency = (clock > 0L)? clock : 1L;
+    windowStart = time;
+    last.window = last.load = last.isr = last.dispatch = 0L;
+    last.busy_max = last.wakeups = last.windows = 0L;
+
+    uint32_t now = NCycles();
+    awakeMark = periodMark = now;
+}
+
+//------------------------------------------------------------------------------
+void NLoad::SetFrequency(uint32_t clock){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Flush(NCycles());
+    frequency = (clock > 0L)? clock : 1L;
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+void NLoad::SetWindow(uint32_t ms){
+    window = (ms > 0L)? ms : 1L;
+}
+
+//------------------------------------------------------------------------------
+// an idle period ends: the next busy period starts
+void NLoad::Woken(uint32_t now){
+    awakeMark = now;
+    periodMark = now;
+    wakeups++;
+}
+
+//------------------------------------------------------------------------------
+// adds the open intervals up to "now" (interrupts masked, or the outermost handler)
+void NLoad::Flush(uint32_t now){
+    if(depth > 0L){
+        isrTotal += (uint32_t)(now - isrMark);
+        isrMark = now;
+    }
+    if((idle == 0L)||(depth > 0L)){
+        busyTotal += (uint32_t)(now - awakeMark);
+        awakeMark = now;
+        if((uint32_t)(now - periodMark) > busyMax){ busyMax = now - periodMark;}
+    }
+    if((dispatching > 0L)&&(idle == 0L)){
+        uint64_t interrupted = isrTotal - isrDispatch;
+        uint32_t elapsed = now - dispatchMark;
+        if(elapsed > interrupted){ dispatchTotal += elapsed - interrupted;}
+        dispatchMark = now;
+        isrDispatch = isrTotal;
+    }
+}
+
+//------------------------------------------------------------------------------
+void NLoad::Enter(){
+    // a nested handler restores "depth" before it returns
+    uint32_t nested = depth;
+    depth = nested + 1;
+    if(nested != 0L){ return;}
+    uint32_t now = NCycles();
+    isrMark = now;
+    if(idle != 0L){ Woken(now); woken = 1L;}
+}
+
+//------------------------------------------------------------------------------
+void NLoad::Leave(){
+    uint32_t nested = depth - 1;
+    depth = nested;
+    if(nested != 0L){ return;}
+    uint32_t now = NCycles();
+    isrTotal += (uint32_t)(now - isrMark);
+    if(idle != 0L){
+        // back to the idle main loop
+        busyTotal += (uint32_t)(now - awakeMark);
+        awakeMark = now;
+        if((uint32_t)(now - periodMark) > busyMax){ busyMax = now - periodMark;}
+    }
+}
+
+//------------------------------------------------------------------------------
+void NLoad::Idle(){
+    // still nothing to do after the handler: its busy period is over
+    if(idle != 0L){ woken = 0L; return;}
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Flush(NCycles());
+    idle = 1L;
+    woken = 0L;
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+void NLoad::Busy(){
+    if(idle == 0L){ return;}
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t now = NCycles();
+    idle = 0L;
+    // the handler that woke the core already started the period: it goes on
+    if(woken == 0L){ Woken(now);}
+    woken = 0L;
+    dispatchMark = now;
+    isrDispatch = isrTotal;
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+void NLoad::DispatchEnter(){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(dispatching++ == 0L){
+        dispatchMark = NCycles();
+        isrDispatch = isrTotal;
+    }
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+void NLoad::DispatchLeave(){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(dispatching == 1L){ Flush(NCycles());}
+    if(dispatching > 0L){ dispatching--;}
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+void NLoad::Update(uint32_t time){
+    uint32_t elapsed = time - windowStart;
+    if(elapsed < window){ return;}
+    Flush(NCycles());
+
+    //-----------------------------------------
+    uint64_t cycles = (uint64_t)elapsed * (frequency / 1000L);
+    last.window = elapsed;
+    last.load = Share(busyTotal - busyStart, cycles);
+    last.isr = Share(isrTotal - isrStart, cycles);
+    last.dispatch = Share(dispatchTotal - dispatchStart, cycles);
+    last.busy_max = (uint32_t)(((uint64_t)busyMax * 1000000ULL) / frequency);
+    last.wakeups = wakeups;
+    last.windows = ++windows;
+
+    //-----------------------------------------
+    busyStart = busyTotal;
+    isrStart = isrTotal;
+    dispatchStart = dispatchTotal;
+    busyMax = 0L;
+    wakeups = 0L;
+    windowStart = time;
+}
+
+//------------------------------------------------------------------------------
+bool NLoad::Get(NLOADSTATS* Stats){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *Stats = last;
+    __set_PRIMASK(primask);
+    return(Stats->windows > 0L);
+}
+
+#endif
+//==============================================================================
@@ -1,115 +1,513 @@
 //==============================================================================
 #include "System.h"
+#include "DRV_CPU.h"
 
 //------------------------------------------------------------------------------
 NMessagePipe::NMessagePipe(){
-    fila = new NFifo(sizeof(NMESSAGE), __SYS_STANDARD_MESSAGES);
-    filah = new NFifo(sizeof(NMESSAGE), __SYS_PRIORITY_MESSAGES);
+    for(uint32_t l=0L; l<__SYS_PRIORITY_LEVELS; l++) levels[l] = NULL;
 
     //---------------------------------------
-    objects_number = 0L; comp = NULL;
+    comp = NULL; dispatching = 0L;
+    deferred = NULL;
+    buffers = NULL;
+#ifdef __SYS_COROUTINES
+    tasks = NULL;
+#endif
+#ifdef __SYS_PROFILER
+    profiler = NULL;
+#endif
+#ifdef __SYS_LATENCY
+    latency = NULL;
+#endif
+    rounds = messages = starved = 0L;
+    for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++) sysZombies[w] = 0L;
+    for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++) sysBusy[w] = 0L;
 
     //---------------------------------------
-    for(int i=0L; i<__SYS_MAX_OBJECTS; i++) sysObjects[i] = 0L;
+    subscriptions_number = 0L;
+    for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++) sysListeners[w] = 0L;
+
+    //---------------------------------------
+    sysPeriodic[0].message = NM_TIMETICK;
+    sysPeriodic[1].message = NM_KEYSCAN;
+    sysPeriodic[2].message = NM_REPAINT;
+    for(uint32_t p=0L; p<__SYS_PERIODIC_MESSAGES; p++){
+        sysPeriodic[p].time = 0L;
+        sysPeriodic[p].merged = 0L;
+    }
+}
+
+//------------------------------------------------------------------------------
+NMessagePipe::~NMessagePipe(){}
+
+//------------------------------------------------------------------------------
+void NMessagePipe::AttachQueue(uint32_t level, NMessageRing* ring){
+    if(level < __SYS_PRIORITY_LEVELS){ levels[level] = ring;}
+}
+
+//------------------------------------------------------------------------------
+void NMessagePipe::SetBufferPool(NBufferPool* Pool){
+    buffers = Pool;
+    for(uint32_t l=0L; l<__SYS_PRIORITY_LEVELS; l++){
+        if(levels[l] != NULL){ levels[l]->SetBufferPool(Pool);}
+    }
+    if(deferred != NULL){ deferred->SetBufferPool(Pool);}
+}
+
+//------------------------------------------------------------------------------
+bool NMessagePipe::IsPending(){
+#ifdef __SYS_COROUTINES
+    if((tasks != NULL)&&(tasks->IsPending())){ return(true);}
+#endif
+    return(ready.Load() != 0L);
+}
+
+//------------------------------------------------------------------------------
+bool NMessagePipe::Insert(NMESSAGE* Msg){
+    if(Msg->message > __SYS_PRIORITY_BORDERLINE){ return(Insert(Msg, __SYS_QUEUE_PRIORITY));}
+    return(Insert(Msg, __SYS_QUEUE_STANDARD));
+}
+
+//------------------------------------------------------------------------------
+bool NMessagePipe::Insert(NMESSAGE* Msg, uint32_t priority, uint32_t flags){
+    if(priority > __SYS_QUEUE_PRIORITY){ priority = __SYS_QUEUE_PRIORITY;}
+    if(!levels[priority]->Put(Msg, __SYS_COMPONENT_NONE, flags)){
+        NTRACE(__SYS_TRACE_INSERT, priority, 0, Msg->message);
+        NRECORD(__SYS_RECORD_INSERT, priority, 0L, Msg, false, dispatching != 0L);
+        return(false);
+    }
+    ready.FetchOr(1UL << priority);
+    NTRACE(__SYS_TRACE_INSERT, priority, __SYS_TRACE_ACCEPTED, Msg->message);
+    NRECORD(__SYS_RECORD_INSERT, priority, 0L, Msg, true, dispatching != 0L);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+bool NMessagePipe::Send(NMESSAGE* Msg, HANDLE destination, uint32_t priority, uint32_t flags){
+    uint32_t id = registry.Identify(destination);
+    if(id == __SYS_COMPONENT_NONE){
+        ReleaseBuffer(Msg, flags);
+        return(false);
+    }
+
+    //-----------------------------------------
+    if(priority > __SYS_QUEUE_PRIORITY){ priority = __SYS_QUEUE_PRIORITY;}
+    if(!levels[priority]->Put(Msg, id, flags)){
+        NTRACE(__SYS_TRACE_INSERT, priority, __SYS_TRACE_UNICAST, Msg->message);
+        NRECORD(__SYS_RECORD_SEND, priority, id, Msg, false, dispatching != 0L);
+        return(false);
+    }
+    ready.FetchOr(1UL << priority);
+    NTRACE(__SYS_TRACE_INSERT, priority, __SYS_TRACE_ACCEPTED | __SYS_TRACE_UNICAST, Msg->message);
+    NRECORD(__SYS_RECORD_SEND, priority, id, Msg, true, dispatching != 0L);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+NMessageRing* NMessagePipe::GetQueue(uint32_t queue){
+    if(queue < __SYS_PRIORITY_LEVELS){ return(levels[queue]);}
+    if(queue == __SYS_QUEUE_DEFERRED){ return(deferred);}
+    return(NULL);
+}
+
+//------------------------------------------------------------------------------
+NMessagePipe::PERIODIC* NMessagePipe::FindPeriodic(uint32_t message){
+    for(uint32_t p=0L; p<__SYS_PERIODIC_MESSAGES; p++){
+        if(sysPeriodic[p].message == message){ return(&sysPeriodic[p]);}
+    }
+    return(NULL);
 }
 
 //------------------------------------------------------------------------------
-NMessagePipe::~NMessagePipe(){
-    delete(fila);
-    delete(filah);
+void NMessagePipe::InsertPeriodic(NMESSAGE* Msg, uint32_t periods){
+    PERIODIC* entry = FindPeriodic(Msg->message);
+    if(entry == NULL){ Insert(Msg); return;}
+
+    //-----------------------------------------
+    entry->count.FetchAdd(periods);
+    entry->time = Msg->data2;
+    if(entry->pending.Exchange(1) != 0L){ entry->merged += periods; return;}
+    entry->merged += periods - 1;
+
+    //-----------------------------------------
+    // discarded: the elapsed periods are delivered with the next instance
+    if(!Insert(Msg)){ entry->pending.Store(0L);}
+}
+
+//------------------------------------------------------------------------------
+// fills in the payload of a periodic message just extracted from the queue
+// return: false if the instance is stale (its periods were already delivered)
+bool NMessagePipe::Collect(NMESSAGE* Msg){
+    PERIODIC* entry = FindPeriodic(Msg->message);
+    if((entry == NULL)||(entry->pending.Load() == 0L)){ return(true);}
+
+    //-----------------------------------------
+    // release the slot first: a period elapsing from now on queues a new instance
+    entry->pending.Store(0L);
+    uint32_t elapsed = entry->count.Exchange(0L);
+    if(elapsed == 0L){ return(false);}
+    Msg->data1 = elapsed;
+    Msg->data2 = entry->time;
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NMessagePipe::GetMergedCount(uint32_t message){
+    PERIODIC* entry = FindPeriodic(message);
+    return((entry != NULL)? entry->merged : 0L);
+}
+
+//------------------------------------------------------------------------------
+// index of the lowest bit set (word must not be zero)
+static inline uint32_t LowestBit(uint32_t word){
+    return(__CLZ(__RBIT(word)));
+}
+
+//------------------------------------------------------------------------------
+// releases the data block reference carried by a message (if any)
+void NMessagePipe::ReleaseBuffer(const NMESSAGE* Msg, uint32_t flags){
+    if((buffers != NULL)&&((flags & __SYS_MESSAGE_BUFFER) != 0L)){ buffers->Release(Msg->tag);}
 }
 
 //------------------------------------------------------------------------------
-void NMessagePipe::Insert(NMESSAGE* Msg){
-    if(Msg->message > __SYS_PRIORITY_BORDERLINE) filah->Put((uint8_t*)Msg, sizeof(NMESSAGE));
-    else fila->Put((uint8_t*)Msg, sizeof(NMESSAGE));
+// notifies the component of "slot" with a copy of "Msg"
+// return: false if the component extinguished the message
+bool NMessagePipe::Deliver(uint32_t slot, const NMESSAGE* Msg, uint32_t flags, bool extinguish){
+    NMESSAGE BkMessage = *Msg;
+    bool buffer = (buffers != NULL)&&((flags & __SYS_MESSAGE_BUFFER) != 0L);
+
+    //-----------------------------------------
+    // component waiting in a cooperative delay: delivered when it is resumed
+    if(IsBusy(slot)){
+        if(buffer){ buffers->Retain(Msg->tag);}
+        // a full ring drops the message (counted, and its reference released)
+        if(!deferred->Put(Msg, registry.Identify(registry.Object(slot)), flags)){
+            NTRACE(__SYS_TRACE_INSERT, __SYS_QUEUE_DEFERRED, __SYS_TRACE_UNICAST, Msg->message);
+            return(true);
+        }
+        NTRACE(__SYS_TRACE_INSERT, __SYS_QUEUE_DEFERRED, __SYS_TRACE_ACCEPTED | __SYS_TRACE_UNICAST, Msg->message);
+        return(true);
+    }
+
+    //-----------------------------------------
+    NComponent* caller = comp;
+    comp = (NComponent*)registry.Object(slot);
+    NPROFILE_START(t0);
+    comp->Notify(&BkMessage);
+    NPROFILE_NOTIFY(profiler, t0, registry.Slot(slot), Msg->message);
+    comp = caller;
+
+    if(BkMessage.message != NM_NULL){
+        if(extinguish && (BkMessage.message == NM_EXTINGUISH)){ return(false);}
+        // a reply forwarding the data block needs its own reference
+        if(buffer && (BkMessage.tag == Msg->tag)){
+            buffers->Retain(BkMessage.tag);
+            Insert(&BkMessage, (BkMessage.message > __SYS_PRIORITY_BORDERLINE)? __SYS_QUEUE_PRIORITY : __SYS_QUEUE_STANDARD, flags);
+        } else Insert(&BkMessage);
+    }
+    return(true);
 }
 
 //------------------------------------------------------------------------------
-uint32_t NMessagePipe::Dispatch(){
-    uint32_t index, n=0L;
+// notifies the components interested in "Msg" (listeners + subscribers)
+void NMessagePipe::Broadcast(const NMESSAGE* Msg, uint32_t flags, bool extinguish){
+    uint32_t targets[__SYS_OBJECT_WORDS];
+    SUBSCRIPTION* entry = FindSubscription(Msg->message);
+
+    //-----------------------------------------
+    for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++){
+        targets[w] = sysListeners[w];
+        if(entry != NULL){ targets[w] |= entry->mask[w];}
+    }
 
     //-----------------------------------------
-    while(filah->Counter() > 0){
-        filah->Get((uint8_t*)&Message);
-        for(index=0L; index< objects_number; index++){
-            BkMessage = Message;
-            comp = (NComponent*)(sysObjects[index]);
-            comp->Notify(&BkMessage);
-            if(BkMessage.message != NM_NULL){
-                Insert(&BkMessage);
+    // delivered in inclusion order; the slots excluded by a Notify are released
+    // after the message, never reused here. Usually the slot order is that order.
+    if(registry.InOrder()){
+        for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++){
+            while(targets[w] != 0L){
+                uint32_t bit = LowestBit(targets[w]);
+                targets[w] &= ~(1UL << bit);
+                // skip components excluded by a previous Notify of this broadcast
+                if((registry.live[w] & (1UL << bit)) == 0L){ continue;}
+                if(!Deliver((w << 5) + bit, Msg, flags, extinguish)){ return;}
             }
         }
-        n++;
+        return;
     }
 
     //-----------------------------------------
+    // slots reused out of order: the interested slots, then their order
+    uint16_t slots[__SYS_MAX_OBJECTS];
+    uint32_t count = 0L;
+    for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++){
+        uint32_t bits = targets[w] & registry.live[w];
+        while(bits != 0L){
+            uint32_t bit = LowestBit(bits);
+            bits &= ~(1UL << bit);
+            slots[count++] = (uint16_t)((w << 5) + bit);
+        }
+    }
 
-    while(fila->Counter()>0){
-        fila->Get((uint8_t*)&Message);
-        for(index=0L; index<objects_number; index++){
-            BkMessage = Message;
-            comp = (NComponent*)(sysObjects[index]);
-            comp->Notify(&BkMessage);
-            if(BkMessage.message != NM_NULL){
-                if(BkMessage.message != NM_EXTINGUISH){
-                    Insert(&BkMessage);
-                } else index = objects_number;
+    //-----------------------------------------
+    // most components interested: the inclusion list
+    if((count * 2) >= registry.Counter()){
+        uint32_t slot = registry.Oldest();
+        while(slot != __SYS_SLOT_NONE){
+            if(registry.IsLive(slot) && ((targets[slot >> 5] & (1UL << (slot & 31))) != 0L)){
+                if(!Deliver(slot, Msg, flags, extinguish)){ return;}
             }
+            slot = registry.Newer(slot);
         }
+        return;
+    }
+
+    //-----------------------------------------
+    // a few subscribers: their slots sorted by inclusion rank
+    for(uint32_t i=1L; i<count; i++){
+        uint16_t slot = slots[i];
+        uint32_t rank = registry.Rank(slot);
+        uint32_t j = i;
+        while((j > 0L)&&(registry.Rank(slots[j - 1]) > rank)){ slots[j] = slots[j - 1]; j--;}
+        slots[j] = slot;
+    }
+    for(uint32_t i=0L; i<count; i++){
+        // skip components excluded by a previous Notify of this broadcast
+        if(!registry.IsLive(slots[i])){ continue;}
+        if(!Deliver(slots[i], Msg, flags, extinguish)){ return;}
+    }
+}
+
+//------------------------------------------------------------------------------
+// delivers the deferred messages of the components no longer busy
+uint32_t NMessagePipe::Redeliver(){
+    NMESSAGE Msg;
+    uint32_t id, flags, n = 0L;
+    uint32_t count = deferred->Counter();
+
+    //-----------------------------------------
+    while((count-- > 0L)&&(deferred->Get(&Msg, &id, NULL, &flags))){
+        uint32_t slot = registry.Resolve(id);
+        if((slot != __SYS_INDEX_INVALID)&&(IsBusy(slot))){
+            // still waiting: back to the end of the line (a drop is counted by the ring)
+            if(!deferred->Put(&Msg, id, flags)){
+                NTRACE(__SYS_TRACE_INSERT, __SYS_QUEUE_DEFERRED, __SYS_TRACE_UNICAST, Msg.message);
+            }
+            continue;
+        }
+
+        //-------------------------------------
+        dispatching++;
+        if(slot != __SYS_INDEX_INVALID){ Deliver(slot, &Msg, flags, false);}
+        dispatching--;
+        ReleaseBuffer(&Msg, flags);
+        ReleaseZombies();
+        n++;
+    }
+    return(n);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NMessagePipe::Dispatch(uint32_t budget, uint32_t time_budget){
+    NMESSAGE Msg;
+    uint32_t pending, destination, stamp, flags, n=0L;
+    uint32_t t0 = (time_budget > 0L)? SYS->Microseconds() : 0L;
+    rounds++;
+
+    //-----------------------------------------
+    if(deferred->Counter() != 0L){ n += Redeliver();}
+#ifdef __SYS_COROUTINES
+    // tasks whose timeout expired
+    if((tasks != NULL)&&(tasks->IsPending())){ tasks->Poll();}
+#endif
+
+    //-----------------------------------------
+    // one message at a time, always from the highest non-empty level
+    while((pending = ready.Load()) != 0L){
+        //-------------------------------------
+        // budget exhausted: the remaining messages carry over to the next round
+        if(((budget > 0L)&&(n >= budget))||
+           ((time_budget > 0L)&&((SYS->Microseconds() - t0) >= time_budget))){
+            starved++;
+            break;
+        }
+
+        //-------------------------------------
+        uint32_t level = 31 - __CLZ(pending);
+        uint32_t bit = (1UL << level);
+
+        if(!levels[level]->Get(&Msg, &destination, &stamp, &flags)){
+            // level drained: clear its bit, unless a producer refilled it meanwhile
+            ready.FetchAnd(~bit);
+            if(levels[level]->Counter() != 0L){ ready.FetchOr(bit);}
+            continue;
+        }
+        if(!Collect(&Msg)){ continue;}
+#ifdef __SYS_LATENCY
+        // routed by System::Dispatch: data1 is the NV_ID
+        if((latency != NULL)&&(stamp != 0L)){ latency->Record(Msg.data1, __SYS_PATH_QUEUED, stamp);}
+#endif
+
+        // NM_EXTINGUISH stops the broadcast, except on the highest level
+        NTRACE(__SYS_TRACE_DISPATCH, level, (destination != __SYS_COMPONENT_NONE), Msg.message);
+        dispatching++;
+        if(destination == __SYS_COMPONENT_NONE){
+            Broadcast(&Msg, flags, level < __SYS_QUEUE_PRIORITY);
+        } else {
+            // unicast: dropped if the destination was excluded meanwhile
+            uint32_t slot = registry.Resolve(destination);
+            if(slot != __SYS_INDEX_INVALID){ Deliver(slot, &Msg, flags, false);}
+        }
+#ifdef __SYS_COROUTINES
+        if(tasks != NULL){ tasks->Match(&Msg);}
+#endif
+        dispatching--;
+        NTRACE(__SYS_TRACE_DISPATCHED, level, 0, Msg.message);
+        ReleaseBuffer(&Msg, flags);
+        ReleaseZombies();
         n++;
+
+        // a cooperative delay may have ended during this message
+        if(deferred->Counter() != 0L){ n += Redeliver();}
     }
+    messages += n;
     return(n);
     //-------------------------------------
 }
 
+//------------------------------------------------------------------------------
+uint32_t NMessagePipe::Suspend(){
+    if(comp == NULL){ return(__SYS_INDEX_INVALID);}
+    uint32_t slot = registry.Find(comp);
+    if(slot != __SYS_INDEX_INVALID){ sysBusy[slot >> 5] |= (1UL << (slot & 31));}
+    return(slot);
+}
+
+//------------------------------------------------------------------------------
+void NMessagePipe::Resume(uint32_t slot){
+    if(slot < __SYS_MAX_OBJECTS){ sysBusy[slot >> 5] &= ~(1UL << (slot & 31));}
+}
+
+//------------------------------------------------------------------------------
+void NMessagePipe::GetDispatchStats(NDISPATCHSTATS* Stats){
+    Stats->rounds = rounds;
+    Stats->messages = messages;
+    Stats->starved = starved;
+}
+
 //------------------------------------------------------------------------------
 bool NMessagePipe::IncludeComponent(HANDLE newcomp){
-  	bool result = false;
-    if(newcomp != NULL){
-        //------------------------------------
-	  	if(objects_number<__SYS_MAX_OBJECTS){
-        	sysObjects[objects_number++] = newcomp; result = true;
-		}
-        //------------------------------------
-    }
-    return(result);
+    uint32_t slot = registry.Include(newcomp);
+    if(slot == __SYS_INDEX_INVALID){ return(false);}
+
+    //------------------------------------
+    // new components receive every message until they subscribe
+    sysListeners[slot >> 5] |= (1UL << (slot & 31));
+    return(true);
 }
 
 //------------------------------------------------------------------------------
 uint32_t NMessagePipe::FindComponent(HANDLE fcomp){
-  	uint32_t result = __SYS_INDEX_INVALID; uint32_t c= 0;
-    if(fcomp != NULL){
-        //------------------------------------
-	  	while((result == __SYS_INDEX_INVALID)&&(c < objects_number)){
-        	if(sysObjects[c] == fcomp){ result = c;} else { c++;}
-		}
-        //------------------------------------
-    }
-    return(result);
+    return(registry.Find(fcomp));
 }
 
 //------------------------------------------------------------------------------
 bool NMessagePipe::ExcludeComponent(HANDLE xcomp){
-  	bool result = false;
-	uint32_t index = FindComponent(xcomp);
-
-   	if(index < objects_number){
-        //------------------------------------
-		if(objects_number > 1){
-			objects_number--;
-			if(index == objects_number){ sysObjects[index]=NULL;}
-			else{
-				for(uint32_t c = index; c < objects_number; c++){
-					sysObjects[c] = sysObjects[c+1];
-				}
-				sysObjects[objects_number]=NULL;
-			}
-		} else { sysObjects[0]=NULL; objects_number--;}
-		result = true;
-        //------------------------------------
-    }
-    return(result);
+    uint32_t slot = registry.Detach(xcomp);
+    if(slot == __SYS_INDEX_INVALID){ return(false);}
+
+    //------------------------------------
+    // clear the slot from the subscription index
+    uint32_t bit = (1UL << (slot & 31));
+    sysListeners[slot >> 5] &= ~bit;
+    uint32_t s = subscriptions_number;
+    while(s > 0){
+        SUBSCRIPTION* entry = &sysSubscriptions[--s];
+        entry->mask[slot >> 5] &= ~bit;
+        RemoveSubscription(entry);
+    }
+
+    //------------------------------------
+    // while a message is being dispatched, the slot is recycled afterwards
+    if(dispatching > 0L){ sysZombies[slot >> 5] |= bit;}
+    else { registry.Release(slot);}
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+// recycles the slots of the components excluded during the last message
+void NMessagePipe::ReleaseZombies(){
+    if(dispatching > 0L){ return;}
+    for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++){
+        while(sysZombies[w] != 0L){
+            uint32_t bit = LowestBit(sysZombies[w]);
+            sysZombies[w] &= ~(1UL << bit);
+            registry.Release((w << 5) + bit);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+uint32_t NMessagePipe::GetComponentId(HANDLE icomp){
+    return(registry.Identify(icomp));
+}
+
+//------------------------------------------------------------------------------
+HANDLE NMessagePipe::GetComponent(uint32_t id){
+    uint32_t slot = registry.Resolve(id);
+    if(slot == __SYS_INDEX_INVALID){ return(NULL);}
+    return(registry.Object(slot));
+}
+
+//------------------------------------------------------------------------------
+NMessagePipe::SUBSCRIPTION* NMessagePipe::FindSubscription(uint32_t message){
+    for(uint32_t s=0L; s<subscriptions_number; s++){
+        if(sysSubscriptions[s].message == message){ return(&sysSubscriptions[s]);}
+    }
+    return(NULL);
+}
+
+//------------------------------------------------------------------------------
+// discards an index entry, if no component is subscribed to it anymore
+void NMessagePipe::RemoveSubscription(SUBSCRIPTION* entry){
+    for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++){
+        if(entry->mask[w] != 0L){ return;}
+    }
+    *entry = sysSubscriptions[--subscriptions_number];
+}
+
+//------------------------------------------------------------------------------
+bool NMessagePipe::Subscribe(HANDLE scomp, uint32_t message){
+    uint32_t index = FindComponent(scomp);
+    if((index == __SYS_INDEX_INVALID)||(message == NM_NULL)){ return(false);}
+
+    //------------------------------------
+    SUBSCRIPTION* entry = FindSubscription(message);
+    if(entry == NULL){
+        if(subscriptions_number >= __SYS_MAX_SUBSCRIPTIONS){ return(false);}
+        entry = &sysSubscriptions[subscriptions_number++];
+        entry->message = message;
+        for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++) entry->mask[w] = 0L;
+    }
+
+    //------------------------------------
+    entry->mask[index >> 5] |= (1UL << (index & 31));
+    sysListeners[index >> 5] &= ~(1UL << (index & 31));
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+bool NMessagePipe::Unsubscribe(HANDLE ucomp, uint32_t message){
+    uint32_t index = FindComponent(ucomp);
+    SUBSCRIPTION* entry = FindSubscription(message);
+    if((index == __SYS_INDEX_INVALID)||(entry == NULL)){ return(false);}
+
+    //------------------------------------
+    uint32_t bit = (1UL << (index & 31));
+    if((entry->mask[index >> 5] & bit) == 0L){ return(false);}
+    entry->mask[index >> 5] &= ~bit;
+    RemoveSubscription(entry);
+    return(true);
 }
 
 //==============================================================================
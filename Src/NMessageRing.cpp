@@ -0,0 +1,242 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+//------------------------------------------------------------------------------
+NMessageReserve::NMessageReserve(BLOCK* storage, uint32_t size){
+    blocks = storage;
+    free_blocks.Store((size < 32)? ((1UL << size) - 1) : 0xFFFFFFFF);
+    ready_blocks.Store(0L);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NMessageReserve::Claim(){
+    uint32_t available = free_blocks.Load();
+    while(available != 0L){
+        uint32_t bit = __CLZ(__RBIT(available));
+        if(free_blocks.CompareExchange(available, available & ~(1UL << bit))){ return(bit);}
+    }
+    return(__SYS_INDEX_INVALID);
+}
+
+//------------------------------------------------------------------------------
+void NMessageReserve::Publish(uint32_t block, const void* owner, uint32_t ticket, const NMESSAGE* Msg, uint32_t target, uint32_t flags, uint32_t stamp){
+    blocks[block].owner = owner;
+    blocks[block].ticket = ticket;
+    blocks[block].target = target;
+    blocks[block].flags = flags;
+#ifdef __SYS_LATENCY
+    blocks[block].stamp = stamp;
+#else
+    (void)stamp;
+#endif
+    blocks[block].message = *Msg;
+    ready_blocks.FetchOr(1UL << block);
+}
+
+//------------------------------------------------------------------------------
+bool NMessageReserve::Take(const void* owner, uint32_t ticket, NMESSAGE* Msg, uint32_t* target, uint32_t* flags, uint32_t* stamp){
+    uint32_t ready = ready_blocks.Load();
+    while(ready != 0L){
+        uint32_t bit = __CLZ(__RBIT(ready));
+        ready &= ~(1UL << bit);
+        if((blocks[bit].owner == owner)&&(blocks[bit].ticket == ticket)){
+            *Msg = blocks[bit].message;
+            *target = blocks[bit].target;
+            *flags = blocks[bit].flags;
+#ifdef __SYS_LATENCY
+            *stamp = blocks[bit].stamp;
+#else
+            *stamp = 0L;
+#endif
+            ready_blocks.FetchAnd(~(1UL << bit));
+            free_blocks.FetchOr(1UL << bit);
+            return(true);
+        }
+    }
+    return(false);
+}
+
+//------------------------------------------------------------------------------
+NMessageRing::NMessageRing(CELL* storage, uint32_t capacity){
+    cells = storage;
+    mask = capacity - 1;
+    policy = nDropNewest;
+    reserve = NULL;
+    spill_tail = 0L;
+    buffers = NULL;
+}
+
+//------------------------------------------------------------------------------
+void NMessageRing::Reset(){
+    head.Store(0L);
+    tail.Store(0L);
+    for(uint32_t i=0L; i<=mask; i++) cells[i].sequence.Store(i);
+}
+
+//------------------------------------------------------------------------------
+// inserts a message in the ring cells
+bool NMessageRing::Push(const NMESSAGE* Msg, uint32_t target, uint32_t flags, uint32_t stamp){
+    CELL* cell;
+    uint32_t position = head.Load();
+
+    //---------------------------------------
+    // reserve a cell: retried only if a nested producer got there first
+    while(1){
+        cell = &cells[position & mask];
+        int32_t delta = (int32_t)(cell->sequence.Load() - position);
+        if(delta == 0){
+            if(head.CompareExchange(position, position + 1)){ break;}
+        } else if(delta < 0){
+            return(false);
+        } else {
+            position = head.Load();
+        }
+    }
+
+    //---------------------------------------
+    // publish the message to the consumer
+    cell->message = *Msg;
+    cell->target = target;
+    cell->flags = flags;
+#ifdef __SYS_LATENCY
+    cell->stamp = stamp;
+#else
+    (void)stamp;
+#endif
+    cell->sequence.Store(position + 1);
+
+    //---------------------------------------
+    // occupancy high-watermark
+    uint32_t used = position + 1 - tail.Load();
+    uint32_t peak = watermark.Load();
+    while((used > peak)&&(!watermark.CompareExchange(peak, used))){}
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+// extracts the oldest message from the ring cells
+// (used by the consumer and by producers with the "drop oldest" policy)
+bool NMessageRing::Pop(NMESSAGE* Msg, uint32_t* target, uint32_t* flags, uint32_t* stamp){
+    CELL* cell;
+    uint32_t position = tail.Load();
+
+    //---------------------------------------
+    while(1){
+        cell = &cells[position & mask];
+        int32_t delta = (int32_t)(cell->sequence.Load() - (position + 1));
+        if(delta == 0){
+            if(tail.CompareExchange(position, position + 1)){ break;}
+        } else if(delta < 0){
+            return(false);
+        } else {
+            position = tail.Load();
+        }
+    }
+
+    //---------------------------------------
+    // release the cell for the next round of producers
+    *Msg = cell->message;
+    *target = cell->target;
+    *flags = cell->flags;
+#ifdef __SYS_LATENCY
+    *stamp = cell->stamp;
+#else
+    *stamp = 0L;
+#endif
+    cell->sequence.Store(position + mask + 1);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+// moves a message to the reserve pool, numbered in spill order
+bool NMessageRing::Spill(const NMESSAGE* Msg, uint32_t target, uint32_t flags, uint32_t stamp){
+    uint32_t block = reserve->Claim();
+    if(block == __SYS_INDEX_INVALID){ return(false);}
+    reserve->Publish(block, this, spill_head.FetchAdd(1), Msg, target, flags, stamp);
+    spills.FetchAdd(1);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+// a discarded message gives back its buffer reference (if it carries one)
+void NMessageRing::Discard(const NMESSAGE* Msg, uint32_t flags){
+    drops.FetchAdd(1);
+    if((buffers != NULL)&&((flags & __SYS_MESSAGE_BUFFER) != 0L)){ buffers->Release(Msg->tag);}
+}
+
+//------------------------------------------------------------------------------
+bool NMessageRing::Put(const NMESSAGE* Msg, uint32_t target, uint32_t flags){
+    bool result;
+    uint32_t stamp = NLATENCY_ARMED();
+
+    //---------------------------------------
+    // while spilled messages are pending, keep spilling to preserve the order
+    if((policy == nSpillReserve)&&(spill_head.Load() != spill_tail)){
+        result = Spill(Msg, target, flags, stamp);
+    } else {
+        result = Push(Msg, target, flags, stamp);
+        if(!result){
+            switch(policy){
+                case nDropOldest:{
+                    // a single attempt: never spin inside an ISR
+                    NMESSAGE Oldest; uint32_t victim, victim_flags, victim_stamp;
+                    if(Pop(&Oldest, &victim, &victim_flags, &victim_stamp)){ Discard(&Oldest, victim_flags);}
+                    result = Push(Msg, target, flags, stamp);
+                } break;
+                case nSpillReserve: result = Spill(Msg, target, flags, stamp); break;
+                default: break;
+            }
+        }
+    }
+
+    //---------------------------------------
+    if(result){ inserts.FetchAdd(1);}
+    else { Discard(Msg, flags);}
+    return(result);
+}
+
+//------------------------------------------------------------------------------
+bool NMessageRing::Get(NMESSAGE* Msg, uint32_t* target, uint32_t* stamp, uint32_t* flags){
+    uint32_t destination, entry, kind;
+    if(target == NULL){ target = &destination;}
+    if(stamp == NULL){ stamp = &entry;}
+    if(flags == NULL){ flags = &kind;}
+    if(Pop(Msg, target, flags, stamp)){ return(true);}
+
+    //---------------------------------------
+    // ring empty: spilled messages come next
+    if((reserve != NULL)&&(spill_head.Load() != spill_tail)){
+        if(reserve->Take(this, spill_tail, Msg, target, flags, stamp)){ spill_tail++; return(true);}
+    }
+    return(false);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NMessageRing::Counter(){
+    return((head.Load() - tail.Load()) + (spill_head.Load() - spill_tail));
+}
+
+//------------------------------------------------------------------------------
+uint32_t NMessageRing::Capacity(){
+    return(mask + 1);
+}
+
+//------------------------------------------------------------------------------
+bool NMessageRing::SetOverflow(NOVERFLOW Policy, NMessageReserve* Reserve){
+    if((Policy == nSpillReserve)&&(Reserve == NULL)){ return(false);}
+    if(Reserve != NULL){ reserve = Reserve;}
+    policy = Policy;
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+void NMessageRing::GetStats(NQUEUESTATS* Stats){
+    Stats->capacity = mask + 1;
+    Stats->inserts = inserts.Load();
+    Stats->drops = drops.Load();
+    Stats->spills = spills.Load();
+    Stats->watermark = watermark.Load();
+}
+
+//==============================================================================
@@ -0,0 +1,173 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+#ifdef __SYS_POWER
+
+//------------------------------------------------------------------------------
+volatile uint32_t NPower::locks[nPowerModes];
+NPOWERMODE NPower::deepest = __SYS_POWER_DEEPEST;
+uint32_t NPower::latencyMax = 0L;
+bool NPower::wakeupTimer = true;
+uint32_t NPower::wakeup[nPowerModes] = { 0L, __SYS_POWER_SLEEP_WAKEUP, __SYS_POWER_STOP_WAKEUP, __SYS_POWER_STANDBY_WAKEUP};
+uint32_t NPower::resume[nPowerModes];
+uint32_t NPower::entries[nPowerModes];
+uint32_t NPower::residency[nPowerModes] = { 0L, 0L, __SYS_POWER_STOP_RESIDENCY, __SYS_POWER_STANDBY_RESIDENCY};
+uint32_t NPower::frequency = __SYS_POWER_RESUME_CLOCK;
+uint32_t NPower::resumeStamp;
+uint32_t NPower::clockStamp;
+bool NPower::resuming = false;
+bool NPower::clockRestored = false;
+
+//------------------------------------------------------------------------------
+void NPower::Initialize(uint32_t clock){
+    for(uint32_t m=0L; m<nPowerModes; m++){
+        resume[m] = 0L;
+        entries[m] = 0L;
+    }
+    frequency = (clock > 0L)? clock : 1L;
+    wakeupTimer = true;
+    resuming = clockRestored = false;
+}
+
+//------------------------------------------------------------------------------
+void NPower::SetPolicy(NPOWERMODE mode, uint32_t latency){
+    deepest = (mode < nPowerModes)? mode : __SYS_POWER_DEEPEST;
+    latencyMax = latency;
+}
+
+//------------------------------------------------------------------------------
+void NPower::Lock(NPOWERMODE mode){
+    if(mode >= nPowerModes){ return;}
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    locks[mode] = locks[mode] + 1L;
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+void NPower::Unlock(NPOWERMODE mode){
+    if(mode >= nPowerModes){ return;}
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t n = locks[mode];
+    if(n > 0L){ locks[mode] = n - 1L;}
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NPower::Latency(uint32_t mode){
+    return(wakeup[mode] + resume[mode]);
+}
+
+//------------------------------------------------------------------------------
+// the mode meets the latency policy and pays off before the next deadline
+// (Standby needs a deadline: it wakes up only on WKUP, the RTC or the IWDG)
+bool NPower::Fits(uint32_t mode, uint32_t ticks){
+    uint32_t latency = Latency(mode);
+    if((latencyMax > 0L)&&(latency > latencyMax)){ return(false);}
+    if(ticks == __SYS_POWER_FOREVER){ return(mode != nPowerStandby);}
+    if(!wakeupTimer){ return(false);}
+
+    // the wake-up timer is armed for the ticks before the deadline tick
+    uint32_t late = (latency + 999L) / 1000L;
+    return(ticks > (residency[mode] + late + 1L));
+}
+
+//------------------------------------------------------------------------------
+NPOWERMODE NPower::Select(uint32_t ticks){
+    uint32_t mode = deepest;
+    for(uint32_t m=0L; m<mode; m++){
+        if(locks[m] > 0L){ mode = m; break;}
+    }
+    while((mode > nPowerSleep)&&!Fits(mode, ticks)){ mode--;}
+    return((NPOWERMODE)mode);
+}
+
+//------------------------------------------------------------------------------
+void NPower::NoWakeupTimer(){
+    wakeupTimer = false;
+}
+
+//------------------------------------------------------------------------------
+// core clock after the resume (the cycle counter counts nanoseconds on the host port)
+uint32_t NPower::CoreClock(){
+#ifdef EDROS_HOST
+    return(frequency);
+#else
+    return((SystemCoreClock > 0L)? SystemCoreClock : frequency);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void NPower::Resuming(){
+    clockRestored = false;
+    resuming = true;
+    resumeStamp = NCycles();
+}
+
+//------------------------------------------------------------------------------
+void NPower::ClockRestored(){
+    if(!resuming){ return;}
+    clockStamp = NCycles();
+    clockRestored = true;
+}
+
+//------------------------------------------------------------------------------
+// the cycles before the clock restart count at the resume clock, the others at the core clock
+void NPower::Resumed(NPOWERMODE mode){
+    entries[mode]++;
+    if(!resuming){ return;}
+    uint32_t now = NCycles();
+    uint32_t restart = clockRestored? clockStamp : resumeStamp;
+    uint32_t clock = CoreClock();
+    uint64_t ps = (uint64_t)(restart - resumeStamp) * (1000000000000ULL / frequency);
+    ps += (uint64_t)(now - restart) * (1000000000000ULL / clock);
+    uint32_t us = (uint32_t)((ps + 999999ULL) / 1000000ULL);
+    if(us > resume[mode]){ resume[mode] = us;}
+    resuming = clockRestored = false;
+}
+
+//------------------------------------------------------------------------------
+bool NPower::Get(NPOWERMODE mode, NPOWERSTATS* Stats){
+    if(mode >= nPowerModes){ return(false);}
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Stats->entries = entries[mode];
+    Stats->latency = Latency(mode);
+    Stats->resume = resume[mode];
+    Stats->locks = locks[mode];
+    __set_PRIMASK(primask);
+    return(true);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+void NPowerClockRestored(){
+#ifdef __SYS_POWER
+    NPower::ClockRestored();
+#endif
+}
+
+//------------------------------------------------------------------------------
+void NPowerConstraint::Acquire(){
+#ifdef __SYS_POWER
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(!held){ held = true; NPower::Lock(mode);}
+    __set_PRIMASK(primask);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void NPowerConstraint::Release(){
+#ifdef __SYS_POWER
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(held){ held = false; NPower::Unlock(mode);}
+    __set_PRIMASK(primask);
+#endif
+}
+
+//==============================================================================
@@ -0,0 +1,120 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+#ifdef __SYS_PROFILER
+
+//------------------------------------------------------------------------------
+static_assert((__SYS_PROFILE_MESSAGES & (__SYS_PROFILE_MESSAGES - 1)) == 0, "NProfiler: table size must be a power of two");
+
+//------------------------------------------------------------------------------
+NProfiler::NProfiler(){
+    Reset();
+}
+
+//------------------------------------------------------------------------------
+void NProfiler::Reset(){
+    uint32_t primask = NPortLock();
+    RECORD empty = { __SYS_INDEX_INVALID, 0L, 0xFFFFFFFF, 0L, 0L};
+    for(uint32_t s=0L; s<__SYS_MAX_OBJECTS; s++){
+        notifications[s] = empty;
+        callbacks[s] = empty;
+    }
+    for(uint32_t m=0L; m<__SYS_PROFILE_MESSAGES; m++) messages[m] = empty;
+    overflows = 0L;
+    NPortUnlock(primask);
+}
+
+//------------------------------------------------------------------------------
+void NProfiler::Update(RECORD* record, uint32_t cycles){
+    record->calls++;
+    record->total += cycles;
+    if(cycles < record->min){ record->min = cycles;}
+    if(cycles > record->max){ record->max = cycles;}
+}
+
+//------------------------------------------------------------------------------
+void NProfiler::Read(const RECORD* record, NPROFILESTATS* Stats){
+    Stats->key = record->key;
+    Stats->calls = record->calls;
+    Stats->min = (record->calls > 0L)? record->min : 0L;
+    Stats->max = record->max;
+    Stats->total = record->total;
+    Stats->average = (record->calls > 0L)? (uint32_t)(record->total / record->calls) : 0L;
+}
+
+//------------------------------------------------------------------------------
+// record of a component, cleared when its slot changes hands (lock held)
+NProfiler::RECORD* NProfiler::Component(RECORD* table, uint32_t id){
+    uint32_t slot = id & 0xFFFF;
+    if(slot >= __SYS_MAX_OBJECTS){ return(NULL);}
+
+    RECORD* record = &table[slot];
+    if(record->key != id){
+        RECORD empty = { id, 0L, 0xFFFFFFFF, 0L, 0L};
+        *record = empty;
+    }
+    return(record);
+}
+
+//------------------------------------------------------------------------------
+// record of a message identifier, added on first use (lock held)
+NProfiler::RECORD* NProfiler::Message(uint32_t message){
+    uint32_t b = (uint32_t)(message * 0x9E3779B1UL) >> 16;
+    for(uint32_t n=0L; n<__SYS_PROFILE_MESSAGES; n++){
+        RECORD* record = &messages[(b + n) & (__SYS_PROFILE_MESSAGES - 1)];
+        if(record->key == message){ return(record);}
+        if(record->key == __SYS_INDEX_INVALID){ record->key = message; return(record);}
+    }
+    overflows++;
+    return(NULL);
+}
+
+//------------------------------------------------------------------------------
+void NProfiler::Notified(uint32_t id, uint32_t message, uint32_t cycles){
+    uint32_t primask = NPortLock();
+    RECORD* record = Component(notifications, id);
+    if(record != NULL){ Update(record, cycles);}
+    record = Message(message);
+    if(record != NULL){ Update(record, cycles);}
+    NPortUnlock(primask);
+}
+
+//------------------------------------------------------------------------------
+void NProfiler::Called(uint32_t id, uint32_t message, uint32_t cycles){
+    uint32_t primask = NPortLock();
+    RECORD* record = Component(callbacks, id);
+    if(record != NULL){ Update(record, cycles);}
+    record = Message(message);
+    if(record != NULL){ Update(record, cycles);}
+    NPortUnlock(primask);
+}
+
+//------------------------------------------------------------------------------
+bool NProfiler::GetComponent(uint32_t id, NPROFILESTATS* Notify, NPROFILESTATS* Callback){
+    if((id & 0xFFFF) >= __SYS_MAX_OBJECTS){ return(false);}
+
+    uint32_t primask = NPortLock();
+    if(Notify != NULL){ Read(Component(notifications, id), Notify);}
+    if(Callback != NULL){ Read(Component(callbacks, id), Callback);}
+    NPortUnlock(primask);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+bool NProfiler::GetMessage(uint32_t index, NPROFILESTATS* Stats){
+    uint32_t primask = NPortLock();
+    for(uint32_t m=0L; m<__SYS_PROFILE_MESSAGES; m++){
+        if(messages[m].key == __SYS_INDEX_INVALID){ continue;}
+        if(index-- == 0L){
+            Read(&messages[m], Stats);
+            NPortUnlock(primask);
+            return(true);
+        }
+    }
+    NPortUnlock(primask);
+    return(false);
+}
+
+#endif
+//==============================================================================
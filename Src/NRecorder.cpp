@@ -0,0 +1,101 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+#ifdef __SYS_RECORD
+
+//------------------------------------------------------------------------------
+static_assert((__SYS_RECORD_EVENTS & (__SYS_RECORD_EVENTS - 1)) == 0, "NRecorder: ring size must be a power of two");
+static_assert(sizeof(NRECORD) == 28, "NRecorder: the record layout is read by the host tools");
+static_assert(sizeof(NRECORDHEADER) == 20, "NRecorder: the header layout is read by the host tools");
+static_assert(__SYS_PRIORITY_LEVELS <= 32, "NRecorder: the queue level is kept in 5 bits");
+
+//------------------------------------------------------------------------------
+NRECORD NRecorder::records[__SYS_RECORD_EVENTS];
+NAtomic NRecorder::head;
+volatile uint32_t NRecorder::tail = 0L;
+NAtomic NRecorder::lost;
+uint32_t NRecorder::clock = 0L;
+volatile uint32_t NRecorder::enabled = 0L;
+volatile uint32_t NRecorder::derived = 0L;
+
+//------------------------------------------------------------------------------
+void NRecorder::Initialize(uint32_t frequency){
+    enabled = 0L;
+    clock = frequency;
+    for(uint32_t r=0L; r<__SYS_RECORD_EVENTS; r++) records[r].kind = 0;
+    head.Store(0L);
+    tail = 0L;
+    lost.Store(0L);
+    derived = 0L;
+    enabled = 1L;
+}
+
+//------------------------------------------------------------------------------
+void NRecorder::Record(uint32_t kind, uint32_t level, uint32_t target, const NMESSAGE* Msg,
+                       bool accepted, bool nested){
+    if(enabled == 0L){ return;}
+    uint32_t time = NCycles();
+    uint32_t vector = __get_IPSR();
+
+    //-----------------------------------------
+    // what caused the message
+    uint32_t origin;
+    if((vector == (uint32_t)(PendSV_IRQn + 16))||(vector == (uint32_t)(SysTick_IRQn + 16))){
+        origin = __SYS_ORIGIN_KERNEL;
+    } else if((derived != 0L)||((vector < 16)&&(nested))){
+#ifdef __SYS_THREADS
+        // other threads may preempt the dispatcher: not caused by its message
+        if((derived == 0L)&&(!NThread::IsSystemThread())){ origin = __SYS_ORIGIN_THREAD;}
+        else
+#endif
+        origin = __SYS_ORIGIN_DERIVED;
+    } else {
+        origin = (vector >= 16)? __SYS_ORIGIN_INTERRUPT : __SYS_ORIGIN_THREAD;
+    }
+
+    //-----------------------------------------
+    // a full ring keeps the undrained records
+    uint32_t n = head.Load();
+    do{
+        if((n - tail) >= __SYS_RECORD_EVENTS){ lost.FetchAdd(1); return;}
+    } while(!head.CompareExchange(n, n + 1));
+
+    NRECORD* r = &records[n & (__SYS_RECORD_EVENTS - 1)];
+    r->time = time;
+    r->info = (uint8_t)(origin | (accepted? __SYS_RECORD_ACCEPTED : 0L) | (level << __SYS_RECORD_LEVEL_SHIFT));
+    r->vector = (uint16_t)vector;
+    r->target = target;
+    r->message = *Msg;
+    __DMB();
+    r->kind = (uint8_t)kind;
+}
+
+//------------------------------------------------------------------------------
+uint32_t NRecorder::Read(NRECORDHEADER* header, NRECORD* buffer, uint32_t max){
+    uint32_t n = 0L;
+
+    //-----------------------------------------
+    // up to the first record still being written
+    while((n < max)&&(tail != head.Load())){
+        NRECORD* r = &records[tail & (__SYS_RECORD_EVENTS - 1)];
+        if(r->kind == 0){ break;}
+        __DMB();
+        buffer[n++] = *r;
+        r->kind = 0;
+        __DMB();
+        tail = tail + 1;
+    }
+
+    //-----------------------------------------
+    header->magic = __SYS_RECORD_MAGIC;
+    header->version = (uint16_t)__SYS_RECORD_VERSION;
+    header->size = (uint16_t)sizeof(NRECORD);
+    header->clock = clock;
+    header->count = n;
+    header->lost = lost.Exchange(0L);
+    return(n);
+}
+
+#endif
+//==============================================================================
@@ -0,0 +1,152 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+//------------------------------------------------------------------------------
+NRegistry::NRegistry(){
+    objects_number = 0L;
+    free_number = __SYS_MAX_OBJECTS;
+    next_rank = 1L;
+    oldest = newest = __SYS_SLOT_NONE;
+    ordered = true;
+
+    //---------------------------------------
+    // free slots are handed out in ascending order
+    for(uint32_t i=0L; i<__SYS_MAX_OBJECTS; i++){
+        objects[i] = NULL;
+        generations[i] = 1;
+        ranks[i] = 0L;
+        older[i] = newer[i] = __SYS_SLOT_NONE;
+        free_slots[i] = (uint16_t)(__SYS_MAX_OBJECTS - 1 - i);
+    }
+    for(uint32_t b=0L; b<__SYS_REGISTRY_BUCKETS; b++) buckets[b] = 0;
+    for(uint32_t w=0L; w<__SYS_OBJECT_WORDS; w++) live[w] = 0L;
+}
+
+//------------------------------------------------------------------------------
+// multiplicative hash of the component address
+uint32_t NRegistry::Hash(HANDLE comp){
+    uint32_t key = (uint32_t)((uintptr_t)comp >> 2);
+    key = (uint32_t)(key * 2654435761UL);
+    return((key >> 16) & (__SYS_REGISTRY_BUCKETS - 1));
+}
+
+//------------------------------------------------------------------------------
+// empties a bucket and moves back the entries that probed past it
+void NRegistry::Unlink(uint32_t bucket){
+    const uint32_t mask = __SYS_REGISTRY_BUCKETS - 1;
+    uint32_t hole = bucket;
+    uint32_t next = (bucket + 1) & mask;
+
+    while(buckets[next] != 0){
+        uint32_t home = Hash(objects[buckets[next] - 1]);
+        // the entry can fill the hole if its home is not in (hole, next]
+        if(((next - home) & mask) >= ((next - hole) & mask)){
+            buckets[hole] = buckets[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    buckets[hole] = 0;
+}
+
+//------------------------------------------------------------------------------
+uint32_t NRegistry::Include(HANDLE comp){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if((comp == NULL)||(free_number == 0L)||(Find(comp) != __SYS_INDEX_INVALID)){
+        __set_PRIMASK(primask);
+        return(__SYS_INDEX_INVALID);
+    }
+
+    //---------------------------------------
+    uint32_t slot = free_slots[--free_number];
+    uint32_t b = Hash(comp);
+    while(buckets[b] != 0){ b = (b + 1) & (__SYS_REGISTRY_BUCKETS - 1);}
+    buckets[b] = (uint16_t)(slot + 1);
+
+    //---------------------------------------
+    objects[slot] = comp;
+    ranks[slot] = next_rank++;
+    if((newest != __SYS_SLOT_NONE)&&(slot < newest)){ ordered = false;}
+    older[slot] = newest;
+    newer[slot] = __SYS_SLOT_NONE;
+    if(newest != __SYS_SLOT_NONE){ newer[newest] = (uint16_t)slot;}
+    else { oldest = (uint16_t)slot;}
+    newest = (uint16_t)slot;
+    objects_number++;
+    live[slot >> 5] |= (1UL << (slot & 31));
+    __set_PRIMASK(primask);
+    return(slot);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NRegistry::Detach(HANDLE comp){
+    if(comp == NULL){ return(__SYS_INDEX_INVALID);}
+
+    //---------------------------------------
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t b = Hash(comp);
+    while(buckets[b] != 0){
+        uint32_t slot = buckets[b] - 1;
+        if(objects[slot] == comp){
+            Unlink(b);
+            live[slot >> 5] &= ~(1UL << (slot & 31));
+
+            // out of the inclusion order ("newer" is kept for a walk in progress)
+            if(older[slot] != __SYS_SLOT_NONE){ newer[older[slot]] = newer[slot];}
+            else { oldest = newer[slot];}
+            if(newer[slot] != __SYS_SLOT_NONE){ older[newer[slot]] = older[slot];}
+            else { newest = older[slot];}
+            if(--objects_number == 0L){ ordered = true;}
+            __set_PRIMASK(primask);
+            return(slot);
+        }
+        b = (b + 1) & (__SYS_REGISTRY_BUCKETS - 1);
+    }
+    __set_PRIMASK(primask);
+    return(__SYS_INDEX_INVALID);
+}
+
+//------------------------------------------------------------------------------
+void NRegistry::Release(uint32_t slot){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    objects[slot] = NULL;
+    ranks[slot] = 0L;
+    if(++generations[slot] == 0){ generations[slot] = 1;}
+    free_slots[free_number++] = (uint16_t)slot;
+    __set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NRegistry::Find(HANDLE comp){
+    if(comp == NULL){ return(__SYS_INDEX_INVALID);}
+
+    //---------------------------------------
+    uint32_t b = Hash(comp);
+    while(buckets[b] != 0){
+        uint32_t slot = buckets[b] - 1;
+        if(objects[slot] == comp){ return(slot);}
+        b = (b + 1) & (__SYS_REGISTRY_BUCKETS - 1);
+    }
+    return(__SYS_INDEX_INVALID);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NRegistry::Identify(HANDLE comp){
+    uint32_t slot = Find(comp);
+    if(slot == __SYS_INDEX_INVALID){ return(__SYS_COMPONENT_NONE);}
+    return(((uint32_t)generations[slot] << 16) | slot);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NRegistry::Resolve(uint32_t id){
+    uint32_t slot = id & 0xFFFF;
+    if((slot >= __SYS_MAX_OBJECTS)||(!IsLive(slot))){ return(__SYS_INDEX_INVALID);}
+    if(generations[slot] != (uint16_t)(id >> 16)){ return(__SYS_INDEX_INVALID);}
+    return(slot);
+}
+
+//==============================================================================
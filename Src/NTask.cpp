@@ -0,0 +1,169 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+#ifdef __SYS_COROUTINES
+
+//------------------------------------------------------------------------------
+static_assert((__SYS_MAX_TASKS > 0) && (__SYS_MAX_TASKS <= 32), "NTaskScheduler: 1 to 32 tasks");
+static_assert((__SYS_TASK_FRAME_SIZE % __STDCPP_DEFAULT_NEW_ALIGNMENT__) == 0, "NTaskScheduler: misaligned frames");
+
+// the kernel instance, reached by the coroutine promise and the awaiters
+static NTaskScheduler* sysScheduler = NULL;
+
+//------------------------------------------------------------------------------
+NTaskScheduler::NTaskScheduler(){
+    free_frames.Store((__SYS_MAX_TASKS < 32)? ((1UL << __SYS_MAX_TASKS) - 1) : 0xFFFFFFFF);
+    expired.Store(0L);
+    waiting = NULL;
+    sysScheduler = this;
+}
+
+//------------------------------------------------------------------------------
+void* NTaskScheduler::AllocateFrame(size_t size){
+    if(size > __SYS_TASK_FRAME_SIZE){ return(NULL);}
+
+    uint32_t bits = free_frames.Load();
+    while(bits != 0L){
+        uint32_t index = __CLZ(__RBIT(bits));
+        if(free_frames.CompareExchange(bits, bits & ~(1UL << index))){ return(frames[index]);}
+    }
+    return(NULL);
+}
+
+//------------------------------------------------------------------------------
+void NTaskScheduler::ReleaseFrame(void* frame){
+    uint32_t index = (uint32_t)(((uint32_t*)frame - frames[0]) / (__SYS_TASK_FRAME_SIZE / 4));
+    if(index < __SYS_MAX_TASKS){ free_frames.FetchOr(1UL << index);}
+}
+
+//------------------------------------------------------------------------------
+uint32_t NTaskScheduler::Counter(){
+    uint32_t bits = ~free_frames.Load();
+    uint32_t n = 0L;
+    for(uint32_t t=0L; t<__SYS_MAX_TASKS; t++){ if(bits & (1UL << t)){ n++;}}
+    return(n);
+}
+
+//------------------------------------------------------------------------------
+// timeout timer (SysTick interrupt): the task is resumed by the next dispatch
+void NTaskScheduler::Timeout(uint32_t timer, void* context){
+    (void)timer;
+    NTASKWAIT* wait = (NTASKWAIT*)context;
+    wait->timer = __SYS_TIMER_NONE;
+    wait->expired = true;
+    sysScheduler->expired.FetchAdd(1);
+}
+
+//------------------------------------------------------------------------------
+void NTaskScheduler::Wait(NTASKWAIT* wait, uint32_t timeout){
+    NTASKWAIT** link = &waiting;
+
+    // appended: tasks waiting for the same message resume in order
+    wait->next = NULL;
+    while(*link != NULL){ link = &(*link)->next;}
+    *link = wait;
+
+    //---------------------------------------
+    if(timeout > 0L){
+        wait->timer = SYS->StartTimer(Timeout, wait, timeout);
+        if(wait->timer == __SYS_TIMER_NONE){
+            // no timer left: expires at once instead of waiting forever
+            wait->expired = true;
+            expired.FetchAdd(1);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+uint32_t NTaskScheduler::Match(const NMESSAGE* Msg){
+    NTASKWAIT* ready = NULL;
+    NTASKWAIT** tail = &ready;
+    NTASKWAIT** link = &waiting;
+    uint32_t n = 0L;
+
+    //---------------------------------------
+    // detached first: the resumed tasks may wait again (for the next message)
+    while(*link != NULL){
+        NTASKWAIT* wait = *link;
+        if((wait->message != NM_NULL)&&(wait->message == Msg->message)&&
+           ((wait->data1 == __SYS_TASK_ANY)||(wait->data1 == Msg->data1))){
+            *link = wait->next;
+            if(wait->timer != __SYS_TIMER_NONE){ SYS->CancelTimer(wait->timer);}
+            wait->result = *Msg;
+            wait->next = NULL;
+            *tail = wait; tail = &wait->next;
+        } else {
+            link = &wait->next;
+        }
+    }
+
+    //---------------------------------------
+    while(ready != NULL){
+        NTASKWAIT* next = ready->next;
+        std::coroutine_handle<>::from_address(ready->frame).resume();
+        ready = next; n++;
+    }
+    return(n);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NTaskScheduler::Poll(){
+    NTASKWAIT* ready = NULL;
+    NTASKWAIT** tail = &ready;
+    NTASKWAIT** link = &waiting;
+    uint32_t n = 0L;
+
+    expired.Store(0L);
+    while(*link != NULL){
+        NTASKWAIT* wait = *link;
+        if(wait->expired){
+            *link = wait->next;
+            wait->result.message = NM_NULL;
+            wait->next = NULL;
+            *tail = wait; tail = &wait->next;
+        } else {
+            link = &wait->next;
+        }
+    }
+
+    //---------------------------------------
+    while(ready != NULL){
+        NTASKWAIT* next = ready->next;
+        std::coroutine_handle<>::from_address(ready->frame).resume();
+        ready = next; n++;
+    }
+    return(n);
+}
+
+//------------------------------------------------------------------------------
+void* NTask::promise_type::operator new(size_t size) noexcept {
+    return((sysScheduler != NULL)? sysScheduler->AllocateFrame(size) : NULL);
+}
+
+//------------------------------------------------------------------------------
+void NTask::promise_type::operator delete(void* frame) noexcept {
+    if(sysScheduler != NULL){ sysScheduler->ReleaseFrame(frame);}
+}
+
+//------------------------------------------------------------------------------
+NTask::Awaiter::Awaiter(uint32_t message, uint32_t data1, uint32_t ms){
+    wait.next = NULL;
+    wait.frame = NULL;
+    wait.message = message;
+    wait.data1 = data1;
+    wait.timer = __SYS_TIMER_NONE;
+    wait.expired = false;
+    wait.result.message = NM_NULL;
+    wait.result.data1 = wait.result.data2 = wait.result.tag = 0L;
+    timeout = ms;
+}
+
+//------------------------------------------------------------------------------
+void NTask::Awaiter::await_suspend(std::coroutine_handle<> handle){
+    wait.frame = handle.address();
+    sysScheduler->Wait(&wait, timeout);
+}
+
+#endif
+//==============================================================================
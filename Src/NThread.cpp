@@ -0,0 +1,253 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+#ifdef __SYS_THREADS
+
+//------------------------------------------------------------------------------
+enum{ kDormant, kReady, kBlocked};
+
+//------------------------------------------------------------------------------
+// the system thread: System::Execute on the main stack
+class NSystemThread : public NThread{
+    public:
+        NSystemThread() : NThread(NULL, 0L){}
+};
+
+static NSystemThread sysSystemThread;
+static NThread* sysThreads[__SYS_THREAD_PRIORITIES];
+static uint32_t sysReady = 0L;
+
+// running and selected threads, read by the PendSV context switch
+extern "C" { NThread* volatile sysThreadSwitch[2] = { NULL, NULL};}
+
+//------------------------------------------------------------------------------
+NThread::NThread(uint32_t* Stack, uint32_t words){
+    NPortClearContext(&context);
+    stack = Stack;
+    stack_words = words;
+    priority = __SYS_THREAD_SYSTEM;
+    state = kDormant;
+    timer = __SYS_TIMER_NONE;
+    switches = 0L;
+    timed_out = false;
+}
+
+//------------------------------------------------------------------------------
+void NThread::Initialize(){
+    uint32_t primask = NPortLock();
+    sysSystemThread.state = kReady;
+    sysThreads[__SYS_THREAD_SYSTEM] = &sysSystemThread;
+    sysReady |= (1UL << __SYS_THREAD_SYSTEM);
+    sysThreadSwitch[0] = &sysSystemThread;
+    sysThreadSwitch[1] = &sysSystemThread;
+    NPortUnlock(primask);
+}
+
+//------------------------------------------------------------------------------
+// selects the highest priority ready thread; PendSV switches to it (lock held)
+void NThread::Reschedule(){
+    NThread* next = sysThreads[31 - __CLZ(sysReady)];
+    if(next == sysThreadSwitch[1]){ return;}
+
+    sysThreadSwitch[1] = next;
+    if(next != sysThreadSwitch[0]){
+        next->switches++;
+        NPortSetPendSV();
+    }
+}
+
+#ifdef EDROS_HOST
+//------------------------------------------------------------------------------
+void NThread::Switch(){
+    uint32_t primask = NPortLock();
+    NThread* from = sysThreadSwitch[0];
+    NThread* to = sysThreadSwitch[1];
+    if(from != to){
+        sysThreadSwitch[0] = to;
+        NPortSwitchContext(&from->context, &to->context);
+    }
+    NPortUnlock(primask);
+}
+#endif
+
+//------------------------------------------------------------------------------
+bool NThread::Start(NTHREADENTRY entry, void* argument, uint32_t Priority){
+    if((stack == NULL)||(entry == NULL)){ return(false);}
+    if((Priority == __SYS_THREAD_SYSTEM)||(Priority >= __SYS_THREAD_PRIORITIES)){ return(false);}
+
+    uint32_t primask = NPortLock();
+    if((state != kDormant)||(sysThreads[Priority] != NULL)||(sysThreadSwitch[0] == NULL)){
+        NPortUnlock(primask);
+        return(false);
+    }
+
+    //---------------------------------------
+    // watermark pattern, then the context resumed by the first switch
+    for(uint32_t w=0L; w<stack_words; w++) stack[w] = __SYS_STACK_FILL;
+    NPortInitContext(&context, stack, stack_words, entry, argument, Exit);
+
+    //---------------------------------------
+    priority = Priority;
+    switches = 0L;
+    state = kReady;
+    sysThreads[priority] = this;
+    sysReady |= (1UL << priority);
+    Reschedule();
+    NPortUnlock(primask);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+// return address of the thread functions
+void NThread::Exit(){
+    uint32_t primask = NPortLock();
+    NThread* thread = sysThreadSwitch[0];
+    thread->state = kDormant;
+    sysThreads[thread->priority] = NULL;
+    sysReady &= ~(1UL << thread->priority);
+    Reschedule();
+    NPortUnlock(primask);
+
+    // switched out for good
+    for(;;){}
+}
+
+//------------------------------------------------------------------------------
+// makes a blocked thread ready (lock held, any context)
+void NThread::Ready(NThread* thread){
+    if(thread->state != kBlocked){ return;}
+    if(thread->timer != __SYS_TIMER_NONE){
+        SYS->CancelTimer(thread->timer);
+        thread->timer = __SYS_TIMER_NONE;
+    }
+    thread->state = kReady;
+    sysReady |= (1UL << thread->priority);
+    Reschedule();
+}
+
+//------------------------------------------------------------------------------
+// blocks the running thread; the switch happens when the lock is released
+void NThread::Block(uint32_t ms){
+    NThread* thread = sysThreadSwitch[0];
+    thread->state = kBlocked;
+    thread->timed_out = false;
+    sysReady &= ~(1UL << thread->priority);
+    if(ms > 0L){
+        thread->timer = SYS->StartTimer(Expire, thread, ms);
+        if(thread->timer == __SYS_TIMER_NONE){
+            // no timer left: times out at once instead of blocking forever
+            thread->state = kReady;
+            thread->timed_out = true;
+            sysReady |= (1UL << thread->priority);
+        }
+    }
+    Reschedule();
+}
+
+//------------------------------------------------------------------------------
+// timeout of a blocked thread (SysTick interrupt)
+void NThread::Expire(uint32_t timer, void* context){
+    NThread* thread = (NThread*)context;
+    uint32_t primask = NPortLock();
+    if(thread->timer == timer){
+        thread->timer = __SYS_TIMER_NONE;
+        thread->timed_out = true;
+        Ready(thread);
+    }
+    NPortUnlock(primask);
+}
+
+//------------------------------------------------------------------------------
+void NThread::Sleep(uint32_t ms){
+    if(IsSystemThread()){ SYS->Delay(ms); return;}
+    if(ms == 0L){ return;}
+
+    uint32_t primask = NPortLock();
+    Block(ms);
+    NPortUnlock(primask);
+}
+
+//------------------------------------------------------------------------------
+NThread* NThread::Current(){
+    NThread* thread = sysThreadSwitch[0];
+    return((thread != NULL)? thread : &sysSystemThread);
+}
+
+//------------------------------------------------------------------------------
+bool NThread::IsSystemThread(){
+    return(Current() == &sysSystemThread);
+}
+
+//------------------------------------------------------------------------------
+bool NThread::IsRunning(){
+    return(state != kDormant);
+}
+
+//------------------------------------------------------------------------------
+void NThread::GetStats(NTHREADSTATS* Stats){
+    uint32_t untouched = 0L;
+    while((untouched < stack_words)&&(stack[untouched] == __SYS_STACK_FILL)){ untouched++;}
+
+    Stats->priority = priority;
+    Stats->stack_size = stack_words << 2;
+    Stats->stack_used = (stack_words - untouched) << 2;
+    Stats->switches = switches;
+}
+
+//------------------------------------------------------------------------------
+NMailbox::NMailbox(NMessageRing* Ring){
+    ring = Ring;
+    waiter = NULL;
+}
+
+//------------------------------------------------------------------------------
+bool NMailbox::IsFilled(void* context){
+    return(((NMailbox*)context)->ring->Counter() != 0L);
+}
+
+//------------------------------------------------------------------------------
+bool NMailbox::Post(const NMESSAGE* Msg){
+    if(!ring->Put(Msg)){ return(false);}
+
+    uint32_t primask = NPortLock();
+    NThread* thread = waiter;
+    if(thread != NULL){
+        waiter = NULL;
+        NThread::Ready(thread);
+    }
+    NPortUnlock(primask);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+bool NMailbox::Wait(NMESSAGE* Msg, uint32_t timeout){
+    //---------------------------------------
+    // the system thread never blocks: cooperative wait
+    if(NThread::IsSystemThread()){
+        if(ring->Get(Msg)){ return(true);}
+        SYS->WaitFor(IsFilled, this, timeout);
+        return(ring->Get(Msg));
+    }
+
+    //---------------------------------------
+    uint32_t t0 = SYS->GetSystemTime();
+    for(;;){
+        uint32_t primask = NPortLock();
+        waiter = NULL;
+        if(ring->Get(Msg)){ NPortUnlock(primask); return(true);}
+
+        uint32_t remaining = 0L;
+        if(timeout > 0L){
+            uint32_t elapsed = SYS->GetSystemTime() - t0;
+            if(elapsed >= timeout){ NPortUnlock(primask); return(false);}
+            remaining = timeout - elapsed;
+        }
+        waiter = NThread::Current();
+        NThread::Block(remaining);
+        NPortUnlock(primask);
+    }
+}
+
+#endif
+//==============================================================================
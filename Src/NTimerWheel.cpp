@@ -0,0 +1,301 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+//------------------------------------------------------------------------------
+#define __SYS_WHEEL_NONE 			((uint8_t) 0xFF)
+#define __SYS_WHEEL_MASK 			((uint32_t)(__SYS_WHEEL_SLOTS - 1))
+#define __SYS_WHEEL_FIRING 			((uint8_t) __SYS_WHEEL_LEVELS)
+
+static_assert(__SYS_MAX_TIMERS < 0xFF, "NTimerWheel: up to 254 timers");
+
+//------------------------------------------------------------------------------
+NTimerWheel::NTimerWheel(){
+    for(uint32_t l=0L; l<__SYS_WHEEL_LEVELS; l++){
+        for(uint32_t s=0L; s<__SYS_WHEEL_SLOTS; s++) heads[l][s] = __SYS_WHEEL_NONE;
+    }
+
+    //---------------------------------------
+    for(uint32_t t=0L; t<__SYS_MAX_TIMERS; t++){
+        timers[t].kind = kFree;
+        timers[t].generation = 1L;
+        timers[t].next = (t + 1 < __SYS_MAX_TIMERS)? (uint8_t)(t + 1) : __SYS_WHEEL_NONE;
+    }
+    occupied[0] = occupied[1] = 0L;
+    free_head = 0;
+    firing = __SYS_WHEEL_NONE;
+    armed = 0L;
+    current = 0L;
+    pipe = NULL;
+}
+
+//------------------------------------------------------------------------------
+// takes a timer from the free list (lock held)
+uint32_t NTimerWheel::Allocate(){
+    uint32_t index = free_head;
+    if(index == __SYS_WHEEL_NONE){ return(__SYS_INDEX_INVALID);}
+    free_head = timers[index].next;
+    return(index);
+}
+
+//------------------------------------------------------------------------------
+// returns a timer to the free list; its identifier becomes invalid (lock held)
+void NTimerWheel::Free(uint32_t index){
+    TIMER* timer = &timers[index];
+    timer->kind = kFree;
+    timer->generation = (timer->generation + 1) & 0x00FFFFFF;
+    if(timer->generation == 0L){ timer->generation = 1L;}
+    timer->next = free_head;
+    free_head = (uint8_t)index;
+    armed--;
+}
+
+//------------------------------------------------------------------------------
+// arms an allocated timer (lock held)
+uint32_t NTimerWheel::Start(uint32_t index, uint32_t delay){
+    if(delay == 0L){ delay = 1L;}
+    else if(delay >= __SYS_WHEEL_RANGE){ delay = __SYS_WHEEL_RANGE - 1;}
+
+    // "current" is processed by the next tick: a 1-tick timer expires there
+    timers[index].expires = current + delay - 1;
+    Link(index);
+    armed++;
+    return((timers[index].generation << 8) | index);
+}
+
+//------------------------------------------------------------------------------
+// links a timer in the slot of its expiration tick (lock held)
+void NTimerWheel::Link(uint32_t index){
+    TIMER* timer = &timers[index];
+    uint32_t delta = timer->expires - current;
+    uint32_t level = 0L;
+
+    //---------------------------------------
+    if((int32_t)delta < 0){
+        // already due: processed by the next tick
+        timer->expires = current; delta = 0L;
+    } else if(delta >= __SYS_WHEEL_RANGE){
+        timer->expires = current + __SYS_WHEEL_RANGE - 1; delta = __SYS_WHEEL_RANGE - 1;
+    }
+    while((level < __SYS_WHEEL_LEVELS - 1)&&(delta >= (1UL << (__SYS_WHEEL_BITS * (level + 1))))){ level++;}
+
+    //---------------------------------------
+    uint32_t slot = (timer->expires >> (__SYS_WHEEL_BITS * level)) & __SYS_WHEEL_MASK;
+    timer->level = (uint8_t)level;
+    timer->slot = (uint8_t)slot;
+    timer->prev = __SYS_WHEEL_NONE;
+    timer->next = heads[level][slot];
+    if(timer->next != __SYS_WHEEL_NONE){ timers[timer->next].prev = (uint8_t)index;}
+    heads[level][slot] = (uint8_t)index;
+    if(level == 0L){ occupied[slot >> 5] |= (1UL << (slot & 31));}
+}
+
+//------------------------------------------------------------------------------
+// removes a timer from its slot or from the firing list (lock held)
+void NTimerWheel::Unlink(uint32_t index){
+    TIMER* timer = &timers[index];
+    if(timer->prev != __SYS_WHEEL_NONE){ timers[timer->prev].next = timer->next;}
+    else if(timer->level == __SYS_WHEEL_FIRING){ firing = timer->next;}
+    else { heads[timer->level][timer->slot] = timer->next;}
+    if(timer->next != __SYS_WHEEL_NONE){ timers[timer->next].prev = timer->prev;}
+
+    //---------------------------------------
+    if((timer->level == 0)&&(heads[0][timer->slot] == __SYS_WHEEL_NONE)){
+        occupied[timer->slot >> 5] &= ~(1UL << (timer->slot & 31));
+    }
+}
+
+//------------------------------------------------------------------------------
+// number of empty level 0 slots from "slot" up to the next occupied one
+// (or up to the end of the level, where the upper levels cascade)
+uint32_t NTimerWheel::Gap(uint32_t slot){
+    for(uint32_t w = slot >> 5; w < (__SYS_WHEEL_SLOTS / 32); w++){
+        uint32_t bits = occupied[w];
+        if(w == (slot >> 5)){ bits &= ~((1UL << (slot & 31)) - 1);}
+        if(bits != 0L){ return(((w << 5) + __CLZ(__RBIT(bits))) - slot);}
+    }
+    return(__SYS_WHEEL_SLOTS - slot);
+}
+
+//------------------------------------------------------------------------------
+// moves the timers of the current slot of "level" to the levels below (lock held)
+void NTimerWheel::Cascade(uint32_t level){
+    uint32_t slot = (current >> (__SYS_WHEEL_BITS * level)) & __SYS_WHEEL_MASK;
+    uint32_t index = heads[level][slot];
+    heads[level][slot] = __SYS_WHEEL_NONE;
+
+    while(index != __SYS_WHEEL_NONE){
+        uint32_t next = timers[index].next;
+        Link(index);
+        index = next;
+    }
+}
+
+//------------------------------------------------------------------------------
+// identifier to index, or __SYS_INDEX_INVALID if the timer is not armed
+uint32_t NTimerWheel::Resolve(uint32_t id){
+    uint32_t index = id & 0xFF;
+    if(index >= __SYS_MAX_TIMERS){ return(__SYS_INDEX_INVALID);}
+    if((timers[index].kind == kFree)||(timers[index].generation != (id >> 8))){ return(__SYS_INDEX_INVALID);}
+    return(index);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NTimerWheel::StartFlag(bool* flag, uint32_t delay){
+    uint32_t id = __SYS_TIMER_NONE;
+    uint32_t primask = NPortLock();
+    uint32_t index = Allocate();
+    if(index != __SYS_INDEX_INVALID){
+        timers[index].kind = kFlag;
+        timers[index].target = flag;
+        timers[index].period = 0L;
+        id = Start(index, delay);
+    }
+    NPortUnlock(primask);
+    return(id);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NTimerWheel::StartCallback(NTIMERCALLBACK callback, void* context, uint32_t delay, uint32_t period){
+    uint32_t id = __SYS_TIMER_NONE;
+    if(callback == NULL){ return(id);}
+
+    uint32_t primask = NPortLock();
+    uint32_t index = Allocate();
+    if(index != __SYS_INDEX_INVALID){
+        timers[index].kind = kCallback;
+        timers[index].callback = callback;
+        timers[index].target = context;
+        timers[index].period = period;
+        id = Start(index, delay);
+    }
+    NPortUnlock(primask);
+    return(id);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NTimerWheel::StartMessage(uint32_t message, HANDLE destination, uint32_t delay, uint32_t period){
+    uint32_t id = __SYS_TIMER_NONE;
+    if(message == NM_NULL){ return(id);}
+
+    uint32_t primask = NPortLock();
+    uint32_t index = Allocate();
+    if(index != __SYS_INDEX_INVALID){
+        timers[index].kind = kMessage;
+        timers[index].message = message;
+        timers[index].target = destination;
+        timers[index].period = period;
+        id = Start(index, delay);
+    }
+    NPortUnlock(primask);
+    return(id);
+}
+
+//------------------------------------------------------------------------------
+bool NTimerWheel::Cancel(uint32_t id){
+    bool result = false;
+    uint32_t primask = NPortLock();
+    uint32_t index = Resolve(id);
+    if(index != __SYS_INDEX_INVALID){
+        Unlink(index);
+        Free(index);
+        result = true;
+    }
+    NPortUnlock(primask);
+    return(result);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NTimerWheel::NextExpiration(uint32_t limit){
+    uint32_t primask = NPortLock();
+    for(uint32_t t=0L; t<__SYS_MAX_TIMERS; t++){
+        if(timers[t].kind == kFree){ continue;}
+        // "current" is processed by the next tick
+        uint32_t ticks = timers[t].expires - current + 1;
+        if(ticks < limit){ limit = ticks;}
+    }
+    NPortUnlock(primask);
+    return(limit);
+}
+
+//------------------------------------------------------------------------------
+uint32_t NTimerWheel::Advance(uint32_t ticks){
+    uint32_t expired = 0L;
+
+    while(ticks > 0L){
+        uint32_t primask = NPortLock();
+        uint32_t slot = current & __SYS_WHEEL_MASK;
+
+        //-----------------------------------
+        // nothing to do up to the next occupied slot or the next cascade
+        if(slot != 0L){
+            uint32_t gap = Gap(slot);
+            if(gap > 0L){
+                if(gap > ticks){ gap = ticks;}
+                current += gap; ticks -= gap;
+                NPortUnlock(primask);
+                continue;
+            }
+        }
+
+        //-----------------------------------
+        // the upper levels move down when the level below wraps around
+        for(uint32_t l=1L; l<__SYS_WHEEL_LEVELS; l++){
+            if((current & ((1UL << (__SYS_WHEEL_BITS * l)) - 1)) != 0L){ break;}
+            Cascade(l);
+        }
+        uint32_t tick = current++;
+        ticks--;
+
+        //-----------------------------------
+        // the slot is detached before firing: timers re-armed or started by the
+        // callbacks for "tick + 64" land in it again, for the next revolution
+        firing = heads[0][slot];
+        heads[0][slot] = __SYS_WHEEL_NONE;
+        occupied[slot >> 5] &= ~(1UL << (slot & 31));
+        for(uint32_t i = firing; i != __SYS_WHEEL_NONE; i = timers[i].next){ timers[i].level = __SYS_WHEEL_FIRING;}
+
+        while(firing != __SYS_WHEEL_NONE){
+            uint32_t index = firing;
+            TIMER* timer = &timers[index];
+            Unlink(index);
+
+            //-------------------------------
+            uint8_t kind = timer->kind;
+            void* target = timer->target;
+            NTIMERCALLBACK callback = timer->callback;
+            uint32_t message = timer->message;
+            uint32_t id = (timer->generation << 8) | index;
+
+            if(timer->period > 0L){
+                timer->expires = tick + timer->period;
+                Link(index);
+            } else {
+                Free(index);
+            }
+            NPortUnlock(primask);
+
+            //-------------------------------
+            switch(kind){
+                case kFlag: *(bool*)target = true; break;
+                case kCallback: callback(id, target); break;
+                case kMessage:{
+                    NMESSAGE Msg = { message, id, tick, 0L};
+                    if(pipe == NULL){ break;}
+                    if(target == NULL){ pipe->Insert(&Msg);}
+                    else {
+                        uint32_t priority = (message > __SYS_PRIORITY_BORDERLINE)? __SYS_QUEUE_PRIORITY : __SYS_QUEUE_STANDARD;
+                        pipe->Send(&Msg, (HANDLE)target, priority);
+                    }
+                } break;
+                default: break;
+            }
+            expired++;
+            primask = NPortLock();
+        }
+        NPortUnlock(primask);
+    }
+    return(expired);
+}
+
+//==============================================================================
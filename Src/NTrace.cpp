@@ -0,0 +1,37 @@
+//==============================================================================
+#include "System.h"
+#include "DRV_CPU.h"
+
+#ifdef __SYS_TRACE
+
+//------------------------------------------------------------------------------
+static_assert((__SYS_TRACE_EVENTS & (__SYS_TRACE_EVENTS - 1)) == 0, "NTrace: ring size must be a power of two");
+static_assert(sizeof(NTRACEEVENT) == 12, "NTrace: the event layout is read by the host tools");
+static_assert(sizeof(NTRACEHEADER) == 24, "NTrace: the header layout is read by the host tools");
+
+//------------------------------------------------------------------------------
+NTRACEBUFFER NTrace::buffer;
+
+//------------------------------------------------------------------------------
+void NTrace::Initialize(uint32_t clock){
+    buffer.header.enabled = 0L;
+    buffer.header.magic = __SYS_TRACE_MAGIC;
+    buffer.header.version = (uint16_t)__SYS_TRACE_VERSION;
+    buffer.header.size = (uint16_t)sizeof(NTRACEEVENT);
+    buffer.header.capacity = __SYS_TRACE_EVENTS;
+    buffer.header.clock = clock;
+    Reset();
+    buffer.header.enabled = 1L;
+}
+
+//------------------------------------------------------------------------------
+void NTrace::Reset(){
+    uint32_t enabled = buffer.header.enabled;
+    buffer.header.enabled = 0L;
+    for(uint32_t e=0L; e<__SYS_TRACE_EVENTS; e++) buffer.events[e].event = 0;
+    buffer.header.head.Store(0L);
+    buffer.header.enabled = enabled;
+}
+
+#endif
+//==============================================================================
@@ -14,11 +14,6 @@
 //          HEAP:    9000h(36Kbytes)
 //==============================================================================
 
-//------------------------------------------------------------------------------
-// NOTE: The line below to enable/disable "Deep Sleep"
-//#define DEEP_SLEEP_MODE
-//------------------------------------------------------------------------------
-
 //-------------------------------- Includes ------------------------------------
 #include "System.h"
 #include "DRV_CPU.h"
@@ -28,6 +23,23 @@
 //------------------------------------------------------------------------------
 System*     SYS;
 
+//------------------------------------------------------------------------------
+// system queues (capacities defined at compile time)
+static NStaticMessagePipe<__SYS_STANDARD_MESSAGES, __SYS_PRIORITY_MESSAGES> sysMessagePipe;
+static NStaticMessageRing<__SYS_STANDARD_CALLBACKS> sysCallbackRing;
+static NStaticMessageReserve<__SYS_RESERVE_MESSAGES> sysReserve;
+static NStaticBufferPool<__SYS_BUFFER_SIZE, __SYS_BUFFER_BLOCKS> sysBuffers;
+static NTimerWheel sysTimers;
+#ifdef __SYS_COROUTINES
+static NTaskScheduler sysTasks;
+#endif
+#ifdef __SYS_PROFILER
+static NProfiler sysProfiler;
+#endif
+#ifdef __SYS_LATENCY
+static NLatency sysLatency;
+#endif
+
 //------------------------------------------------------------------------------
 void __attribute__((weak)) ApplicationException(uint32_t e);
 void __attribute__((weak)) ApplicationCreate();
@@ -38,18 +50,14 @@ extern void RelocateVectors();
 // Disable SysTick IRQ and SysTick Timer
 void System::Halt(){
   halt = true;
-  SysTick->CTRL &= ~( SysTick_CTRL_CLKSOURCE_Msk |
-                   	  SysTick_CTRL_TICKINT_Msk   |
-                   	  SysTick_CTRL_ENABLE_Msk);
+  NPortTickStop();
 }
 
 //------------------------------------------------------------------------------
 // Enable SysTick IRQ and SysTick Timer
 void System::Resume(){
   halt = false;
-  SysTick->CTRL |=  ( SysTick_CTRL_CLKSOURCE_Msk |
-                   	  SysTick_CTRL_TICKINT_Msk   |
-                   	  SysTick_CTRL_ENABLE_Msk);
+  NPortTickStart();
 }
 
 //------------------------------------------------------------------------------
@@ -60,23 +68,194 @@ bool System::IsHalt(){ return(halt);}
 // "power saving mode"
 void System::UpdatePowerdown(){
 	//FLASH->ACR |= FLASH_ACR_SLEEP_PD; ///TDO
-	if(sleep == true){
-		__DSB();
-		__WFI();
+	if(sleep != true){ return;}
+#ifdef __SYS_POWER
+	if(!halt){ GovernedIdle(); return;}
+#endif
+	if(tickless && !halt){ TicklessIdle(); return;}
+
+	// messages carried over by the dispatch budget: no time to sleep
+	if(!queue->IsPending()){
+		NTRACE(__SYS_TRACE_SLEEP_ENTER, 0, 0, 0);
+		NPortWaitForInterrupt();
+		NTRACE(__SYS_TRACE_SLEEP_EXIT, 0, 0, 0);
 	}
 }
 
+//------------------------------------------------------------------------------
+// idle until the next deadline with a single SysTick wake-up
+void System::TicklessIdle(){
+	__disable_irq();
+	if(queue->IsPending()){ __enable_irq(); return;}
+
+	//------------------------------------------
+	// SysTick counts down from LOAD: 24 bits limit the idle period
+	uint32_t limit = (__SYS_TICK_RELOAD_MAX / tick_cycles);
+	uint32_t n = NextDeadline(limit);
+	if(n < 2L){
+		// no tick to suppress
+		NTRACE(__SYS_TRACE_SLEEP_ENTER, 0, 0, 0);
+		NPortWaitForInterrupt();
+		NTRACE(__SYS_TRACE_SLEEP_EXIT, 0, 0, 0);
+		__enable_irq();
+		return;
+	}
+
+	//------------------------------------------
+	// the pending tick keeps its phase, the next n-1 ticks are suppressed
+	NPortTickStop();
+	uint32_t reload = NPortTickCount() + (tick_cycles * (n - 1));
+	NPortTickSetLoad(reload);
+	NPortTickClear();
+	NPortTickStart();
+
+	// interrupts are masked: the core wakes up, but no handler runs before the fix-up below
+	NTRACE(__SYS_TRACE_SLEEP_ENTER, 1, n - 1, 0);
+	NPortWaitForInterrupt(); __ISB();
+
+	//------------------------------------------
+	bool wrapped = NPortTickStop();
+	uint32_t remaining = NPortTickCount();
+	uint32_t complete, next;
+
+	if(wrapped){
+		// deadline reached: the pending SysTick interrupt accounts for the last tick
+		uint32_t late = reload - remaining;
+		next = (late < tick_cycles)? (tick_cycles - late) : tick_cycles;
+		complete = n - 1;
+	} else {
+		// woken up earlier by another interrupt
+		complete = (n - 1) - (remaining / tick_cycles);
+		next = remaining % tick_cycles;
+		if(next == 0L){ next = tick_cycles; complete++;}
+	}
+
+	//------------------------------------------
+	// finish the current tick, then back to the standard period
+	NPortTickSetLoad(next - 1);
+	NPortTickClear();
+	NPortTickStart();
+	NPortTickSetLoad(tick_cycles - 1);
+
+	NTRACE(__SYS_TRACE_SLEEP_EXIT, 1, complete, 0);
+	if(complete > 0L){ Step(complete);}
+	__enable_irq();
+}
+
+#ifdef __SYS_POWER
+//------------------------------------------------------------------------------
+// idle entry in the mode chosen by the power governor (@ref NPower)
+void System::GovernedIdle(){
+	__disable_irq();
+	if(queue->IsPending()){ __enable_irq(); return;}
+
+	uint32_t n = NextDeadline(__SYS_POWER_FOREVER);
+	NPOWERMODE mode = NPower::Select(n);
+	bool timed = (n != __SYS_POWER_FOREVER);
+
+	//------------------------------------------
+	// SysTick stops in the deep modes: the wake-up timer takes over up to the deadline tick
+	if((mode > nPowerSleep) && timed && !ApplicationWakeupStart(n - 1)){
+		NPower::NoWakeupTimer();
+		mode = nPowerSleep;
+	}
+	if(mode == nPowerRun){ __enable_irq(); return;}
+	if(mode == nPowerSleep){
+		if(tickless){
+			__enable_irq();
+			TicklessIdle();
+			NPower::Resumed(mode);
+		} else {
+			NTRACE(__SYS_TRACE_SLEEP_ENTER, 0, 0, 0);
+			NPortWaitForInterrupt();
+			NTRACE(__SYS_TRACE_SLEEP_EXIT, 0, 0, 0);
+			NPower::Resumed(mode);
+			__enable_irq();
+		}
+		return;
+	}
+
+	//------------------------------------------
+	// interrupts are masked: the core wakes up, but no handler runs before the clocks are back
+	NPortTickStop();
+	NTRACE(__SYS_TRACE_SLEEP_ENTER, mode, timed? (n - 1) : 0L, 0);
+	NPortStandby(mode == nPowerStandby);
+	NPortDeepSleep(true);
+	NPortWaitForInterrupt(); __ISB();
+
+	NPower::Resuming();
+	NPortDeepSleep(false);
+	NPortStandby(false);
+	ApplicationResume(mode);
+	NPower::Resumed(mode);
+
+	//------------------------------------------
+	// the frozen tick resumes where it stopped
+	uint32_t elapsed = timed? ApplicationWakeupStop() : 0L;
+	if(timed && (elapsed > (n - 1))){ elapsed = n - 1;}
+	NPortTickStart();
+
+	NTRACE(__SYS_TRACE_SLEEP_EXIT, mode, elapsed, 0);
+	if(elapsed > 0L){ Step(elapsed);}
+	__enable_irq();
+}
+#endif
+
+//------------------------------------------------------------------------------
+// ticks up to the next kernel deadline (timers and periodic messages)
+uint32_t System::NextDeadline(uint32_t limit){
+	uint32_t n = sysTimers.NextExpiration(limit);
+	if((rate_timers > 0)&&((uint32_t)(rate_timers - ticks_timers) < n)){ n = rate_timers - ticks_timers;}
+	if((rate_inputs > 0)&&((uint32_t)(rate_inputs - ticks_inputs) < n)){ n = rate_inputs - ticks_inputs;}
+	if((rate_outputs > 0)&&((uint32_t)(rate_outputs - ticks_outputs) < n)){ n = rate_outputs - ticks_outputs;}
+	return(n);
+}
+
 //------------------------------------------------------------------------------
 // Enter "power saving mode" (wake-up on interrupts)
 void System::Sleep(bool s){
-	if(s){
+	// no "sleep on exit" with the power governor: the main loop chooses the mode of each idle period
+#ifndef __SYS_POWER
+	if(s && !tickless){
 		// sets the "sleep on exit" to wait for the least prioritized interrupt to finish
-		__DSB();
-		SCB->SCR |= SCB_SCR_SLEEPONEXIT_Msk;
+		NPortSleepOnExit(true);
 	}
+#endif
 	sleep = s;
 }
 
+//------------------------------------------------------------------------------
+// Select the "tickless" power saving mode
+void System::SetTickless(bool s){
+	if(s){
+		// the idle period is fixed up by the main loop: it must run after every wake-up
+		NPortSleepOnExit(false);
+	} else if(sleep){
+#ifndef __SYS_POWER
+		NPortSleepOnExit(true);
+#endif
+	}
+	tickless = s;
+}
+
+//------------------------------------------------------------------------------
+bool System::IsTickless(){ return(tickless);}
+
+//------------------------------------------------------------------------------
+// the periods are kept in 16 bits: a longer one must not wrap to 0 (disabled)
+static inline uint16_t PeriodicRate(uint32_t ms){
+	return((uint16_t)((ms > __SYS_RATE_MAX)? __SYS_RATE_MAX : ms));
+}
+
+//------------------------------------------------------------------------------
+void System::SetPeriodicRates(uint32_t tick, uint32_t scan, uint32_t update){
+	uint32_t primask = NPortLock();
+	rate_timers = PeriodicRate(tick); ticks_timers = 0;
+	rate_inputs = PeriodicRate(scan); ticks_inputs = 0;
+	rate_outputs = PeriodicRate(update); ticks_outputs = 0;
+	NPortUnlock(primask);
+}
+
 //------------------------------------------------------------------------------
 // Check if in "power saving mode"
 bool System::IsSleeping(){ return(sleep);}
@@ -91,10 +270,21 @@ void System::Initialize(){
   	halt = false;
 	sleep = false;
     time = 0L;
-    ticks_timers = 1L;
-    ticks_inputs = 2L;
-    ticks_outputs = 3L;
+    time_high = 0L;
+    ticks_timers = 0L;
+    ticks_inputs = 1L;
+    ticks_outputs = 2L;
+    rate_timers = __SYS_TICK_RATE;
+    rate_inputs = __SYS_SCAN_RATE;
+    rate_outputs = __SYS_UPDATE_RATE;
+    tickless = false;
+    tick_cycles = SystemCoreClock / 1000;
+    read_ticks = 0L;
+    read_fraction = 0L;
+    ns_scale = (uint32_t)((1000000ULL << 16) / tick_cycles);
 	ksc0 = ksc1 = ksc2 = 1L;
+    dispatch_budget = __SYS_DISPATCH_BUDGET;
+    dispatch_time = __SYS_DISPATCH_TIME;
 
     //---------------------------------------
     for(uint32_t i = 0; i<__SYS_MAX_VECTORS; i++) sysVectors[i] = 0;
@@ -102,58 +292,344 @@ void System::Initialize(){
 	__disable_irq();
 	
     //---------------------------------------
-    queue = new NMessagePipe();
+    queue = &sysMessagePipe;
+    queue->SetBufferPool(&sysBuffers);
+    sysTimers.SetPipe(queue);
+#ifdef __SYS_COROUTINES
+    queue->SetScheduler(&sysTasks);
+#endif
+#ifdef __SYS_THREADS
+    NThread::Initialize();
+#endif
+#if defined(__SYS_PROFILER) || defined(__SYS_LATENCY) || defined(__SYS_TRACE) || defined(__SYS_RECORD) || defined(__SYS_LOAD) || defined(__SYS_POWER)
+    NStartCycles();
+#endif
+#if defined(__SYS_TRACE) || defined(__SYS_RECORD) || defined(__SYS_LOAD)
+    // frequency of the cycle counter (nanoseconds on the host port)
+  #ifdef EDROS_HOST
+    uint32_t cycles = 1000000000UL;
+  #else
+    uint32_t cycles = SystemCoreClock;
+  #endif
+#endif
+#ifdef __SYS_TRACE
+    NTrace::Initialize(cycles);
+#endif
+#ifdef __SYS_RECORD
+    NRecorder::Initialize(cycles);
+#endif
+#ifdef __SYS_LOAD
+    NLoad::Initialize(cycles, time);
+#endif
+#ifdef __SYS_POWER
+    // the core resumes from Stop on the internal oscillator (nanoseconds on the host port)
+  #ifdef EDROS_HOST
+    NPower::Initialize(1000000000UL);
+  #else
+    NPower::Initialize(__SYS_POWER_RESUME_CLOCK);
+  #endif
+#endif
+#ifdef __SYS_PROFILER
+    queue->SetProfiler(&sysProfiler);
+#endif
+#ifdef __SYS_LATENCY
+    queue->SetLatency(&sysLatency);
+#endif
 	
     //---------------------------------------
-    CallbackQueue = new NFifo(sizeof(NMESSAGE), __SYS_STANDARD_CALLBACKS);
+    CallbackQueue = &sysCallbackRing;
+    sysCallbackRing.SetBufferPool(&sysBuffers);
 	
 	__enable_irq();
-
-	#ifdef DEEP_SLEEP_MODE
-		SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk; /* Enable deep sleep feature */
-	#endif
 }
 
 //------------------------------------------------------------------------------
 void System::Heartbeat(){
-    NMESSAGE    Msg1;
+    Step(1);
+}
 
-    time++;
-    UpdateTimeouts();
+//------------------------------------------------------------------------------
+// advances the system time by "elapsed" ticks (1, or more after a tickless idle period)
+void System::Step(uint32_t elapsed){
+    // both words change together for the clock readers
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t t = time + elapsed;
+    if(t < time){ time_high = time_high + 1;}
+    time = t;
+    __set_PRIMASK(primask);
+    sysTimers.Advance(elapsed);
 
     //----------------------------------------
-    if(__SYS_TICK_RATE > 0){
-        if(++ticks_timers > __SYS_TICK_RATE){
-            Msg1.message = NM_TIMETICK;
-            Msg1.data1 = 0L;
-            Msg1.data2 = time;
-            queue->Insert(&Msg1);
-            ticks_timers = 1L;
-        }
-    }
+    // periodic messages: coalesced while still waiting in the queue
+    UpdatePeriodic(NM_TIMETICK, rate_timers, &ticks_timers, elapsed);
+    UpdatePeriodic(NM_KEYSCAN, rate_inputs, &ticks_inputs, elapsed);
+    UpdatePeriodic(NM_REPAINT, rate_outputs, &ticks_outputs, elapsed);
+    NLOAD_UPDATE(time);
+}
 
-    //----------------------------------------
-    if(__SYS_SCAN_RATE > 0){
-        if(++ticks_inputs > __SYS_SCAN_RATE){
-            Msg1.message = NM_KEYSCAN;
-            Msg1.data1 = 0L; Msg1.data2 = 0L;
-            queue->Insert(&Msg1);
-            ticks_inputs = 1L;
-        }
-    }
+//------------------------------------------------------------------------------
+void System::UpdatePeriodic(uint32_t message, uint32_t rate, uint16_t* counter, uint32_t elapsed){
+    if(rate == 0L){ return;}
 
-    //----------------------------------------
-    if(__SYS_UPDATE_RATE > 0){
-        if(++ticks_outputs > __SYS_UPDATE_RATE){
-            Msg1.message = NM_REPAINT;
-            Msg1.data1 = 0L; Msg1.data2 = 0L;
-            SYS->queue->Insert(&Msg1);
-            ticks_outputs = 1L;
-        }
-    }
-    return;
+    uint32_t ticks = *counter + elapsed;
+    if(ticks < rate){ *counter = (uint16_t)ticks; return;}
+    *counter = (uint16_t)(ticks % rate);
+
+    NMESSAGE Msg1 = { message, 0L, time, 0L};
+    queue->InsertPeriodic(&Msg1, ticks / rate);
+}
+
+//------------------------------------------------------------------------------
+uint32_t System::GetMergedCount(uint32_t message){
+    return(queue->GetMergedCount(message));
+}
+
+//------------------------------------------------------------------------------
+bool System::SetOverflowPolicy(uint32_t q, NOVERFLOW policy){
+    NMessageRing* ring = (q == __SYS_QUEUE_CALLBACKS)? CallbackQueue : queue->GetQueue(q);
+    if(ring == NULL){ return(false);}
+    return(ring->SetOverflow(policy, &sysReserve));
+}
+
+//------------------------------------------------------------------------------
+bool System::GetQueueStats(uint32_t q, NQUEUESTATS* stats){
+    NMessageRing* ring = (q == __SYS_QUEUE_CALLBACKS)? CallbackQueue : queue->GetQueue(q);
+    if((ring == NULL)||(stats == NULL)){ return(false);}
+    ring->GetStats(stats);
+    return(true);
+}
+
+//------------------------------------------------------------------------------
+void* System::AllocateBuffer(){
+    return(sysBuffers.Allocate());
+}
+
+//------------------------------------------------------------------------------
+uint32_t System::GetBufferHandle(void* data){
+    return(sysBuffers.Handle(data));
+}
+
+//------------------------------------------------------------------------------
+void* System::GetBuffer(uint32_t handle){
+    return(sysBuffers.Data(handle));
+}
+
+//------------------------------------------------------------------------------
+bool System::RetainBuffer(uint32_t handle){
+    return(sysBuffers.Retain(handle));
+}
+
+//------------------------------------------------------------------------------
+bool System::ReleaseBuffer(uint32_t handle){
+    return(sysBuffers.Release(handle));
+}
+
+//------------------------------------------------------------------------------
+bool System::PostBuffer(NMESSAGE* M, uint32_t priority){
+	if(M->message == NM_NULL){ sysBuffers.Release(M->tag); return(false);}
+	return(queue->Insert(M, priority, __SYS_MESSAGE_BUFFER));
+}
+
+//------------------------------------------------------------------------------
+bool System::SendBuffer(NMESSAGE* M, HANDLE destination, uint32_t priority){
+	if(M->message == NM_NULL){ sysBuffers.Release(M->tag); return(false);}
+	return(queue->Send(M, destination, priority, __SYS_MESSAGE_BUFFER));
+}
+
+//------------------------------------------------------------------------------
+void System::DispatchBuffer(NMESSAGE* M){
+	Route(M, __SYS_MESSAGE_BUFFER);
+}
+
+//------------------------------------------------------------------------------
+void System::GetBufferStats(NBUFFERSTATS* stats){
+    if(stats != NULL){ sysBuffers.GetStats(stats);}
+}
+
+//------------------------------------------------------------------------------
+void System::SetDispatchBudget(uint32_t messages, uint32_t microseconds){
+    dispatch_budget = messages;
+    dispatch_time = microseconds;
+}
+
+//------------------------------------------------------------------------------
+void System::GetDispatchStats(NDISPATCHSTATS* stats){
+    if(stats != NULL){ queue->GetDispatchStats(stats);}
+}
+
+//------------------------------------------------------------------------------
+bool System::GetComponentProfile(HANDLE comp, NPROFILESTATS* notify, NPROFILESTATS* callback){
+#ifdef __SYS_PROFILER
+    uint32_t id = queue->GetComponentId(comp);
+    if(id == __SYS_COMPONENT_NONE){ return(false);}
+    return(sysProfiler.GetComponent(id, notify, callback));
+#else
+    (void)comp; (void)notify; (void)callback;
+    return(false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool System::GetLatency(uint32_t vector, uint32_t path, NLATENCYSTATS* stats){
+#ifdef __SYS_LATENCY
+    if(stats == NULL){ return(false);}
+    return(sysLatency.Get(vector, path, stats));
+#else
+    (void)vector; (void)path; (void)stats;
+    return(false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool System::GetLatencySource(uint32_t index, NLATENCYSTATS* stats){
+#ifdef __SYS_LATENCY
+    if(stats == NULL){ return(false);}
+    return(sysLatency.GetSource(index, stats));
+#else
+    (void)index; (void)stats;
+    return(false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void System::ResetLatency(){
+#ifdef __SYS_LATENCY
+    sysLatency.Reset();
+#endif
+}
+
+//------------------------------------------------------------------------------
+void System::SetTrace(bool enable){
+#ifdef __SYS_TRACE
+    NTrace::Enable(enable);
+#else
+    (void)enable;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void System::TraceMark(uint32_t id, uint32_t value){
+#ifdef __SYS_TRACE
+    NTRACE(__SYS_TRACE_MARK, 0, id, value);
+#else
+    (void)id; (void)value;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void System::ResetTrace(){
+#ifdef __SYS_TRACE
+    NTrace::Reset();
+#endif
+}
+
+//------------------------------------------------------------------------------
+const void* System::GetTrace(uint32_t* size){
+#ifdef __SYS_TRACE
+    if(size != NULL){ *size = sizeof(NTRACEBUFFER);}
+    return(NTrace::Buffer());
+#else
+    if(size != NULL){ *size = 0L;}
+    return(NULL);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void System::SetRecorder(bool enable){
+#ifdef __SYS_RECORD
+    NRecorder::Enable(enable);
+#else
+    (void)enable;
+#endif
+}
+
+//------------------------------------------------------------------------------
+uint32_t System::ReadRecords(NRECORDHEADER* header, NRECORD* records, uint32_t max){
+#ifdef __SYS_RECORD
+    return(NRecorder::Read(header, records, max));
+#else
+    (void)records; (void)max;
+    header->magic = __SYS_RECORD_MAGIC;
+    header->version = (uint16_t)__SYS_RECORD_VERSION;
+    header->size = (uint16_t)sizeof(NRECORD);
+    header->clock = 0L;
+    header->count = 0L;
+    header->lost = 0L;
+    return(0L);
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool System::GetLoad(NLOADSTATS* stats){
+#ifdef __SYS_LOAD
+    return(NLoad::Get(stats));
+#else
+    stats->window = stats->load = stats->isr = stats->dispatch = 0L;
+    stats->busy_max = stats->wakeups = stats->windows = 0L;
+    return(false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void System::SetLoadWindow(uint32_t ms){
+#ifdef __SYS_LOAD
+    NLoad::SetWindow(ms);
+#else
+    (void)ms;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void System::SetPowerPolicy(NPOWERMODE deepest, uint32_t latency){
+#ifdef __SYS_POWER
+    NPower::SetPolicy(deepest, latency);
+#else
+    (void)deepest; (void)latency;
+#endif
 }
 
+//------------------------------------------------------------------------------
+bool System::GetPowerStats(NPOWERMODE mode, NPOWERSTATS* stats){
+#ifdef __SYS_POWER
+    return(NPower::Get(mode, stats));
+#else
+    (void)mode;
+    stats->entries = stats->latency = stats->resume = stats->locks = 0L;
+    return(false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool System::GetMessageProfile(uint32_t index, NPROFILESTATS* stats){
+#ifdef __SYS_PROFILER
+    if(stats == NULL){ return(false);}
+    return(sysProfiler.GetMessage(index, stats));
+#else
+    (void)index; (void)stats;
+    return(false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void System::ResetProfile(){
+#ifdef __SYS_PROFILER
+    sysProfiler.Reset();
+#endif
+}
+
+#ifdef __SYS_PROFILER
+//------------------------------------------------------------------------------
+void System::InvokeCallback(NComponent* Owner, NMESSAGE* Msg){
+    uint32_t message = Msg->message;
+    NRECORD_DERIVED();
+    NPROFILE_START(t0);
+    Owner->InterruptCallBack(Msg);
+    // the registry is consistent in any context: its updates mask the interrupts
+    NPROFILE_CALLBACK(&sysProfiler, t0, queue->GetComponentId(Owner), message);
+}
+#endif
+
 //------------------------------------------------------------------------------
 bool System::IncludeComponent(HANDLE newcomp){
     return(queue->IncludeComponent(newcomp));
@@ -171,6 +647,26 @@ bool System::FindComponent(HANDLE comp){
 	return(result);
 }
 
+//------------------------------------------------------------------------------
+uint32_t System::GetComponentId(HANDLE comp){
+    return(queue->GetComponentId(comp));
+}
+
+//------------------------------------------------------------------------------
+HANDLE System::GetComponent(uint32_t id){
+    return(queue->GetComponent(id));
+}
+
+//------------------------------------------------------------------------------
+bool System::Subscribe(HANDLE comp, uint32_t message){
+    return(queue->Subscribe(comp, message));
+}
+
+//------------------------------------------------------------------------------
+bool System::Unsubscribe(HANDLE comp, uint32_t message){
+    return(queue->Unsubscribe(comp, message));
+}
+
 //------------------------------------------------------------------------------
 // register new component
 // hcomp: component�s handle; NV_ID vector index
@@ -191,25 +687,30 @@ HANDLE System::GetCallback(NV_ID vector_id){
 
 //------------------------------------------------------------------------------
 // insert message in the Callback notifications queue
-void System::CallbackSchedule(NMESSAGE* Msg){
-	CallbackQueue->Put((uint8_t*)Msg, sizeof(NMESSAGE));
+void System::CallbackSchedule(NMESSAGE* Msg, uint32_t flags){
+	CallbackQueue->Put(Msg, __SYS_COMPONENT_NONE, flags);
 	// calls the callback service
-	*((uint32_t volatile*) 0xE000ED04) |= 0x10000000;
+	NPortSetPendSV();
 }
 
 //------------------------------------------------------------------------------
 // remove message from Callback notifications queue
-bool System::CallbackAttend(NMESSAGE* Msg){
-	bool result = (bool)CallbackQueue->Counter();
-	if(result){ CallbackQueue->Get((uint8_t*)Msg);}
-	return result;
+bool System::CallbackAttend(NMESSAGE* Msg, uint32_t* flags){
+#ifdef __SYS_LATENCY
+	uint32_t stamp;
+	if(!CallbackQueue->Get(Msg, NULL, &stamp, flags)){ return(false);}
+	sysLatency.Record(Msg->data1, __SYS_PATH_CALLBACK, stamp);
+	return(true);
+#else
+	return(CallbackQueue->Get(Msg, NULL, NULL, flags));
+#endif
 }
 
 //------------------------------------------------------------------------------
 // finish a Callback notification
 void System::CallbackAttended(){
 	// when leaving, assure non-occurrency of "late arrival"
-	*((uint32_t volatile*) 0xE000ED04) &= ~0x10000000;
+	NPortClearPendSV();
 }
 
 ///-----------------------------------------------------------------------------
@@ -223,63 +724,115 @@ void System::CallbackAttended(){
 // ATEN��O: Componentes com DMA "DEVEM" implementar m�todo "InterrupCallBack"
 //-----------------------------------------------------------------------------*/
 void System::Dispatch(NMESSAGE* M){
+	Route(M, __SYS_MESSAGE_PLAIN);
+}
 
+//------------------------------------------------------------------------------
+// routes an interrupt message; a data block reference (flags) ends with the
+// InterruptCallBack of its owner, or passes to the queued copy
+void System::Route(NMESSAGE* M, uint32_t flags){
 	NComponent* Owner = NULL;
-	if(M->message == (uint32_t)NULL){ return;}
+	uint32_t tag = M->tag;
+	bool buffer = ((flags & __SYS_MESSAGE_BUFFER) != 0L);
+	if(M->message == (uint32_t)NULL){
+		if(buffer){ sysBuffers.Release(tag);}
+		return;
+	}
+	NRECORD(__SYS_RECORD_DISPATCH, 0L, 0L, M, true, false);
+	NRECORD_DERIVED();
 
     Owner = (NComponent*) GetCallback(M->data1);
     if((HANDLE)Owner != NULL){
+#ifdef __SYS_LATENCY
+		// the queued copies carry the entry stamp of the interrupt handler
+		uint32_t stamp = NLatency::Arm();
+#endif
 		switch(Owner->Priority){
-			case nTimeCritical:	Owner->InterruptCallBack(M); break;
+			case nTimeCritical:
+				NTRACE(__SYS_TRACE_ROUTE, __SYS_PATH_CRITICAL, M->data1, M->message);
+#ifdef __SYS_LATENCY
+				sysLatency.Record(M->data1, __SYS_PATH_CRITICAL, stamp);
+#endif
+				InvokeCallback(Owner, M);
+				if(buffer){ sysBuffers.Release(tag);}
+				break;
 			case nNormal:
-				if(!sleep){ CallbackSchedule(M);}
-				else { Owner->InterruptCallBack(M);}
+				NTRACE(__SYS_TRACE_ROUTE, __SYS_PATH_CALLBACK, M->data1, M->message);
+				if(!sleep){ CallbackSchedule(M, flags);}
+				else {
+#ifdef __SYS_LATENCY
+					sysLatency.Record(M->data1, __SYS_PATH_CALLBACK, stamp);
+#endif
+					InvokeCallback(Owner, M);
+					if(buffer){ sysBuffers.Release(tag);}
+				}
+				break;
+			default:
+				NTRACE(__SYS_TRACE_ROUTE, __SYS_PATH_QUEUED, M->data1, M->message);
+				if(buffer){
+					uint32_t level = (M->message > __SYS_PRIORITY_BORDERLINE)? __SYS_QUEUE_PRIORITY : __SYS_QUEUE_STANDARD;
+					queue->Insert(M, level, flags);
+				} else queue->Insert(M);
 				break;
-			default: queue->Insert(M); break;
 		}
-	}
+#ifdef __SYS_LATENCY
+		NLatency::Disarm();
+#endif
+	} else if(buffer){ sysBuffers.Release(tag);}
+}
+
+//------------------------------------------------------------------------------
+bool System::PostMessage(NMESSAGE* M, uint32_t priority){
+	if(M->message == NM_NULL){ return(false);}
+	return(queue->Insert(M, priority));
+}
+
+//------------------------------------------------------------------------------
+bool System::SendMessage(NMESSAGE* M, HANDLE destination){
+	uint32_t priority = (M->message > __SYS_PRIORITY_BORDERLINE)? __SYS_QUEUE_PRIORITY : __SYS_QUEUE_STANDARD;
+	return(SendMessage(M, destination, priority));
 }
 
 //------------------------------------------------------------------------------
-// register a "timeout-event" in the system ( 1ms to 10 seconds)
+bool System::SendMessage(NMESSAGE* M, HANDLE destination, uint32_t priority){
+	if(M->message == NM_NULL){ return(false);}
+	return(queue->Send(M, destination, priority));
+}
+
+//------------------------------------------------------------------------------
+// register a "timeout-event" in the system (1ms to about 12 days)
 // NOTE: DO NOT call this from within "classes" or "components"
 bool System::InstallTimeout(void* flag, uint32_t tempo){
-    bool result = false;
-    for(int c = 0; c < __SYS_MAX_SIGNALS; c++){
-        if(sysSignals[c].flag==NULL){
-            sysSignals[c].flag = flag;
-            if(tempo == 0){ tempo = 1;}
-            else if(tempo > 10000){ tempo = 10000;}
-            sysSignals[c].counter = tempo;
-            result = true; break;
-        }
-    }
-    return(result);
+    return(sysTimers.StartFlag((bool*)flag, tempo) != __SYS_TIMER_NONE);
 }
 
 //------------------------------------------------------------------------------
-// update timeout-events in the system
-uint32_t System::UpdateTimeouts(){
-    uint32_t result = 0;
-    for(int c = 0; c < __SYS_MAX_SIGNALS; c++){
-        if(sysSignals[c].flag != NULL){
-            if(--sysSignals[c].counter == 0){
-                *(bool*)(sysSignals[c].flag) = true;
-                sysSignals[c].counter = -1;
-                sysSignals[c].flag = NULL;
-                result++;
-            }
-        }
-    }
-    return(result);
+uint32_t System::StartTimer(NTIMERCALLBACK callback, void* context, uint32_t delay, uint32_t period){
+    return(sysTimers.StartCallback(callback, context, delay, period));
+}
+
+//------------------------------------------------------------------------------
+uint32_t System::StartMessageTimer(uint32_t message, HANDLE destination, uint32_t delay, uint32_t period){
+    return(sysTimers.StartMessage(message, destination, delay, period));
+}
+
+//------------------------------------------------------------------------------
+bool System::CancelTimer(uint32_t timer){
+    return(sysTimers.Cancel(timer));
 }
 
 //------------------------------------------------------------------------------
 uint32_t System::GetSystemTime(){ return(this->time);}
 
+//------------------------------------------------------------------------------
+uint64_t System::GetSystemTime64(){
+    uint32_t fraction;
+    return(ReadClock(&fraction));
+}
+
 //------------------------------------------------------------------------------
 uint8_t System::GetRandomNumber(){
-	uint8_t result; this->ksc2 = SysTick->VAL;
+	uint8_t result; this->ksc2 = NPortTickCount();
 	result = (uint8_t)(this->ksc0 * this->ksc1 * this->ksc2);
 	this->ksc0= this->ksc1; this->ksc1 = this->ksc2;
 	return(result);
@@ -298,7 +851,12 @@ void System::Execute(){
 
     while(1){
         CPU_KickWatchdog();
-        queue->Dispatch();
+        if(queue->IsPending()){ NLOAD_BUSY();}
+        NLOAD_DISPATCH_ENTER();
+        queue->Dispatch(dispatch_budget, dispatch_time);
+        NLOAD_DISPATCH_LEAVE();
+        // nothing left: idle up to the next message (polling, or asleep below)
+        if(!queue->IsPending()){ NLOAD_IDLE();}
 		UpdatePowerdown();
     }
 }
@@ -316,39 +874,155 @@ void System::Execute(){
     return(fclk);
 }*/
 
+//------------------------------------------------------------------------------
+// reads the ticks counter and the cycles elapsed in the current tick, consistently
+uint64_t System::ReadClock(uint32_t* fraction){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    //----------------------------------------
+    uint64_t ticks = ((uint64_t)time_high << 32) | time;
+    uint32_t count = NPortTickCount();
+    // tick ended but its handler could not run yet (masked or lower priority)
+    if(NPortTickPending()){ count = NPortTickCount(); ticks++;}
+
+    // SysTick counts down; the partial tick after a tickless period ends at the same phase
+    uint32_t cycles = (count < tick_cycles)? (tick_cycles - 1 - count) : 0L;
+
+    //----------------------------------------
+    // an interrupt preempting the SysTick handler before its Step() sees the new
+    // tick's count with the old time: the clock holds at the last reading
+    if((ticks < read_ticks)||((ticks == read_ticks)&&(cycles < read_fraction))){
+        ticks = read_ticks;
+        cycles = read_fraction;
+    } else {
+        read_ticks = ticks;
+        read_fraction = cycles;
+    }
+    __set_PRIMASK(primask);
+
+    *fraction = cycles;
+    return(ticks);
+}
+
+//------------------------------------------------------------------------------
+uint64_t System::Nanoseconds(){
+    uint32_t fraction;
+    uint64_t ticks = ReadClock(&fraction);
+    return((ticks * 1000000ULL) + (((uint64_t)fraction * ns_scale) >> 16));
+}
+
 //------------------------------------------------------------------------------
 uint32_t System::Microseconds(void){
-  
-    uint32_t microseconds = SysTick->VAL >> 3;
-    return((time * 1000) + microseconds);
+    uint32_t fraction;
+    uint32_t ticks = (uint32_t)ReadClock(&fraction);
+    uint32_t nanoseconds = (uint32_t)(((uint64_t)fraction * ns_scale) >> 16);
+    return((ticks * 1000) + (nanoseconds / 1000));
 }
 
 //------------------------------------------------------------------------------
-void System::Delay(uint32_t ms){
+// 1 ms tick at the current core clock
+void System::ClockChanged(){
+    SystemCoreClockUpdate();
+    uint32_t cycles = SystemCoreClock / 1000;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    // the current tick keeps its phase: its remaining part is converted to the new clock
+    NPortTickStop();
+    uint32_t remaining = (uint32_t)(((uint64_t)NPortTickCount() * cycles) / tick_cycles);
+    if((remaining == 0L)||(remaining > cycles)){ remaining = cycles;}
+    NPortTickSetLoad(remaining - 1);
+    NPortTickClear();
+    NPortTickStart();
+    NPortTickSetLoad(cycles - 1);
+    read_fraction = (uint32_t)(((uint64_t)read_fraction * cycles) / tick_cycles);
+    tick_cycles = cycles;
+    ns_scale = (uint32_t)((1000000ULL << 16) / cycles);
+    __set_PRIMASK(primask);
+#if defined(__SYS_LOAD) && !defined(EDROS_HOST)
+    NLoad::SetFrequency(SystemCoreClock);
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool System::WaitFor(bool (*condition)(void*), void* context, uint32_t ms){
     uint32_t t0 = time;
-    uint32_t delta = 0;
-    
-    while(ms > delta){
-        delta = time - t0;
+
+#ifdef __SYS_THREADS
+    //-----------------------------------------
+    // other threads: the dispatcher belongs to the system thread
+    if((!NPortInHandler())&&(!NThread::IsSystemThread())){
+        while((condition == NULL)||(!condition(context))){
+            if((ms > 0L)&&((time - t0) >= ms)){ return(false);}
+            NThread::Sleep(1);
+        }
+        return(true);
+    }
+#endif
+
+    //-----------------------------------------
+    // interrupt handler: the dispatcher must not run here
+    if(NPortInHandler()){
+        while((condition == NULL)||(!condition(context))){
+            if((ms > 0L)&&((time - t0) >= ms)){ return(false);}
+        }
+        return(true);
+    }
+
+    //-----------------------------------------
+    // the caller's own messages are deferred until the end of the wait
+    uint32_t slot = queue->Suspend();
+    bool result = false;
+
+    for(;;){
+        if((condition != NULL)&&(condition(context))){ result = true; break;}
+        if((ms > 0L)&&((time - t0) >= ms)){ break;}
+
+        CPU_KickWatchdog();
+        NLOAD_DISPATCH_ENTER();
+        queue->Dispatch(dispatch_budget, dispatch_time);
+        NLOAD_DISPATCH_LEAVE();
+
+        //-------------------------------------
+        // nothing to do: sleep up to the next interrupt (at most one tick)
+        __disable_irq();
+        if(!queue->IsPending()){
+            NLOAD_IDLE();
+            NPortWaitForInterrupt();
+            NLOAD_BUSY();
+        }
+        __enable_irq();
     }
+    queue->Resume(slot);
+    return(result);
+}
+
+//------------------------------------------------------------------------------
+void System::Delay(uint32_t ms){
+    if(ms == 0L){ return;}
+    WaitFor(NULL, NULL, ms);
 }
 
 //------------------------------------------------------------------------------
+// counts the SysTick cycles directly: works with the interrupts disabled
 void System::MicroDelay(uint32_t us){
-    uint32_t t1 = 0;
-    uint32_t delta = 0;
-    uint32_t t0 = SysTick->VAL >> fclk;
-    uint32_t t3 = SysTick->LOAD >> fclk;
-    
-    while(us > delta){
-        t1 = SysTick->VAL >> fclk;
-        if(t1 < t0){ delta = t0 - t1;}
-        else { delta = t0 + (t3 - t1);}
+    uint32_t reload = NPortTickGetLoad() + 1;
+    uint64_t target = (uint64_t)us * (tick_cycles / 1000);
+    uint64_t elapsed = 0L;
+    uint32_t last = NPortTickCount();
+
+    while(elapsed < target){
+        uint32_t now = NPortTickCount();
+        // down-counter: a reload between two readings adds "reload" cycles
+        elapsed += (now <= last)? (last - now) : (last + reload - now);
+        last = now;
     }
 }
 
 //------------------------------------------------------------------------------
-int main(void){
+// system clock: at start-up and after Stop (the core wakes up on HSI)
+static void StartClocks(){
 
 	//------------------------------------------------
 	// *** All of these functions tested with oscilloscope via MCO ***
@@ -359,19 +1033,45 @@ int main(void){
 	//CPU_StartPLL(Pll_Hsi, Pll72MHz);	// OK (64MHz max. for HSI)
 
 	//CPU_StartHSE();	// OK
+#ifdef EDROS_QEMU
+	// QEMU board model: no clock tree, the PLL would never lock
+	SystemCoreClock = __SYS_QEMU_CLOCK;
+#else
 	CPU_StartPLL(Pll_Hse, Pll16MHz);	// OK
+#endif
 	//CPU_StartPLL(Pll_Hse, Pll36MHz);	// OK
 	//CPU_StartPLL(Pll_Hse, Pll72MHz);  // OK
 	//------------------------------------------------
+}
+
+//------------------------------------------------------------------------------
+int main(void){
+
+	//------------------------------------------------
+	// core emulation on the host port
+	NPortInitialize();
+
+	//------------------------------------------------
+	StartClocks();
 
     //-----------------------------------------
 	// framework priority group definition
 	NVIC_SetPriorityGrouping(NVIC_PriorityGroup_4);
 
+#ifdef __SYS_THREADS
+    // the context switch must never preempt another handler: PendSV is the lowest.
+    // Above SysTick, a thread woken by a timer would pend PendSV, which would then run
+    // nested in the tick and skip the switch (the tick may now preempt the callbacks)
+	uint32_t priority = NVIC_EncodePriority(NVIC_PriorityGroup_4, SYS_PRIORITY_LOW, 0);
+    NVIC_SetPriority(SysTick_IRQn, priority);
+    priority = NVIC_EncodePriority(NVIC_PriorityGroup_4, SYS_PRIORITY_LOWEST, 0);
+    NVIC_SetPriority(PendSV_IRQn, priority);
+#else
 	uint32_t priority = NVIC_EncodePriority(NVIC_PriorityGroup_4, SYS_PRIORITY_LOWEST, 0);
     NVIC_SetPriority(SysTick_IRQn, priority);
     priority = NVIC_EncodePriority(NVIC_PriorityGroup_4, SYS_PRIORITY_LOW, 0);
     NVIC_SetPriority(PendSV_IRQn, priority);
+#endif
     priority = NVIC_EncodePriority(NVIC_PriorityGroup_4, SYS_PRIORITY_NORMAL, 0);
     NVIC_SetPriority(SVCall_IRQn, priority);
 
@@ -411,5 +1111,13 @@ int main(void){
 //------------------------------------------------------------------------------
 void __attribute__((weak)) ApplicationCreate(){}
 void __attribute__((weak)) ApplicationException(uint32_t e){}
+
+//------------------------------------------------------------------------------
+// board hooks of the power governor (NPower.h): no wake-up timer, clocks of main
+bool __attribute__((weak)) ApplicationWakeupStart(uint32_t ms){ (void)ms; return(false);}
+uint32_t __attribute__((weak)) ApplicationWakeupStop(){ return(0L);}
+void __attribute__((weak)) ApplicationResume(NPOWERMODE mode){
+	if(mode == nPowerStop){ StartClocks(); NPowerClockRestored();}
+}
     
 //==============================================================================
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#===============================================================================
+# Title: EDROS - benchmark comparison
+# Compares two result files of the kernel benchmarks (Bench/Benchmark.cpp and
+# Bench/RingStress.cpp on the host, Bench/QemuWorkload.cpp under QEMU) and reports
+# the benchmarks slower than the baseline beyond a threshold.
+#
+# Usage:
+#   edros_bench.py baseline.json current.json [--threshold 10] [--metric insns_per_op]
+# Exit status: 1 if any benchmark regressed, 2 on invalid input.
+#===============================================================================
+import argparse
+import json
+import sys
+
+#-------------------------------------------------------------------------------
+BENCH_SUITE = "edros-bench"
+BENCH_VERSION = 1
+METRICS = ("ns_per_op", "ops_per_s", "insns_per_op")
+
+#-------------------------------------------------------------------------------
+class BenchError(Exception):
+    pass
+
+#-------------------------------------------------------------------------------
+def load(path, metric="ns_per_op"):
+    """Returns the configuration and the results (metric), keyed by benchmark and parameters."""
+    try:
+        with open(path) as f:
+            data = json.load(f)
+    except (OSError, ValueError) as e:
+        raise BenchError("%s: %s" % (path, e))
+    if data.get("suite") != BENCH_SUITE or data.get("version") != BENCH_VERSION:
+        raise BenchError("%s: not an EDROS benchmark file (version %d)" % (path, BENCH_VERSION))
+
+    results = {}
+    for r in data.get("results", []):
+        parameters = tuple(sorted((k, v) for k, v in r.items() if k != "benchmark" and k not in METRICS))
+        if metric in r:
+            results[(r["benchmark"], parameters)] = r[metric]
+    return data.get("config", {}), results
+
+#-------------------------------------------------------------------------------
+def label(key):
+    benchmark, parameters = key
+    return "%s %s" % (benchmark, " ".join("%s=%s" % p for p in parameters))
+
+#-------------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(description="compare two EDROS benchmark result files")
+    parser.add_argument("baseline", help="results of the reference release")
+    parser.add_argument("current", help="results to check")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="slowdown reported as a regression, in percent (default: 10)")
+    parser.add_argument("--metric", choices=("ns_per_op", "insns_per_op"), default="ns_per_op",
+                        help="value compared (insns_per_op: QEMU results only)")
+    options = parser.parse_args()
+
+    try:
+        base_config, base = load(options.baseline, options.metric)
+        config, current = load(options.current, options.metric)
+    except BenchError as e:
+        print("edros_bench: %s" % e, file=sys.stderr)
+        sys.exit(2)
+
+    if base_config != config:
+        print("edros_bench: warning: the kernel configurations differ", file=sys.stderr)
+
+    regressions = 0
+    for key in sorted(set(base) & set(current)):
+        before, after = base[key], current[key]
+        change = ((after - before) * 100.0 / before) if before > 0 else 0.0
+        mark = ""
+        if change > options.threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        elif change < -options.threshold:
+            mark = "  improved"
+        print("%-64s %10.1f %10.1f %+7.1f%%%s" % (label(key), before, after, change, mark))
+
+    for key in sorted(set(base) - set(current)):
+        print("%-64s missing in %s" % (label(key), options.current))
+
+    print("%d regression(s) beyond %.0f%%" % (regressions, options.threshold))
+    sys.exit(1 if regressions else 0)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+#===============================================================================
+# Title: EDROS - QEMU benchmark target
+# Builds the kernel with Bench/QemuWorkload.cpp for the QEMU STM32 board model
+# (Qemu/NQemu.h), boots it under qemu-system-arm and collects the results written
+# over semihosting. The counts are deterministic (-icount): a baseline comparison
+# on "insns_per_op" is a regression gate (tools/edros_bench.py).
+# The build reports the flash and SRAM used (heap and stack reserves included):
+# the link fails if they do not fit in the board memory.
+# The baseline is the results of an image built from the reference tree, recorded
+# with the same command (run ... -o base.json).
+#
+# Usage:
+#   edros_qemu.py build --framework DIR [-o edros-qemu.elf] [-D__SYS_...]
+#       DIR: EDROS framework with its headers in DIR/Inc and sources in DIR/Src
+#   edros_qemu.py run edros-qemu.elf [-o results.json] [--baseline base.json]
+#       [--threshold 1]
+# Exit status: 1 if the run failed or a benchmark regressed, 2 on invalid input.
+#===============================================================================
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+
+#-------------------------------------------------------------------------------
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+MACHINE = "stm32vldiscovery"
+ICOUNT_SHIFT = 0
+TIMEOUT = 120
+FLASH = (0x08000000, 128 * 1024)
+RAM = (0x20000000, 8 * 1024)
+
+CFLAGS = ["-mcpu=cortex-m3", "-mthumb", "-O2", "-std=gnu++14", "-DEDROS_QEMU",
+          "-fno-exceptions", "-fno-rtti", "-ffunction-sections", "-fdata-sections"]
+LDFLAGS = ["-T", os.path.join(ROOT, "Qemu", "stm32f100rb.ld"), "-Wl,--gc-sections",
+           "--specs=nano.specs", "--specs=nosys.specs"]
+
+#-------------------------------------------------------------------------------
+class QemuError(Exception):
+    pass
+
+#-------------------------------------------------------------------------------
+def build(options):
+    framework = os.path.abspath(options.framework)
+    sources = sorted(glob.glob(os.path.join(ROOT, "Src", "*.cpp")))
+    sources += [os.path.join(ROOT, "Qemu", "NQemu.cpp"), os.path.join(ROOT, "Bench", "QemuWorkload.cpp")]
+    for pattern in ("*.c", "*.cpp"):
+        sources += sorted(glob.glob(os.path.join(framework, "Src", pattern)))
+
+    command = [options.cxx] + CFLAGS + ["-D__SYS_QEMU_ICOUNT_SHIFT=%d" % ICOUNT_SHIFT]
+    command += ["-D" + d for d in options.define]
+    command += ["-I" + os.path.join(ROOT, "Qemu"), "-I" + os.path.join(ROOT, "Inc"),
+                "-I" + os.path.join(framework, "Inc")]
+    command += sources + LDFLAGS + ["-o", options.output]
+    if subprocess.call(command) != 0:
+        raise QemuError("build failed")
+    print("edros_qemu: %s" % options.output)
+    memory(options)
+
+#-------------------------------------------------------------------------------
+def memory(options):
+    """Prints the flash and SRAM used by the image (size -A: section, size, address)."""
+    tool = options.size or options.cxx.replace("g++", "size")
+    try:
+        text = subprocess.check_output([tool, "-A", options.output], universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print("edros_qemu: no memory report (%s)" % e)
+        return
+
+    flash = ram = 0
+    for line in text.splitlines():
+        fields = line.split()
+        if len(fields) != 3 or not fields[1].isdigit() or not fields[2].isdigit():
+            continue
+        name, size, address = fields[0], int(fields[1]), int(fields[2])
+        if FLASH[0] <= address < FLASH[0] + FLASH[1]:
+            flash += size
+        elif RAM[0] <= address < RAM[0] + RAM[1]:
+            ram += size
+            if name == ".data":
+                flash += size
+    print("edros_qemu: flash %d of %d bytes, SRAM %d of %d bytes" % (flash, FLASH[1], ram, RAM[1]))
+
+#-------------------------------------------------------------------------------
+def results(text):
+    """Extracts the JSON document written by the workload (the console may carry
+    QEMU messages too)."""
+    lines = text.splitlines()
+    try:
+        first = lines.index("{")
+        last = len(lines) - 1 - lines[::-1].index("}")
+    except ValueError:
+        raise QemuError("no results in the QEMU output:\n%s" % text)
+    try:
+        return json.loads("\n".join(lines[first:last + 1]))
+    except ValueError as e:
+        raise QemuError("invalid results: %s" % e)
+
+#-------------------------------------------------------------------------------
+def run(options):
+    command = [options.qemu, "-M", MACHINE, "-display", "none", "-monitor", "none", "-serial", "none",
+               "-semihosting-config", "enable=on,target=native",
+               "-icount", "shift=%d,align=off,sleep=off" % ICOUNT_SHIFT, "-kernel", options.elf]
+    try:
+        process = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                 universal_newlines=True, timeout=options.timeout)
+    except subprocess.TimeoutExpired:
+        raise QemuError("no exit after %d s (workload stuck)" % options.timeout)
+    except OSError as e:
+        raise QemuError("%s: %s" % (options.qemu, e))
+    if process.returncode != 0:
+        raise QemuError("workload failed (status %d):\n%s" % (process.returncode, process.stdout))
+
+    data = results(process.stdout)
+    for r in data.get("results", []):
+        parameters = " ".join("%s=%s" % (k, v) for k, v in sorted(r.items())
+                              if k not in ("benchmark", "insns_per_op", "ns_per_op", "ops_per_s"))
+        print("%-18s %-24s %10.2f insns %10.2f ns" % (r["benchmark"], parameters, r["insns_per_op"], r["ns_per_op"]))
+
+    with open(options.output, "w") as f:
+        json.dump(data, f, indent=2)
+        f.write("\n")
+    if options.baseline:
+        return subprocess.call([sys.executable, os.path.join(ROOT, "tools", "edros_bench.py"),
+                                options.baseline, options.output, "--metric", "insns_per_op",
+                                "--threshold", str(options.threshold)])
+    return 0
+
+#-------------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(description="EDROS benchmarks on the QEMU STM32 board model")
+    commands = parser.add_subparsers(dest="command")
+
+    b = commands.add_parser("build", help="build the workload")
+    b.add_argument("--framework", required=True, help="EDROS framework directory (Inc, Src)")
+    b.add_argument("-o", "--output", default="edros-qemu.elf")
+    b.add_argument("-D", dest="define", action="append", default=[], help="kernel option (e.g. __SYS_THREADS)")
+    b.add_argument("--cxx", default="arm-none-eabi-g++")
+    b.add_argument("--size", help="size tool (default: from --cxx)")
+
+    r = commands.add_parser("run", help="boot the workload and collect the results")
+    r.add_argument("elf")
+    r.add_argument("-o", "--output", default="edros-qemu.json")
+    r.add_argument("--baseline", help="results to compare with (insns_per_op)")
+    r.add_argument("--threshold", type=float, default=1.0,
+                   help="instruction count increase reported as a regression, in percent (default: 1)")
+    r.add_argument("--qemu", default="qemu-system-arm")
+    r.add_argument("--timeout", type=int, default=TIMEOUT)
+    options = parser.parse_args()
+
+    try:
+        if options.command == "build":
+            build(options)
+        elif options.command == "run":
+            sys.exit(run(options))
+        else:
+            parser.print_usage()
+            sys.exit(2)
+    except QemuError as e:
+        sys.exit("edros_qemu: %s" % e)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+#===============================================================================
+# Title: EDROS - message stream tool
+# Lists, summarizes and compares message streams recorded by the kernel
+# (NRecorder, see Inc/NRecorder.h): chunks of NRECORDHEADER followed by NRECORDs.
+#
+# Usage:
+#   edros_record.py stream.bin                  summary (counts, drops, bursts)
+#   edros_record.py stream.bin --text           one line per record
+#   edros_record.py original.bin --compare replayed.bin
+#       compares the messages of each origin (timing excluded) and reports the
+#       first difference; exit status 1 if the streams differ beyond their order.
+#===============================================================================
+import argparse
+import struct
+import sys
+
+#-------------------------------------------------------------------------------
+RECORD_MAGIC = 0x52524445
+RECORD_VERSION = 1
+HEADER = struct.Struct("<IHHIII")       # magic, version, size, clock, count, lost
+RECORD = struct.Struct("<IBBHIIIII")    # time, kind, info, vector, target, message, data1, data2, tag
+
+KINDS = {1: "DISPATCH", 2: "INSERT", 3: "SEND"}
+ORIGINS = {0: "thread", 1: "interrupt", 2: "derived", 3: "kernel"}
+ACCEPTED = 0x04
+LEVEL_SHIFT = 3
+
+#-------------------------------------------------------------------------------
+class RecordError(Exception):
+    pass
+
+#-------------------------------------------------------------------------------
+def decode(blob):
+    """Returns the clock (Hz), the records lost by the recorder and the records:
+    (time, kind, origin, accepted, level, vector, target, message, data1, data2, tag),
+    with the 32-bit cycle counter unwrapped."""
+    offset, clock, lost, records = 0, None, 0, []
+    while offset < len(blob):
+        if len(blob) - offset < HEADER.size:
+            raise RecordError("truncated chunk header at offset %d" % offset)
+        magic, version, size, chunk_clock, count, chunk_lost = HEADER.unpack_from(blob, offset)
+        if magic != RECORD_MAGIC:
+            raise RecordError("not an EDROS message stream (magic 0x%08X at offset %d)" % (magic, offset))
+        if version != RECORD_VERSION or size != RECORD.size:
+            raise RecordError("unsupported stream version %d (record size %d)" % (version, size))
+        offset += HEADER.size
+        if len(blob) - offset < count * size:
+            raise RecordError("truncated chunk at offset %d" % offset)
+        clock = clock or chunk_clock
+        lost += chunk_lost
+        for n in range(count):
+            records.append(RECORD.unpack_from(blob, offset + n * size))
+        offset += count * size
+
+    out, previous, now = [], None, 0
+    for time, kind, info, vector, target, message, data1, data2, tag in records:
+        if previous is not None:
+            delta = (time - previous) & 0xFFFFFFFF
+            now += delta - (1 << 32) if delta & 0x80000000 else delta
+        previous = time
+        out.append((now, kind, info & 3, bool(info & ACCEPTED), info >> LEVEL_SHIFT,
+                    vector, target, message, data1, data2, tag))
+    return clock or 1, lost, out
+
+#-------------------------------------------------------------------------------
+def load(path):
+    try:
+        with open(path, "rb") as f:
+            return decode(f.read())
+    except OSError as e:
+        raise RecordError(str(e))
+
+#-------------------------------------------------------------------------------
+def summary(clock, lost, records):
+    yield "%d records, %d lost by the recorder" % (len(records), lost)
+    if not records:
+        return
+    span = (records[-1][0] - records[0][0]) / clock
+    yield "span %.3f s" % span
+    for origin, name in ORIGINS.items():
+        selected = [r for r in records if r[2] == origin]
+        if not selected:
+            continue
+        kinds = ", ".join("%s %d" % (KINDS[k], sum(1 for r in selected if r[1] == k))
+                          for k in KINDS if any(r[1] == k for r in selected))
+        drops = sum(1 for r in selected if not r[3])
+        yield "  %-10s %7d  (%s; %d dropped)" % (name, len(selected), kinds, drops)
+
+    # highest number of interrupt messages within a millisecond: overload scenarios
+    window = clock // 1000 or 1
+    stimuli = [r[0] for r in records if r[2] == 1]
+    burst, first = 0, 0
+    for last in range(len(stimuli)):
+        while stimuli[last] - stimuli[first] >= window:
+            first += 1
+        burst = max(burst, last - first + 1)
+    yield "highest interrupt burst: %d messages in 1 ms" % burst
+
+#-------------------------------------------------------------------------------
+def listing(clock, records):
+    t0 = records[0][0] if records else 0
+    for now, kind, origin, accepted, level, vector, target, message, data1, data2, tag in records:
+        yield "%12.3f us  %-8s %-9s L%-2d %s exc=%-3d msg=0x%08X d1=0x%08X d2=0x%08X tag=0x%08X%s" % (
+            (now - t0) * 1e6 / clock, KINDS.get(kind, str(kind)), ORIGINS[origin], level,
+            "ok  " if accepted else "DROP", vector, message, data1, data2, tag,
+            " to 0x%08X" % target if kind == 3 else "")
+
+#-------------------------------------------------------------------------------
+def compare(first, second, name_first, name_second):
+    """Compares the message sequences of each origin; returns the number of origins
+    whose messages differ (not only in order)."""
+    differences = 0
+    for origin, name in ORIGINS.items():
+        a = [(r[1], r[4], r[6], r[7], r[8], r[9], r[10]) for r in first if r[2] == origin]
+        b = [(r[1], r[4], r[6], r[7], r[8], r[9], r[10]) for r in second if r[2] == origin]
+        mismatch = next((i for i, (x, y) in enumerate(zip(a, b)) if x != y), None)
+        if mismatch is None and len(a) == len(b):
+            print("%-10s identical (%d records)" % (name, len(a)))
+            continue
+        if sorted(a) == sorted(b):
+            # same messages, interleaved differently (timing of the dispatcher)
+            print("%-10s same %d records, in a different order from record %d" % (name, len(a), mismatch))
+            continue
+        differences += 1
+        if mismatch is None:
+            print("%-10s %d records in %s, %d in %s (common prefix identical)" %
+                  (name, len(a), name_first, len(b), name_second))
+        else:
+            print("%-10s first difference at record %d of %d/%d:" % (name, mismatch, len(a), len(b)))
+            print("           %s: %s" % (name_first, a[mismatch]))
+            print("           %s: %s" % (name_second, b[mismatch]))
+    return differences
+
+#-------------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(description="EDROS message stream tool")
+    parser.add_argument("stream", help="recorded message stream")
+    parser.add_argument("--text", action="store_true", help="list the records")
+    parser.add_argument("--compare", metavar="STREAM", help="stream to compare with (e.g. a replay)")
+    options = parser.parse_args()
+
+    try:
+        clock, lost, records = load(options.stream)
+        if options.compare:
+            _, _, other = load(options.compare)
+    except RecordError as e:
+        sys.exit("edros_record: %s" % e)
+
+    if options.compare:
+        sys.exit(1 if compare(records, other, options.stream, options.compare) else 0)
+    for line in (listing(clock, records) if options.text else summary(clock, lost, records)):
+        print(line)
+
+if __name__ == "__main__":
+    main()
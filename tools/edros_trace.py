@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+#===============================================================================
+# Title: EDROS - kernel trace converter
+# Converts a dump of the kernel trace buffer (NTRACEBUFFER, see Inc/NTrace.h)
+# to the Chrome trace format, for chrome://tracing or ui.perfetto.dev.
+#
+# Dumping the buffer (firmware built with -D__SYS_TRACE):
+#   - debugger:    (gdb) call SYS->SetTrace(false)
+#                  (gdb) dump binary value trace.bin NTrace::buffer
+#   - application: SYS->SetTrace(false); send the GetTrace() bytes as they are.
+#
+# Usage:
+#   edros_trace.py trace.bin -o trace.json
+#   edros_trace.py trace.bin --text
+#===============================================================================
+import argparse
+import json
+import struct
+import sys
+
+#-------------------------------------------------------------------------------
+TRACE_MAGIC = 0x52544445
+TRACE_VERSION = 1
+HEADER = struct.Struct("<IHHIIII")      # magic, version, size, capacity, clock, head, enabled
+EVENT = struct.Struct("<IBBHI")         # time, event, info, arg, data
+
+IRQ_ENTER, IRQ_EXIT, ROUTE, INSERT, DISPATCH, DISPATCHED = 1, 2, 3, 4, 5, 6
+PENDSV_ENTER, PENDSV_EXIT, SLEEP_ENTER, SLEEP_EXIT, MARK = 7, 8, 9, 10, 11
+
+NAMES = {IRQ_ENTER: "IRQ_ENTER", IRQ_EXIT: "IRQ_EXIT", ROUTE: "ROUTE", INSERT: "INSERT",
+         DISPATCH: "DISPATCH", DISPATCHED: "DISPATCHED", PENDSV_ENTER: "PENDSV_ENTER",
+         PENDSV_EXIT: "PENDSV_EXIT", SLEEP_ENTER: "SLEEP_ENTER", SLEEP_EXIT: "SLEEP_EXIT",
+         MARK: "MARK"}
+PATHS = {0: "critical", 1: "callback", 2: "queued"}
+IDLE_MODES = {0: "sleep", 1: "tickless", 2: "stop", 3: "standby"}
+EXCEPTIONS = {2: "NMI", 3: "HardFault", 4: "MemManage", 5: "BusFault", 6: "UsageFault",
+              11: "SVCall", 12: "DebugMon", 14: "PendSV", 15: "SysTick"}
+
+# one timeline (thread) per kind of activity
+TRACKS = {"dispatcher": 1, "interrupts": 2, "pendsv": 3, "idle": 4, "pipe": 5, "marks": 6}
+
+#-------------------------------------------------------------------------------
+class TraceError(Exception):
+    pass
+
+#-------------------------------------------------------------------------------
+def decode(blob):
+    """Returns the clock (Hz) and the events, oldest first: (time, event, info, arg, data),
+    with the 32-bit cycle counter unwrapped."""
+    if len(blob) < HEADER.size:
+        raise TraceError("dump shorter than the trace header")
+    magic, version, size, capacity, clock, head, _ = HEADER.unpack_from(blob, 0)
+    if magic != TRACE_MAGIC:
+        raise TraceError("not an EDROS trace (magic 0x%08X)" % magic)
+    if version != TRACE_VERSION or size != EVENT.size:
+        raise TraceError("unsupported trace version %d (event size %d)" % (version, size))
+    if capacity == 0 or len(blob) < HEADER.size + capacity * size:
+        raise TraceError("dump shorter than the event ring (%d events)" % capacity)
+    if clock == 0:
+        raise TraceError("trace not initialized")
+
+    count = min(head, capacity)
+    events = []
+    for n in range(head - count, head):
+        e = EVENT.unpack_from(blob, HEADER.size + (n % capacity) * size)
+        if e[1] != 0:
+            events.append(e)
+
+    # the counter wraps: deltas taken as signed (records may be slightly out of order)
+    unwrapped, previous, now = [], None, 0
+    for time, event, info, arg, data in events:
+        if previous is not None:
+            delta = (time - previous) & 0xFFFFFFFF
+            now += delta - (1 << 32) if delta & 0x80000000 else delta
+        previous = time
+        unwrapped.append((now, event, info, arg, data))
+    unwrapped.sort(key=lambda e: e[0])
+    return clock, unwrapped
+
+#-------------------------------------------------------------------------------
+def exception_name(number):
+    if number >= 16:
+        return "IRQ %d" % (number - 16)
+    return EXCEPTIONS.get(number, "exception %d" % number)
+
+#-------------------------------------------------------------------------------
+def convert(clock, events):
+    """Builds the Chrome trace (JSON object format)."""
+    out = [{"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "EDROS"}}]
+    for name, tid in TRACKS.items():
+        out.append({"ph": "M", "pid": 1, "tid": tid, "name": "thread_name", "args": {"name": name}})
+        out.append({"ph": "M", "pid": 1, "tid": tid, "name": "thread_sort_index", "args": {"sort_index": tid}})
+
+    depth = dict.fromkeys(TRACKS.values(), 0)
+    t0 = events[0][0] if events else 0
+
+    def emit(ph, track, name, ts, args=None):
+        tid = TRACKS[track]
+        # the ring may start inside a slice: its end alone is dropped
+        if ph == "E":
+            if depth[tid] == 0:
+                return
+            depth[tid] -= 1
+        elif ph == "B":
+            depth[tid] += 1
+        e = {"ph": ph, "pid": 1, "tid": tid, "name": name, "ts": ts}
+        if ph == "i":
+            e["s"] = "t"
+        if args:
+            e["args"] = args
+        out.append(e)
+
+    for now, event, info, arg, data in events:
+        ts = (now - t0) * 1e6 / clock
+        if event == IRQ_ENTER:
+            emit("B", "interrupts", exception_name(arg), ts)
+        elif event == IRQ_EXIT:
+            emit("E", "interrupts", exception_name(arg), ts)
+        elif event == ROUTE:
+            emit("i", "interrupts", "route " + PATHS.get(info, str(info)), ts,
+                 {"nv_id": arg, "message": "0x%08X" % data})
+        elif event == INSERT:
+            emit("i", "pipe", "insert" if arg & 1 else "insert (full)", ts,
+                 {"level": info, "unicast": bool(arg & 2), "message": "0x%08X" % data})
+        elif event == DISPATCH:
+            emit("B", "dispatcher", "0x%08X" % data, ts, {"level": info, "unicast": bool(arg)})
+        elif event == DISPATCHED:
+            emit("E", "dispatcher", "0x%08X" % data, ts)
+        elif event == PENDSV_ENTER:
+            emit("B", "pendsv", "callbacks", ts)
+        elif event == PENDSV_EXIT:
+            emit("E", "pendsv", "callbacks", ts, {"attended": arg})
+        elif event == SLEEP_ENTER:
+            emit("B", "idle", IDLE_MODES.get(info, "sleep"), ts, {"suppressed": arg} if info else None)
+        elif event == SLEEP_EXIT:
+            emit("E", "idle", IDLE_MODES.get(info, "sleep"), ts, {"elapsed": arg} if info else None)
+        elif event == MARK:
+            emit("i", "marks", "mark %d" % arg, ts, {"value": data})
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+#-------------------------------------------------------------------------------
+def listing(clock, events):
+    t0 = events[0][0] if events else 0
+    for now, event, info, arg, data in events:
+        yield "%12.3f us  %-12s info=%-3d arg=%-5d data=0x%08X" % (
+            (now - t0) * 1e6 / clock, NAMES.get(event, str(event)), info, arg, data)
+
+#-------------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(description="EDROS kernel trace to Chrome trace JSON")
+    parser.add_argument("dump", help="binary dump of the trace buffer")
+    parser.add_argument("-o", "--output", help="JSON file (default: standard output)")
+    parser.add_argument("--text", action="store_true", help="list the events instead")
+    options = parser.parse_args()
+
+    with open(options.dump, "rb") as f:
+        blob = f.read()
+    try:
+        clock, events = decode(blob)
+    except TraceError as e:
+        sys.exit("edros_trace: %s" % e)
+
+    output = open(options.output, "w") if options.output else sys.stdout
+    if options.text:
+        for line in listing(clock, events):
+            output.write(line + "\n")
+    else:
+        json.dump(convert(clock, events), output)
+        output.write("\n")
+    if options.output:
+        output.close()
+
+if __name__ == "__main__":
+    main()